@@ -29,9 +29,10 @@ void app_t::run()
         std::make_shared<ecs::ostream_logger_t>(std::cout)
     );
 
-    math::prng_t prng;
+    // spawn the boids from the world's seed, so that runs are reproducible
+    math::prng_t prng(world.get_seed());
 
-    std::vector<attractor_t> attractors;
+    auto& attractors = world.add_resource<attractors_t>().list;
     {
         // the first attractor will be rotating around the origin by the
         // attractors system
@@ -48,10 +49,6 @@ void app_t::run()
         attractors.push_back(attractor);
     }
 
-    spatial::grid_2d_t<boid_t> boids(
-        math::bounds2(boid_min_pos, boid_max_pos),
-        math::ivec2(6)
-    );
     for (usize i = 0; i < 200; i++)
     {
         boid_t boid;
@@ -64,20 +61,22 @@ void app_t::run()
         f32 angle = prng.next<f32>(0, math::tau<f32>);
         boid.vel = boid_speed * math::vec2(math::cos(angle), math::sin(angle));
 
-        boids.insert(boid);
+        world.add_component<boid_t>(world.create_entity(), boid);
     }
 
+    // simulate the boids in fixed steps regardless of the frame rate
+    world.set_fixed_timestep(1. / 120.);
 
     world.add_system(std::make_shared<attractor_system_t>(
-        "attractor", ecs::execution_scheme_t(0), attractors
+        "attractor", ecs::execution_scheme_t(0, false, true)
     ));
 
     world.add_system(std::make_shared<boid_system_t>(
-        "boid", ecs::execution_scheme_t(1), boids, attractors
+        "boid", ecs::execution_scheme_t(1, false, true)
     ));
 
     world.add_system(std::make_shared<render_system_t>(
-        "render", ecs::execution_scheme_t(2, true), window, boids
+        "render", ecs::execution_scheme_t(2, true), window
     ));
 
     world.run();
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <vector>
+
 #include "gsx/gsx.h"
 
 struct boid_t
@@ -13,3 +15,9 @@ struct attractor_t
     math::vec2 pos;
     f32 strength = 0;
 };
+
+// a world resource with every attractor
+struct attractors_t
+{
+    std::vector<attractor_t> list;
+};
@@ -1,6 +1,7 @@
 #include "systems.h"
 
-#include <omp.h>
+#include <span>
+#include <vector>
 
 #include "constants.h"
 
@@ -29,18 +30,19 @@ f32 sd_colliders(vec2 p, f32 time)
 
 attractor_system_t::attractor_system_t(
     const std::string& name,
-    const ecs::execution_scheme_t& exec_scheme,
-    std::vector<attractor_t>& attractors
+    const ecs::execution_scheme_t& exec_scheme
 )
-    : ecs::base_system_t(name, exec_scheme),
-    attractors(attractors)
-{}
+    : ecs::base_system_t(name, exec_scheme)
+{
+    declare_write<attractors_t>();
+}
 
 void attractor_system_t::on_update(
     ecs::world_t& world,
     const ecs::iteration_t& iter
 )
 {
+    auto& attractors = world.resource<attractors_t>().list;
     if (attractors.size() < 1)
         return;
 
@@ -51,152 +53,192 @@ void attractor_system_t::on_update(
 
 boid_system_t::boid_system_t(
     const std::string& name,
-    const ecs::execution_scheme_t& exec_scheme,
-    spatial::base_structure_2d_t<boid_t>& boids,
-    std::vector<attractor_t>& attractors
+    const ecs::execution_scheme_t& exec_scheme
 )
     : ecs::base_system_t(name, exec_scheme),
-    boids(boids), attractors(attractors)
-{}
+    grid(bounds2(boid_min_pos, boid_max_pos), ivec2(6))
+{
+    declare_read<attractors_t>();
+    declare_write<boid_t>();
+}
 
 void boid_system_t::on_update(
     ecs::world_t& world,
     const ecs::iteration_t& iter
 )
 {
-    const f32 dt = min(iter.dt, 0.02);
-
-    std::vector<boid_t*> boids_vec;
-    boids.query_all(boids_vec);
+    const f32 dt = iter.dt;
+    const attractors_t& attractors = world.resource<attractors_t>();
 
-#pragma omp parallel for
-    for (i32 i = 0; i < boids_vec.size(); i++)
-    {
-        boid_t* boid = boids_vec[i];
+    auto boids = world.view<boid_t>();
 
-        // weighted average of the neighbor velocities
-        vec2 avg_vel(0);
+    // index the boids by their position for neighbor queries
+    grid.clear();
+    boids.each(
+        [this](boid_t& boid)
+        {
+            grid.insert(&boid);
+        }
+    );
 
-        // query the neighbors
-        std::vector<boid_t*> neighbors;
-        boids.query(
-            circle_t(boid->pos, boid_attention_radius),
-            neighbors
-        );
+    // gather the packed chunks of boids
+    std::vector<std::span<boid_t>> chunks;
+    boids.each_chunk(
+        [&chunks](
+            std::span<const ecs::entity_t> entities,
+            std::span<boid_t> chunk
+            )
+        {
+            chunks.push_back(chunk);
+        }
+    );
 
-        // iterate through the neighbors
-        for (auto neighbor : neighbors)
+    // update the chunks in parallel on the world's thread pool
+    world.parallel_for(
+        0,
+        chunks.size(),
+        1,
+        [this, &chunks, &attractors, dt, &iter](usize begin, usize end)
         {
-            if (neighbor == boid) continue;
+            for (usize i = begin; i < end; i++)
+            {
+                for (auto& boid : chunks[i])
+                {
+                    update_boid(boid, attractors, dt, iter.time);
+                }
+            }
+        }
+    );
+}
 
-            // info about the neighbor
-            vec2 this_to_neighbor = neighbor->pos - boid->pos;
-            f32 dist_sqr = dot(this_to_neighbor, this_to_neighbor);
+void boid_system_t::update_boid(
+    boid_t& boid,
+    const attractors_t& attractors,
+    f32 dt,
+    f32 time
+)
+{
+    // weighted average of the neighbor velocities
+    vec2 avg_vel(0);
+
+    // query the neighbors
+    std::vector<boid_t*> neighbors;
+    grid.query(
+        circle_t(boid.pos, boid_attention_radius),
+        neighbors
+    );
 
-            // discard if outside of the attention radius
-            if (dist_sqr > boid_attention_radius_sqr)
-                continue;
+    // iterate through the neighbors
+    for (auto neighbor : neighbors)
+    {
+        if (neighbor == &boid) continue;
 
-            // distance from the neighbor
-            f32 dist = math::sqrt(dist_sqr);
+        // info about the neighbor
+        vec2 this_to_neighbor = neighbor->pos - boid.pos;
+        f32 dist_sqr = dot(this_to_neighbor, this_to_neighbor);
 
-            // steer away from nearby boids
-            if (
-                dot(
-                    normalize(boid->vel),
-                    normalize(neighbor->vel)
-                ) > math::cos(1.1f))
-            {
-                // how much do I steer away?
-                f32 fac = 1.f - clamp01(dist / boid_attention_radius);
-
-                // steer
-                f32 angle = radians(20.f * fac * dt);
-                boid->vel = transform::apply_vector_2d(
-                    transform::rotate_2d(angle),
-                    boid->vel
-                );
-
-                // move away
-                boid->vel -= 5.f * fac * dt * this_to_neighbor;
-            }
+        // discard if outside of the attention radius
+        if (dist_sqr > boid_attention_radius_sqr)
+            continue;
 
-            // update the weighted average velocity
-            f32 weight = 1.f - clamp01(dist / boid_attention_radius);
-            avg_vel += weight * neighbor->vel;
-        }
+        // distance from the neighbor
+        f32 dist = math::sqrt(dist_sqr);
 
-        // try to go in the same direction as the neighbors
-        f32 lensqr_avg_vel = dot(avg_vel, avg_vel);
-        if (lensqr_avg_vel > 0)
+        // steer away from nearby boids
+        if (
+            dot(
+                normalize(boid.vel),
+                normalize(neighbor->vel)
+            ) > math::cos(1.1f))
         {
-            boid->vel = mix(boid->vel, avg_vel, min(.3f * dt, 1.f));
-        }
+            // how much do I steer away?
+            f32 fac = 1.f - clamp01(dist / boid_attention_radius);
 
-        // attractors
-        for (const auto& attractor : attractors)
-        {
-            vec2 target_vel = boid_speed * normalize(attractor.pos - boid->pos);
-            boid->vel = mix(
-                boid->vel,
-                target_vel,
-                clamp(attractor.strength * dt, -1.f, 1.f)
+            // steer
+            f32 angle = radians(20.f * fac * dt);
+            boid.vel = transform::apply_vector_2d(
+                transform::rotate_2d(angle),
+                boid.vel
             );
+
+            // move away
+            boid.vel -= 5.f * fac * dt * this_to_neighbor;
         }
 
-        // constant speed
-        boid->vel = boid_speed * normalize(boid->vel);
+        // update the weighted average velocity
+        f32 weight = 1.f - clamp01(dist / boid_attention_radius);
+        avg_vel += weight * neighbor->vel;
+    }
 
-        // update position
-        boid->pos += boid->vel * dt;
+    // try to go in the same direction as the neighbors
+    f32 lensqr_avg_vel = dot(avg_vel, avg_vel);
+    if (lensqr_avg_vel > 0)
+    {
+        boid.vel = mix(boid.vel, avg_vel, min(.3f * dt, 1.f));
+    }
 
-        // get away from the colliders
-        {
-            // signed distance
-            f32 sd = sd_colliders(boid->pos, iter.time);
+    // attractors
+    for (const auto& attractor : attractors.list)
+    {
+        vec2 target_vel = boid_speed * normalize(attractor.pos - boid.pos);
+        boid.vel = mix(
+            boid.vel,
+            target_vel,
+            clamp(attractor.strength * dt, -1.f, 1.f)
+        );
+    }
 
-            // normal
-            vec2 normal = normalize(vec2(
-                sd_colliders(boid->pos + vec2(.001, 0), iter.time) - sd,
-                sd_colliders(boid->pos + vec2(0, .001), iter.time) - sd
-            ));
+    // constant speed
+    boid.vel = boid_speed * normalize(boid.vel);
 
-            // if inside
-            if (sd < 0)
-            {
-                // snap to outside
-                boid->pos += (.001f - sd) * normal;
+    // update position
+    boid.pos += boid.vel * dt;
 
-                // bounce
-                boid->vel = reflect(boid->vel, normal);
-            }
+    // get away from the colliders
+    {
+        // signed distance
+        f32 sd = sd_colliders(boid.pos, time);
 
-            // steer away
-            f32 pd = max(0.f, sd);
-            f32 angle = radians(-50.f * math::exp(-15.f * pd) * dt);
-            boid->vel = transform::apply_vector_2d(
-                transform::rotate_2d(angle),
-                boid->vel
-            );
+        // normal
+        vec2 normal = normalize(vec2(
+            sd_colliders(boid.pos + vec2(.001, 0), time) - sd,
+            sd_colliders(boid.pos + vec2(0, .001), time) - sd
+        ));
 
-            // move away
-            f32 force = 1. / (100. * pd * pd + .1);
-            boid->vel += force * dt * normal;
+        // if inside
+        if (sd < 0)
+        {
+            // snap to outside
+            boid.pos += (.001f - sd) * normal;
+
+            // bounce
+            boid.vel = reflect(boid.vel, normal);
         }
-    }
 
-    boids.rebuild();
+        // steer away
+        f32 pd = max(0.f, sd);
+        f32 angle = radians(-50.f * math::exp(-15.f * pd) * dt);
+        boid.vel = transform::apply_vector_2d(
+            transform::rotate_2d(angle),
+            boid.vel
+        );
+
+        // move away
+        f32 force = 1. / (100. * pd * pd + .1);
+        boid.vel += force * dt * normal;
+    }
 }
 
 render_system_t::render_system_t(
     const std::string& name,
     const ecs::execution_scheme_t& exec_scheme,
-    GLFWwindow* window,
-    spatial::base_structure_2d_t<boid_t>& boids
+    GLFWwindow* window
 )
     : ecs::base_system_t(name, exec_scheme),
-    window(window), boids(boids)
-{}
+    window(window)
+{
+    declare_read<boid_t>();
+}
 
 void render_system_t::on_start(ecs::world_t& world)
 {
@@ -263,6 +305,7 @@ void render_system_t::on_start(ecs::world_t& world)
 
     // boid VBO
     glGenBuffers(1, &boid_vbo);
+    n_uploaded_boids = 0;
 
     // boid shaders
     make_shader(
@@ -377,21 +420,42 @@ void render_system_t::on_update(
     // bind the boid VAO
     glBindVertexArray(boid_vao);
 
-    // get a list of all the boids
-    std::vector<boid_t> boids_vec;
-    boids.query_all(boids_vec);
-
-    // update the boid VBO
+    // update the boid VBO straight from the packed boid chunks, only
+    // uploading the chunks that changed since the last frame unless the
+    // number of boids changed
+    auto boids = world.view<const boid_t>();
+    usize n_boids = boids.size();
+    u64 since = iter.last_version;
     glBindBuffer(GL_ARRAY_BUFFER, boid_vbo);
-    glBufferData(
-        GL_ARRAY_BUFFER,
-        boids_vec.size() * sizeof(boid_t),
-        boids_vec.data(),
-        GL_DYNAMIC_DRAW
+    if (n_boids != n_uploaded_boids)
+    {
+        glBufferData(
+            GL_ARRAY_BUFFER,
+            n_boids * sizeof(boid_t),
+            nullptr,
+            GL_DYNAMIC_DRAW
+        );
+        n_uploaded_boids = n_boids;
+        since = 0;
+    }
+    boids.changed_since(since).each_chunk(
+        [](
+            usize offset,
+            std::span<const ecs::entity_t> entities,
+            std::span<const boid_t> chunk
+            )
+        {
+            glBufferSubData(
+                GL_ARRAY_BUFFER,
+                offset * sizeof(boid_t),
+                chunk.size_bytes(),
+                chunk.data()
+            );
+        }
     );
 
     // draw the boids
-    glDrawArrays(GL_POINTS, 0, boids_vec.size());
+    glDrawArrays(GL_POINTS, 0, n_boids);
 
     // swap front and back buffers
     glfwSwapBuffers(window);
@@ -12,8 +12,7 @@ class attractor_system_t : public ecs::base_system_t
 public:
     attractor_system_t(
         const std::string& name,
-        const ecs::execution_scheme_t& exec_scheme,
-        std::vector<attractor_t>& attractors
+        const ecs::execution_scheme_t& exec_scheme
     );
     virtual ~attractor_system_t() = default;
 
@@ -22,9 +21,6 @@ public:
         const ecs::iteration_t& iter
     ) override;
 
-private:
-    std::vector<attractor_t>& attractors;
-
 };
 
 class boid_system_t : public ecs::base_system_t
@@ -32,9 +28,7 @@ class boid_system_t : public ecs::base_system_t
 public:
     boid_system_t(
         const std::string& name,
-        const ecs::execution_scheme_t& exec_scheme,
-        spatial::base_structure_2d_t<boid_t>& boids,
-        std::vector<attractor_t>& attractors
+        const ecs::execution_scheme_t& exec_scheme
     );
     virtual ~boid_system_t() = default;
 
@@ -44,8 +38,15 @@ public:
     ) override;
 
 private:
-    spatial::base_structure_2d_t<boid_t>& boids;
-    std::vector<attractor_t>& attractors;
+    // the boids indexed by their position, refilled in every update
+    spatial::grid_2d_t<boid_t*> grid;
+
+    void update_boid(
+        boid_t& boid,
+        const attractors_t& attractors,
+        f32 dt,
+        f32 time
+    );
 
 };
 
@@ -55,8 +56,7 @@ public:
     render_system_t(
         const std::string& name,
         const ecs::execution_scheme_t& exec_scheme,
-        GLFWwindow* window,
-        spatial::base_structure_2d_t<boid_t>& boids
+        GLFWwindow* window
     );
     virtual ~render_system_t() = default;
 
@@ -71,8 +71,6 @@ public:
     ) override;
 
 private:
-    spatial::base_structure_2d_t<boid_t>& boids;
-
     GLFWwindow* window;
 
     GLuint plane_vao = 0;
@@ -89,4 +87,7 @@ private:
     GLuint boid_frag_shader = 0;
     GLuint boid_shader_program = 0;
 
+    // number of boids the boid VBO was allocated for
+    usize n_uploaded_boids = 0;
+
 };
@@ -6,12 +6,10 @@
 
 struct transform_t
 {
-    u32 owner;
     math::vec2 pos;
 };
 
 struct circle_t
 {
-    u32 owner;
     f32 radius;
 };
@@ -6,41 +6,58 @@
 
 movement_system_t::movement_system_t(
     const std::string& name,
-    const ecs::execution_scheme_t& exec_scheme,
-    std::vector<transform_t>& transforms
+    const ecs::execution_scheme_t& exec_scheme
 )
-    : ecs::base_system_t(name, exec_scheme),
-    transforms(transforms)
-{}
+    : ecs::base_system_t(name, exec_scheme)
+{
+    declare_write<transform_t>();
+}
 
 void movement_system_t::on_update(
     ecs::world_t& world,
     const ecs::iteration_t& iter
 )
 {
-    for (usize i = 0; i < transforms.size(); i++)
-    {
-        transform_t& transform = transforms[i];
-        f32 theta = .5f * (i + 1.f) * iter.time;
-        transform.pos = 3.f * math::vec2(math::cos(theta), sin(theta));
-    }
+    world.view<transform_t>().each(
+        [&iter](ecs::entity_t entity, transform_t& transform)
+        {
+            f32 theta = .5f * (f32)ecs::entity_index(entity) * iter.time;
+            transform.pos = 3.f * math::vec2(math::cos(theta), sin(theta));
+        }
+    );
 }
 
 render_system_t::render_system_t(
     const std::string& name,
-    const ecs::execution_scheme_t& exec_scheme,
-    std::vector<transform_t>& transforms,
-    std::vector<circle_t>& circles
+    const ecs::execution_scheme_t& exec_scheme
 )
-    : ecs::base_system_t(name, exec_scheme),
-    transforms(transforms), circles(circles)
-{}
+    : ecs::base_system_t(name, exec_scheme)
+{
+    declare_read<circle_t>();
+    declare_read<transform_t>();
+}
 
 void render_system_t::on_update(
     ecs::world_t& world,
     const ecs::iteration_t& iter
 )
 {
+    // gather the circles. circles with a transform use the transform position
+    // as the center, and the rest use the origin.
+    std::vector<math::circle_t> circles;
+    world.view<const circle_t, const transform_t>().each(
+        [&circles](const circle_t& circle, const transform_t& transform)
+        {
+            circles.emplace_back(transform.pos, circle.radius);
+        }
+    );
+    world.view<const circle_t>().exclude<transform_t>().each(
+        [&circles](const circle_t& circle)
+        {
+            circles.emplace_back(math::vec2(0), circle.radius);
+        }
+    );
+
     clear_console();
 
     // render (per-pixel shader)
@@ -56,33 +73,10 @@ void render_system_t::on_update(
             f32 dist = 1e9f;
             for (auto& circle : circles)
             {
-                // see if there's a transform component with the same owner
-                transform_t* transform = nullptr;
-                for (auto& t : transforms)
-                {
-                    if (t.owner == circle.owner)
-                    {
-                        transform = &t;
-                        break;
-                    }
-                }
-
-                if (transform)
-                {
-                    // use transform.pos as the center
-                    dist = math::min(
-                        dist,
-                        sd_circle(uv, transform->pos, circle.radius)
-                    );
-                }
-                else
-                {
-                    // use the origin as the center
-                    dist = math::min(
-                        dist,
-                        sd_circle(uv, math::vec2(0), circle.radius)
-                    );
-                }
+                dist = math::min(
+                    dist,
+                    sd_circle(uv, circle.center, circle.radius)
+                );
             }
 
             std::cout << (dist < px2uv ? 'o' : ' ') << " ";
@@ -9,12 +9,9 @@
 class movement_system_t : public ecs::base_system_t
 {
 public:
-    std::vector<transform_t>& transforms;
-
     movement_system_t(
         const std::string& name,
-        const ecs::execution_scheme_t& exec_scheme,
-        std::vector<transform_t>& transforms
+        const ecs::execution_scheme_t& exec_scheme
     );
     virtual ~movement_system_t() = default;
 
@@ -28,14 +25,9 @@ public:
 class render_system_t : public ecs::base_system_t
 {
 public:
-    std::vector<transform_t>& transforms;
-    std::vector<circle_t>& circles;
-
     render_system_t(
         const std::string& name,
-        const ecs::execution_scheme_t& exec_scheme,
-        std::vector<transform_t>& transforms,
-        std::vector<circle_t>& circles
+        const ecs::execution_scheme_t& exec_scheme
     );
     virtual ~render_system_t() = default;
 
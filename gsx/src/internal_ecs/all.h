@@ -1,6 +1,19 @@
 #pragma once
 
 #include "log.h"
+#include "binary_log.h"
 #include "event.h"
+#include "channel.h"
+#include "entity.h"
+#include "component.h"
+#include "archetype.h"
+#include "view.h"
+#include "registry.h"
+#include "resource.h"
+#include "snapshot.h"
+#include "command_buffer.h"
+#include "profiler.h"
+#include "trace.h"
+#include "replay.h"
 #include "system.h"
 #include "world.h"
@@ -0,0 +1,181 @@
+#include "archetype.h"
+
+#include <algorithm>
+#include <new>
+#include <cstring>
+
+namespace gsx::ecs
+{
+
+    static constexpr usize align_up(usize v, usize align)
+    {
+        return (v + align - 1) / align * align;
+    }
+
+    archetype_t::archetype_t(const std::vector<const component_info_t*>& infos)
+    {
+        // bytes needed per entity, including the entity ID itself
+        usize row_bytes = sizeof(entity_t);
+        for (auto info : infos)
+        {
+            _signature.push_back(info->id);
+            row_bytes += info->size;
+            chunk_align = std::max(chunk_align, info->align);
+        }
+
+        // start with an optimistic capacity and shrink it until the columns
+        // and their alignment padding fit in a chunk.
+        _chunk_capacity = std::max<usize>(1, chunk_bytes / row_bytes);
+        while (true)
+        {
+            usize offset = align_up(
+                sizeof(entity_t) * _chunk_capacity,
+                column_align
+            );
+
+            columns.clear();
+            for (auto info : infos)
+            {
+                offset = align_up(offset, std::max(info->align, column_align));
+                columns.push_back(column_t{ info, offset });
+                offset += info->size * _chunk_capacity;
+            }
+
+            if (offset <= chunk_bytes || _chunk_capacity == 1)
+                break;
+
+            _chunk_capacity--;
+        }
+    }
+
+    archetype_t::~archetype_t()
+    {
+        while (_size > 0)
+        {
+            erase(_size - 1);
+        }
+
+        for (auto chunk : chunks)
+        {
+            ::operator delete(chunk, std::align_val_t(chunk_align));
+        }
+    }
+
+    isize archetype_t::column_index(type_id_t id) const
+    {
+        auto it = std::lower_bound(_signature.begin(), _signature.end(), id);
+        if (it == _signature.end() || *it != id)
+            return -1;
+        return it - _signature.begin();
+    }
+
+    bool archetype_t::has(type_id_t id) const
+    {
+        return std::binary_search(_signature.begin(), _signature.end(), id);
+    }
+
+    entity_t* archetype_t::entities(usize chunk)
+    {
+        return reinterpret_cast<entity_t*>(chunks[chunk]);
+    }
+
+    const entity_t* archetype_t::entities(usize chunk) const
+    {
+        return reinterpret_cast<const entity_t*>(chunks[chunk]);
+    }
+
+    void* archetype_t::column(usize chunk, usize column_index)
+    {
+        return chunks[chunk] + columns[column_index].offset;
+    }
+
+    const void* archetype_t::column(usize chunk, usize column_index) const
+    {
+        return chunks[chunk] + columns[column_index].offset;
+    }
+
+    void* archetype_t::at(usize row, usize column_index)
+    {
+        const column_t& col = columns[column_index];
+        return chunks[row / _chunk_capacity]
+            + col.offset
+            + (row % _chunk_capacity) * col.info->size;
+    }
+
+    entity_t& archetype_t::entity_at(usize row)
+    {
+        return entities(row / _chunk_capacity)[row % _chunk_capacity];
+    }
+
+    void archetype_t::set_row_version(usize row, u64 version)
+    {
+        usize chunk = row / _chunk_capacity;
+        for (usize i = 0; i < columns.size(); i++)
+        {
+            set_version(chunk, i, version);
+        }
+    }
+
+    usize archetype_t::push(entity_t entity)
+    {
+        if (_size == chunks.size() * _chunk_capacity)
+        {
+            usize bytes = std::max(
+                chunk_bytes,
+                columns.empty()
+                ? sizeof(entity_t) * _chunk_capacity
+                : columns.back().offset
+                + columns.back().info->size * _chunk_capacity
+            );
+            chunks.push_back(static_cast<std::byte*>(
+                ::operator new(bytes, std::align_val_t(chunk_align))
+            ));
+            versions.resize(chunks.size() * columns.size(), 0);
+        }
+
+        usize row = _size++;
+        entity_at(row) = entity;
+        return row;
+    }
+
+    entity_t archetype_t::pop_dead(usize row)
+    {
+        usize last = _size - 1;
+        entity_t moved = null_entity;
+
+        if (row != last)
+        {
+            for (usize i = 0; i < columns.size(); i++)
+            {
+                const component_info_t& info = *columns[i].info;
+                if (info.trivial)
+                {
+                    std::memcpy(at(row, i), at(last, i), info.size);
+                }
+                else
+                {
+                    info.relocate(at(row, i), at(last, i));
+                }
+            }
+            moved = entity_at(last);
+            entity_at(row) = moved;
+        }
+
+        _size--;
+        return moved;
+    }
+
+    entity_t archetype_t::erase(usize row)
+    {
+        for (usize i = 0; i < columns.size(); i++)
+        {
+            const component_info_t& info = *columns[i].info;
+            if (!info.trivial)
+            {
+                info.destroy(at(row, i));
+            }
+        }
+        return pop_dead(row);
+    }
+
+}
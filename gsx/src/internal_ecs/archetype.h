@@ -0,0 +1,202 @@
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+#include <cstddef>
+#include <cstdint>
+
+#include "entity.h"
+#include "component.h"
+#include "../internal_common/all.h"
+
+namespace gsx::ecs
+{
+
+    class registry_t;
+
+    // storage for every entity that has the exact same set of component types
+    // (the signature). entities are packed into fixed-size chunks of memory,
+    // and inside each chunk every component type gets its own contiguous
+    // column (SoA), so iterating over one component type touches nothing but
+    // that type's data.
+    // * rows are always kept packed. removing an entity moves the last entity
+    //   into the freed row, so every chunk except the last one is always full.
+    // * every column of every chunk has a version, which is the version of
+    //   the registry (see registry_t::get_version()) when the column was last
+    //   written to, so that systems can skip the chunks that haven't changed
+    //   (see view_t::changed_since()).
+    // * archetypes are created and owned by a registry_t.
+    class archetype_t
+    {
+    public:
+        // size of a single chunk in bytes
+        static constexpr usize chunk_bytes = 16 * 1024;
+
+        // columns inside a chunk start at multiples of this, or of the
+        // alignment of their component type if it's larger
+        static constexpr usize column_align = 64;
+
+        // * infos must be sorted by type ID and must not contain duplicates.
+        archetype_t(const std::vector<const component_info_t*>& infos);
+        no_copy_construct_no_assignment(archetype_t);
+        ~archetype_t();
+
+        // sorted list of the component type IDs in this archetype
+        constexpr const std::vector<type_id_t>& signature() const
+        {
+            return _signature;
+        }
+
+        // index of the column holding a given component type, or -1 if the
+        // archetype doesn't have that component type.
+        isize column_index(type_id_t id) const;
+
+        bool has(type_id_t id) const;
+
+        template<typename T>
+        bool has() const
+        {
+            return has(type_id_of<T>());
+        }
+
+        // total number of entities
+        constexpr usize size() const
+        {
+            return _size;
+        }
+
+        // maximum number of entities in a single chunk
+        constexpr usize chunk_capacity() const
+        {
+            return _chunk_capacity;
+        }
+
+        // number of chunks that contain at least one entity
+        constexpr usize chunk_count() const
+        {
+            return (_size + _chunk_capacity - 1) / _chunk_capacity;
+        }
+
+        // number of entities in a given chunk
+        constexpr usize chunk_size(usize chunk) const
+        {
+            usize start = chunk * _chunk_capacity;
+            return (_size - start < _chunk_capacity)
+                ? _size - start
+                : _chunk_capacity;
+        }
+
+        // packed array of the entities in a given chunk
+        entity_t* entities(usize chunk);
+        const entity_t* entities(usize chunk) const;
+
+        // packed array of the components in a given column of a given chunk
+        void* column(usize chunk, usize column_index);
+        const void* column(usize chunk, usize column_index) const;
+
+        // packed array of the components of type T in a given chunk, or
+        // nullptr if the archetype doesn't have T.
+        template<typename T>
+        T* column(usize chunk)
+        {
+            isize index = column_index(type_id_of<T>());
+            if (index < 0)
+                return nullptr;
+            return static_cast<T*>(column(chunk, (usize)index));
+        }
+
+        template<typename T>
+        const T* column(usize chunk) const
+        {
+            isize index = column_index(type_id_of<T>());
+            if (index < 0)
+                return nullptr;
+            return static_cast<const T*>(column(chunk, (usize)index));
+        }
+
+        constexpr const component_info_t& column_info(usize column_index) const
+        {
+            return *columns[column_index].info;
+        }
+
+        constexpr usize column_count() const
+        {
+            return columns.size();
+        }
+
+        // the version of the registry when a column of a chunk was last
+        // written to, or when any of its rows was added, removed or moved
+        constexpr u64 get_version(usize chunk, usize column_index) const
+        {
+            return versions[chunk * columns.size() + column_index];
+        }
+
+        // * this is done by the registry and by views when they give out
+        //   mutable access to a column.
+        constexpr void set_version(
+            usize chunk,
+            usize column_index,
+            u64 version
+        )
+        {
+            versions[chunk * columns.size() + column_index] = version;
+        }
+
+    private:
+        struct column_t
+        {
+            const component_info_t* info;
+
+            // byte offset of the column from the start of a chunk
+            usize offset;
+        };
+
+        std::vector<type_id_t> _signature;
+        std::vector<column_t> columns;
+        usize _chunk_capacity = 0;
+        usize _size = 0;
+
+        // alignment of the chunks, which is the largest of column_align and
+        // the alignments of the component types
+        usize chunk_align = column_align;
+
+        // allocated chunks, some of which may be empty and kept around for
+        // reuse.
+        std::vector<std::byte*> chunks;
+
+        // version of every column of every allocated chunk, indexed by
+        // chunk * column_count() + column_index
+        std::vector<u64> versions;
+
+        // cached archetypes that an entity of this archetype moves to when a
+        // component type is added or removed.
+        std::unordered_map<type_id_t, archetype_t*> edges_add;
+        std::unordered_map<type_id_t, archetype_t*> edges_remove;
+
+        // pointer to the component in a given column at a given row
+        void* at(usize row, usize column_index);
+
+        entity_t& entity_at(usize row);
+
+        // set the versions of every column of the chunk holding a row
+        void set_row_version(usize row, u64 version);
+
+        // append a new row for an entity and return its index. the components
+        // in the new row are left uninitialized.
+        usize push(entity_t entity);
+
+        // remove a row whose components have all been destroyed or relocated
+        // already, by relocating the last row into it. returns the entity that
+        // was moved into the row, or null_entity if the removed row was the
+        // last one.
+        entity_t pop_dead(usize row);
+
+        // destroy the components in a row and remove it. returns the same as
+        // pop_dead().
+        entity_t erase(usize row);
+
+        friend class registry_t;
+
+    };
+
+}
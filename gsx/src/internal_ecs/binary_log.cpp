@@ -0,0 +1,391 @@
+#include "binary_log.h"
+
+#include <sstream>
+#include <stdexcept>
+#include <cstring>
+
+namespace gsx::ecs
+{
+
+    static i64 to_microseconds(std::chrono::system_clock::time_point time)
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            time.time_since_epoch()
+        ).count();
+    }
+
+    static std::chrono::system_clock::time_point from_microseconds(i64 us)
+    {
+        return std::chrono::system_clock::time_point(
+            std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                std::chrono::microseconds(us)
+            )
+        );
+    }
+
+    // map signed integers to unsigned ones so that small negative numbers
+    // also make short varints
+    static u64 zigzag_encode(i64 v)
+    {
+        return ((u64)v << 1) ^ (u64)(v >> 63);
+    }
+
+    static i64 zigzag_decode(u64 v)
+    {
+        return (i64)(v >> 1) ^ -(i64)(v & 1);
+    }
+
+    binary_logger_t::binary_logger_t(
+        const std::string& filename,
+        usize buffer_size
+    )
+        : filename(filename), buffer_size(buffer_size)
+    {
+        log_file.open(
+            filename,
+            std::ofstream::out | std::ofstream::trunc | std::ofstream::binary
+        );
+        if (!log_file.is_open())
+        {
+            throw std::runtime_error(std::format(
+                "log file \"{}\" couldn't be created/opened",
+                filename
+            ));
+        }
+
+        buffer.reserve(buffer_size);
+
+        // header
+        prev_time = to_microseconds(std::chrono::system_clock::now());
+        u8 header[binary_log::header_size]{};
+        std::memcpy(header, binary_log::magic, sizeof(binary_log::magic));
+        for (usize i = 0; i < 2; i++)
+        {
+            header[4 + i] = (u8)(binary_log::version >> (8 * i));
+        }
+        for (usize i = 0; i < 8; i++)
+        {
+            header[8 + i] = (u8)((u64)prev_time >> (8 * i));
+        }
+        buffer.insert(buffer.end(), header, header + sizeof(header));
+
+        write_buffer();
+    }
+
+    binary_logger_t::~binary_logger_t()
+    {
+        std::scoped_lock lock(mutex);
+        if (log_file.is_open())
+        {
+            write_buffer();
+        }
+    }
+
+    void binary_logger_t::log(const log_entry_t& entry)
+    {
+        std::string message = entry.message.str();
+
+        std::scoped_lock lock(mutex);
+
+        if (!log_file)
+        {
+            throw std::runtime_error(std::format(
+                "the log file stream \"{}\" is in failure state",
+                filename
+            ));
+        }
+
+        u64 world_name_id = intern(
+            world_name_ids,
+            std::string(entry.world_name)
+        );
+        u64 thread_id = intern_thread(entry.thread_id);
+
+        i64 time = to_microseconds(entry.time);
+
+        buffer.push_back((u8)binary_log::tag_t::entry);
+        buffer.push_back((u8)entry.log_level);
+        write_varint(world_name_id);
+        write_varint(thread_id);
+        write_varint(zigzag_encode(time - prev_time));
+        write_varint(message.size());
+        buffer.insert(buffer.end(), message.begin(), message.end());
+
+        prev_time = time;
+
+        // errors are written right away so that they survive crashes
+        if (buffer.size() >= buffer_size
+            || entry.log_level == log_level_t::error)
+        {
+            write_buffer();
+        }
+    }
+
+    bool binary_logger_t::is_open() const
+    {
+        return log_file.is_open();
+    }
+
+    void binary_logger_t::flush()
+    {
+        std::scoped_lock lock(mutex);
+        write_buffer();
+    }
+
+    void binary_logger_t::close()
+    {
+        std::scoped_lock lock(mutex);
+        write_buffer();
+        log_file.close();
+    }
+
+    u64 binary_logger_t::intern(
+        std::unordered_map<std::string, u64>& ids,
+        const std::string& s
+    )
+    {
+        auto it = ids.find(s);
+        if (it != ids.end())
+            return it->second;
+
+        u64 id = next_string_id++;
+        ids.emplace(s, id);
+        write_string_record(id, s);
+        return id;
+    }
+
+    u64 binary_logger_t::intern_thread(std::thread::id thread_id)
+    {
+        auto it = thread_ids.find(thread_id);
+        if (it != thread_ids.end())
+            return it->second;
+
+        std::ostringstream stream;
+        stream << thread_id;
+
+        u64 id = next_string_id++;
+        thread_ids.emplace(thread_id, id);
+        write_string_record(id, stream.str());
+        return id;
+    }
+
+    void binary_logger_t::write_string_record(u64 id, const std::string& s)
+    {
+        buffer.push_back((u8)binary_log::tag_t::string);
+        write_varint(id);
+        write_varint(s.size());
+        buffer.insert(buffer.end(), s.begin(), s.end());
+    }
+
+    void binary_logger_t::write_varint(u64 v)
+    {
+        while (v >= 0x80)
+        {
+            buffer.push_back((u8)(v | 0x80));
+            v >>= 7;
+        }
+        buffer.push_back((u8)v);
+    }
+
+    void binary_logger_t::write_buffer()
+    {
+        if (buffer.empty() || !log_file.is_open())
+            return;
+
+        log_file.write(
+            reinterpret_cast<const char*>(buffer.data()),
+            buffer.size()
+        );
+        log_file.flush();
+        buffer.clear();
+    }
+
+    binary_log_reader_t::binary_log_reader_t(const std::string& filename)
+        : filename(filename)
+    {
+        log_file.open(filename, std::ifstream::in | std::ifstream::binary);
+        if (!log_file.is_open())
+        {
+            throw std::runtime_error(std::format(
+                "log file \"{}\" couldn't be opened",
+                filename
+            ));
+        }
+
+        u8 header[binary_log::header_size];
+        log_file.read(reinterpret_cast<char*>(header), sizeof(header));
+        if (!log_file
+            || std::memcmp(header, binary_log::magic, sizeof(binary_log::magic))
+            != 0)
+        {
+            throw std::runtime_error(std::format(
+                "\"{}\" is not a binary log",
+                filename
+            ));
+        }
+
+        u16 version = (u16)(header[4] | (header[5] << 8));
+        if (version != binary_log::version)
+        {
+            throw std::runtime_error(std::format(
+                "binary log \"{}\" has an unsupported version ({})",
+                filename,
+                version
+            ));
+        }
+
+        u64 time = 0;
+        for (usize i = 0; i < 8; i++)
+        {
+            time |= (u64)header[8 + i] << (8 * i);
+        }
+        prev_time = (i64)time;
+        start_time = from_microseconds(prev_time);
+    }
+
+    bool binary_log_reader_t::next(binary_log_record_t& out_record)
+    {
+        while (true)
+        {
+            int tag = log_file.get();
+            if (tag == std::ifstream::traits_type::eof())
+                return false;
+
+            if (tag == (int)binary_log::tag_t::string)
+            {
+                u64 id = read_varint();
+                std::string s = read_string(read_varint());
+                if (id >= strings.size())
+                {
+                    strings.resize(id + 1);
+                }
+                strings[id] = std::move(s);
+            }
+            else if (tag == (int)binary_log::tag_t::entry)
+            {
+                u8 log_level = read_u8();
+                if (log_level > (u8)log_level_t::verbose)
+                {
+                    throw std::runtime_error(std::format(
+                        "binary log \"{}\" has an invalid record log level "
+                        "({})",
+                        filename,
+                        log_level
+                    ));
+                }
+                out_record.log_level = (log_level_t)log_level;
+                out_record.world_name = string_at(read_varint());
+                out_record.thread_id = string_at(read_varint());
+                prev_time += zigzag_decode(read_varint());
+                out_record.time = from_microseconds(prev_time);
+                out_record.message = read_string(read_varint());
+                return true;
+            }
+            else
+            {
+                throw std::runtime_error(std::format(
+                    "binary log \"{}\" has an invalid record tag ({})",
+                    filename,
+                    tag
+                ));
+            }
+        }
+    }
+
+    usize binary_log_reader_t::write_csv(std::ostream& stream)
+    {
+        stream << "time,log_level,world_name,thread_id,message\n";
+
+        usize count = 0;
+        binary_log_record_t record;
+        while (next(record))
+        {
+            stream << '"' << str::from_time(record.time) << "\",";
+
+            switch (record.log_level)
+            {
+            case log_level_t::error:
+                stream << "error,";
+                break;
+            case log_level_t::warning:
+                stream << "warning,";
+                break;
+            case log_level_t::info:
+                stream << "info,";
+                break;
+            case log_level_t::verbose:
+                stream << "verbose,";
+                break;
+            default:
+                break;
+            }
+
+            // replace " with "" because CSV
+            stream << '"' << str::replace(record.world_name, "\"", "\"\"")
+                << "\",";
+            stream << record.thread_id << ',';
+            stream << '"' << str::replace(record.message, "\"", "\"\"")
+                << "\"\n";
+
+            count++;
+        }
+        return count;
+    }
+
+    u8 binary_log_reader_t::read_u8()
+    {
+        int c = log_file.get();
+        if (c == std::ifstream::traits_type::eof())
+        {
+            throw std::runtime_error(std::format(
+                "binary log \"{}\" is truncated",
+                filename
+            ));
+        }
+        return (u8)c;
+    }
+
+    u64 binary_log_reader_t::read_varint()
+    {
+        u64 v = 0;
+        for (usize shift = 0; shift < 64; shift += 7)
+        {
+            u8 byte = read_u8();
+            v |= (u64)(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0)
+                return v;
+        }
+        throw std::runtime_error(std::format(
+            "binary log \"{}\" has an invalid varint",
+            filename
+        ));
+    }
+
+    std::string binary_log_reader_t::read_string(usize length)
+    {
+        std::string s(length, '\0');
+        log_file.read(s.data(), length);
+        if ((usize)log_file.gcount() != length)
+        {
+            throw std::runtime_error(std::format(
+                "binary log \"{}\" is truncated",
+                filename
+            ));
+        }
+        return s;
+    }
+
+    const std::string& binary_log_reader_t::string_at(u64 id) const
+    {
+        if (id >= strings.size())
+        {
+            throw std::runtime_error(std::format(
+                "binary log \"{}\" refers to an undefined string ({})",
+                filename,
+                id
+            ));
+        }
+        return strings[id];
+    }
+
+}
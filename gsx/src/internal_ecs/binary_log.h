@@ -0,0 +1,154 @@
+#pragma once
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <cstdint>
+
+#include "log.h"
+#include "../internal_common/all.h"
+
+namespace gsx::ecs
+{
+
+    // the binary log format written by binary_logger_t:
+    // - a fixed 16-byte header: the magic bytes "GSXL", the format version
+    //   (u16), 2 reserved bytes, and the time the log was created (i64,
+    //   microseconds since the epoch of std::chrono::system_clock).
+    // - a sequence of records, each starting with a tag byte:
+    //   - binary_log::tag_t::string: a string interned for later records (its
+    //     ID and its length as varints, then its bytes). world names and
+    //     thread IDs are only written once, the first time they're used.
+    //   - binary_log::tag_t::entry: a log entry (the log level as a byte, the
+    //     IDs of its world name and thread ID as varints, the zigzag-encoded
+    //     difference from the previous entry's time in microseconds as a
+    //     varint, and the length of the message as a varint, then its bytes).
+    // * all integers are little endian, and varints use 7 bits per byte,
+    //   least significant group first.
+    namespace binary_log
+    {
+        inline constexpr char magic[4] = { 'G', 'S', 'X', 'L' };
+        inline constexpr u16 version = 1;
+        inline constexpr usize header_size = 16;
+
+        enum class tag_t : u8
+        {
+            string = 1,
+            entry = 2
+        };
+    }
+
+    // a logger that writes a compact binary log (see binary_log) instead of
+    // text, which is much cheaper to write and much smaller than CSV. use
+    // binary_log_reader_t or the log_decoder tool to convert it to CSV.
+    // * entries are gathered in a buffer and written in large blocks. the
+    //   buffer is written when it's full, when an error is logged, when
+    //   flush() is called, and when the logger is destroyed.
+    class binary_logger_t : public base_logger_t
+    {
+    public:
+        binary_logger_t(
+            const std::string& filename,
+            usize buffer_size = 256 * 1024
+        );
+        no_copy_construct_no_assignment(binary_logger_t);
+        virtual ~binary_logger_t();
+
+        using base_logger_t::log;
+        virtual void log(const log_entry_t& entry) override;
+        bool is_open() const;
+        void flush();
+        void close();
+
+    private:
+        const std::string filename;
+        const usize buffer_size;
+        std::ofstream log_file;
+        std::mutex mutex;
+
+        std::vector<u8> buffer;
+
+        std::unordered_map<std::string, u64> world_name_ids;
+        std::unordered_map<std::thread::id, u64> thread_ids;
+        u64 next_string_id = 0;
+
+        // microseconds since the epoch, of the previous entry
+        i64 prev_time = 0;
+
+        // get the ID of an interned string, writing its definition first if
+        // it's new
+        u64 intern(
+            std::unordered_map<std::string, u64>& ids,
+            const std::string& s
+        );
+
+        u64 intern_thread(std::thread::id thread_id);
+
+        void write_string_record(u64 id, const std::string& s);
+
+        void write_varint(u64 v);
+
+        // * mutex must be locked.
+        void write_buffer();
+
+    };
+
+    // a decoded entry of a binary log
+    struct binary_log_record_t
+    {
+        log_level_t log_level = log_level_t::info;
+        std::string world_name;
+
+        // the thread ID as it was printed when logging
+        std::string thread_id;
+
+        std::string message;
+        std::chrono::system_clock::time_point time;
+    };
+
+    // reads the entries of a binary log written by binary_logger_t, one by
+    // one, without loading the whole file.
+    class binary_log_reader_t
+    {
+    public:
+        // * throws an exception if the file can't be opened or doesn't have a
+        //   valid header.
+        binary_log_reader_t(const std::string& filename);
+        no_copy_construct_no_assignment(binary_log_reader_t);
+        ~binary_log_reader_t() = default;
+
+        // the time the log was created
+        constexpr std::chrono::system_clock::time_point get_start_time() const
+        {
+            return start_time;
+        }
+
+        // read the next entry. returns false at the end of the log.
+        // * throws an exception if the log is corrupted or truncated in the
+        //   middle of a record.
+        bool next(binary_log_record_t& out_record);
+
+        // write every remaining entry as CSV, in the same format as
+        // csv_logger_t, and return the number of entries written.
+        usize write_csv(std::ostream& stream);
+
+    private:
+        const std::string filename;
+        std::ifstream log_file;
+        std::chrono::system_clock::time_point start_time;
+        std::vector<std::string> strings;
+        i64 prev_time = 0;
+
+        u8 read_u8();
+        u64 read_varint();
+        std::string read_string(usize length);
+        const std::string& string_at(u64 id) const;
+
+    };
+
+}
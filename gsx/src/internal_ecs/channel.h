@@ -0,0 +1,339 @@
+#pragma once
+
+#include <vector>
+#include <span>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <iterator>
+#include <utility>
+#include <type_traits>
+#include <stdexcept>
+#include <cstdint>
+
+#include "../internal_common/all.h"
+
+namespace gsx::ecs
+{
+
+    class world_t;
+    struct iteration_t;
+
+    // implemented by systems that want to receive events of type T emitted
+    // with world_t::emit<T>(). the system must also call subscribe<T>(this)
+    // (usually in its constructor).
+    template<typename T>
+    class event_handler_t
+    {
+    public:
+        virtual ~event_handler_t() = default;
+
+        // called at the start of an iteration with every event of type T
+        // emitted since the last delivery. the events emitted by a thread
+        // are in the order in which it emitted them, and they're grouped by
+        // the thread that emitted them. this may be invoked on a worker
+        // thread under the same rules as base_system_t::on_trigger_batch().
+        virtual void on_event(
+            world_t& world,
+            const iteration_t& iter,
+            std::span<const T> events
+        ) = 0;
+    };
+
+    class base_event_channel_t;
+
+    // type-erased interface of event_list_t, used by world_snapshot_t to keep
+    // the pending events of every channel without knowing their types.
+    class base_event_list_t
+    {
+    public:
+        virtual ~base_event_list_t() = default;
+
+        virtual usize size() const = 0;
+
+        // make an empty channel of the same event type, to restore the
+        // events into a world that doesn't have one
+        virtual std::unique_ptr<base_event_channel_t> make_channel() const = 0;
+    };
+
+    // type-erased interface of event_channel_t, used by the world to deliver
+    // the events of every channel without knowing their types.
+    class base_event_channel_t
+    {
+    public:
+        base_event_channel_t()
+            : id(next_id++)
+        {}
+
+        virtual ~base_event_channel_t() = default;
+
+        // make the events emitted so far ready for delivery, replacing the
+        // previously delivered ones, and return how many there are.
+        // * this must not be called while delivering.
+        virtual usize flip() = 0;
+
+        // invoke on_event() on a handler (an event_handler_t<T>*) with the
+        // events that are ready for delivery
+        virtual void deliver(
+            void* handler,
+            world_t& world,
+            const iteration_t& iter
+        ) = 0;
+
+        // copy the events emitted since the last flip(), in the order that
+        // flip() would put them in, for world_snapshot_t.
+        // * throws an exception if the type isn't copy constructible.
+        virtual std::unique_ptr<base_event_list_t> save_pending() = 0;
+
+        // replace the events emitted since the last flip() with copies of
+        // saved ones of the same type, or discard them if saved is null.
+        // * this must not be called while other threads are emitting.
+        virtual void restore_pending(const base_event_list_t* saved) = 0;
+
+    protected:
+        // unique across all channels, since a new channel may have the same
+        // address as a destroyed one
+        const u64 id;
+
+    private:
+        static inline std::atomic<u64> next_id = 0;
+
+    };
+
+    template<typename T>
+    class event_list_t;
+
+    // events of a single type, stored contiguously. every emitting thread
+    // gets a buffer of its own, like the command buffers of a world, so
+    // threads emitting the same type don't wait for each other. the buffers
+    // are merged when the events are made ready for delivery, and they're
+    // reused instead of reallocated, so emitting and delivering don't
+    // allocate once the buffers have grown to the usual number of events
+    // per iteration.
+    // * trivially copyable event types are the cheapest to emit and deliver.
+    template<typename T>
+    class event_channel_t : public base_event_channel_t
+    {
+    public:
+        event_channel_t() = default;
+        no_copy_construct_no_assignment(event_channel_t);
+
+        ~event_channel_t()
+        {
+            std::scoped_lock lock(mutex_lanes);
+            for (auto& lane : lanes)
+            {
+                lane->closed.store(true, std::memory_order_release);
+            }
+        }
+
+        // construct an event in place at the end of the calling thread's
+        // buffer. this can be called from any thread.
+        // * the buffer's lock is only ever contended by flip().
+        template<typename... Args>
+        void emit(Args&&... args)
+        {
+            lane_t& lane = current_lane();
+            std::scoped_lock lock(lane.mutex);
+            lane.pending.emplace_back(std::forward<Args>(args)...);
+        }
+
+        virtual usize flip() override
+        {
+            ready.clear();
+
+            std::scoped_lock lock(mutex_lanes);
+            for (auto& lane : lanes)
+            {
+                // * checked before the events are taken, since the thread
+                //   may still emit until it exits
+                lane->is_finished =
+                    lane->abandoned.load(std::memory_order_acquire);
+
+                std::scoped_lock lock_lane(lane->mutex);
+                if (ready.empty())
+                {
+                    // hand the lane the emptied buffer to reuse
+                    std::swap(ready, lane->pending);
+                }
+                else
+                {
+                    ready.insert(
+                        ready.end(),
+                        std::make_move_iterator(lane->pending.begin()),
+                        std::make_move_iterator(lane->pending.end())
+                    );
+                    lane->pending.clear();
+                }
+            }
+
+            // forget the lanes of the threads that have exited, which are
+            // empty now
+            std::erase_if(
+                lanes,
+                [](const std::shared_ptr<lane_t>& lane)
+                {
+                    return lane->is_finished;
+                }
+            );
+            return ready.size();
+        }
+
+        virtual void deliver(
+            void* handler,
+            world_t& world,
+            const iteration_t& iter
+        ) override
+        {
+            static_cast<event_handler_t<T>*>(handler)->on_event(
+                world,
+                iter,
+                std::span<const T>(ready)
+            );
+        }
+
+        virtual std::unique_ptr<base_event_list_t> save_pending() override
+        {
+            if constexpr (std::is_copy_constructible_v<T>)
+            {
+                auto saved = std::make_unique<event_list_t<T>>();
+
+                std::scoped_lock lock(mutex_lanes);
+                for (auto& lane : lanes)
+                {
+                    std::scoped_lock lock_lane(lane->mutex);
+                    saved->events.insert(
+                        saved->events.end(),
+                        lane->pending.begin(),
+                        lane->pending.end()
+                    );
+                }
+                return saved;
+            }
+            else
+            {
+                throw std::runtime_error(
+                    "the event type isn't copy constructible"
+                );
+            }
+        }
+
+        virtual void restore_pending(const base_event_list_t* saved) override
+        {
+            {
+                std::scoped_lock lock(mutex_lanes);
+                for (auto& lane : lanes)
+                {
+                    std::scoped_lock lock_lane(lane->mutex);
+                    lane->pending.clear();
+                }
+            }
+            if (!saved || saved->size() == 0)
+                return;
+
+            if constexpr (std::is_copy_constructible_v<T>)
+            {
+                // the saved events were copyable when they were saved
+                lane_t& lane = current_lane();
+                std::scoped_lock lock(lane.mutex);
+                auto& events =
+                    static_cast<const event_list_t<T>&>(*saved).events;
+                lane.pending.insert(
+                    lane.pending.end(),
+                    events.begin(),
+                    events.end()
+                );
+            }
+        }
+
+    private:
+        // the events emitted by a single thread since the last flip()
+        struct lane_t
+        {
+            std::mutex mutex;
+            std::vector<T> pending;
+
+            // set when the emitting thread exits
+            std::atomic<bool> abandoned = false;
+
+            // set when the channel is destroyed
+            std::atomic<bool> closed = false;
+
+            // whether the thread had exited when the lane was last emptied.
+            // * only accessed by flip().
+            bool is_finished = false;
+        };
+
+        std::mutex mutex_lanes;
+        std::vector<std::shared_ptr<lane_t>> lanes;
+
+        // events being delivered
+        std::vector<T> ready;
+
+        // get the lane of the calling thread, creating it on first use
+        lane_t& current_lane()
+        {
+            // the lanes of the calling thread, by channel ID. they're marked
+            // as abandoned when the thread exits, so that their channels can
+            // free them.
+            struct thread_lanes_t
+            {
+                std::vector<std::pair<u64, std::shared_ptr<lane_t>>> lanes;
+
+                ~thread_lanes_t()
+                {
+                    for (auto& [id, lane] : lanes)
+                    {
+                        lane->abandoned.store(true, std::memory_order_release);
+                    }
+                }
+            };
+            static thread_local thread_lanes_t tl_lanes;
+
+            for (auto& [lane_id, lane] : tl_lanes.lanes)
+            {
+                if (lane_id == id)
+                    return *lane;
+            }
+
+            // forget the lanes of destroyed channels
+            std::erase_if(
+                tl_lanes.lanes,
+                [](const auto& pair)
+                {
+                    return pair.second->closed.load(std::memory_order_acquire);
+                }
+            );
+
+            auto lane = std::make_shared<lane_t>();
+            {
+                std::scoped_lock lock(mutex_lanes);
+                lanes.push_back(lane);
+            }
+            tl_lanes.lanes.emplace_back(id, lane);
+            return *lane;
+        }
+
+    };
+
+    // events of type T copied out of an event_channel_t. see
+    // base_event_channel_t::save_pending().
+    template<typename T>
+    class event_list_t : public base_event_list_t
+    {
+    public:
+        std::vector<T> events;
+
+        virtual usize size() const override
+        {
+            return events.size();
+        }
+
+        virtual std::unique_ptr<base_event_channel_t> make_channel()
+            const override
+        {
+            return std::make_unique<event_channel_t<T>>();
+        }
+    };
+
+}
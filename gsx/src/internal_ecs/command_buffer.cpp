@@ -0,0 +1,219 @@
+#include "command_buffer.h"
+
+#include <algorithm>
+#include <atomic>
+
+namespace gsx::ecs
+{
+
+    // orders the commands recorded outside of the systems across buffers
+    static std::atomic<u64> next_sequence = 1;
+
+    command_buffer_t::command_buffer_t(u32 index)
+        : index(index)
+    {}
+
+    command_buffer_t::~command_buffer_t()
+    {
+        clear();
+    }
+
+    pending_entity_t command_buffer_t::create()
+    {
+        pending_entity_t entity{ index, n_created++, epoch };
+        push(
+            kind_t::create,
+            target_t{ null_entity, true, entity },
+            nullptr,
+            nullptr
+        );
+        return entity;
+    }
+
+    void command_buffer_t::destroy(entity_t entity)
+    {
+        push(kind_t::destroy, target_t{ entity }, nullptr, nullptr);
+    }
+
+    usize command_buffer_t::play_back(
+        std::vector<std::unique_ptr<command_buffer_t>>& buffers,
+        registry_t& registry
+    )
+    {
+        usize n_commands = 0;
+        for (auto& buffer : buffers)
+        {
+            n_commands += buffer->commands.size();
+        }
+        if (n_commands == 0)
+            return 0;
+
+        // clears the buffers on every path, so that if a command throws, the
+        // ones that were already made aren't played back again
+        struct clear_guard_t
+        {
+            std::vector<std::unique_ptr<command_buffer_t>>& buffers;
+
+            ~clear_guard_t()
+            {
+                for (auto& buffer : buffers)
+                {
+                    buffer->clear();
+                }
+            }
+        } clear_guard{ buffers };
+
+        // every command by its buffer and its position in the buffer
+        std::vector<std::pair<u32, usize>> order;
+        order.reserve(n_commands);
+        for (auto& buffer : buffers)
+        {
+            buffer->created.assign(buffer->n_created, null_entity);
+            for (usize i = 0; i < buffer->commands.size(); i++)
+            {
+                order.emplace_back(buffer->index, i);
+            }
+        }
+
+        // * a key of a system only ever appears in one buffer, where the
+        //   stable sort keeps the commands in the order they were recorded.
+        //   the commands recorded outside of the systems share a key, and
+        //   are ordered by their sequence instead.
+        std::stable_sort(
+            order.begin(),
+            order.end(),
+            [&buffers](
+                const std::pair<u32, usize>& a,
+                const std::pair<u32, usize>& b
+                )
+            {
+                const command_t& lhs = buffers[a.first]->commands[a.second];
+                const command_t& rhs = buffers[b.first]->commands[b.second];
+                if (lhs.key != rhs.key)
+                    return lhs.key < rhs.key;
+                return lhs.sequence < rhs.sequence;
+            }
+        );
+
+        auto resolve = [&buffers](const target_t& target)
+        {
+            if (!target.is_pending)
+                return target.entity;
+
+            if (target.pending.buffer >= buffers.size())
+                return null_entity;
+
+            const command_buffer_t& buffer = *buffers[target.pending.buffer];
+            if (target.pending.epoch != buffer.epoch)
+                return null_entity;
+
+            auto& created = buffer.created;
+            return (target.pending.index < created.size())
+                ? created[target.pending.index]
+                : null_entity;
+        };
+
+        for (auto [buffer_index, command_index] : order)
+        {
+            command_buffer_t& buffer = *buffers[buffer_index];
+            command_t& command = buffer.commands[command_index];
+
+            if (command.kind == kind_t::create)
+            {
+                buffer.created[command.target.pending.index] =
+                    registry.create();
+                continue;
+            }
+
+            entity_t entity = resolve(command.target);
+            if (!registry.alive(entity))
+                continue;
+
+            switch (command.kind)
+            {
+            case kind_t::destroy:
+                registry.destroy(entity);
+                break;
+
+            case kind_t::add:
+            case kind_t::set:
+                command.ops->apply(
+                    registry,
+                    entity,
+                    command.value,
+                    command.kind == kind_t::add
+                );
+                break;
+
+            case kind_t::remove:
+                command.ops->remove(registry, entity);
+                break;
+
+            default:
+                break;
+            }
+        }
+
+        return order.size();
+    }
+
+    void command_buffer_t::push(
+        kind_t kind,
+        const target_t& target,
+        const ops_t* ops,
+        void* value
+    )
+    {
+        const u64 sequence = (key.system == key_t::no_system)
+            ? next_sequence.fetch_add(1, std::memory_order_relaxed)
+            : 0;
+        commands.push_back(
+            command_t{ kind, key, sequence, target, ops, value }
+        );
+    }
+
+    void* command_buffer_t::allocate(usize size, usize align)
+    {
+        while (true)
+        {
+            if (block_index == blocks.size())
+            {
+                usize new_size = std::max(block_size, size + align);
+                blocks.push_back(block_t{
+                    std::make_unique<std::byte[]>(new_size),
+                    new_size
+                });
+            }
+
+            block_t& block = blocks[block_index];
+            uintptr_t start = (uintptr_t)(block.data.get() + block_used);
+            uintptr_t aligned = (start + align - 1) & ~(uintptr_t)(align - 1);
+            usize offset = block_used + (usize)(aligned - start);
+            if (offset + size <= block.size)
+            {
+                block_used = offset + size;
+                return block.data.get() + offset;
+            }
+
+            block_index++;
+            block_used = 0;
+        }
+    }
+
+    void command_buffer_t::clear()
+    {
+        for (auto& command : commands)
+        {
+            if (command.value)
+            {
+                command.ops->destroy(command.value);
+            }
+        }
+        commands.clear();
+        n_created = 0;
+        epoch++;
+        block_index = 0;
+        block_used = 0;
+    }
+
+}
@@ -0,0 +1,293 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <compare>
+#include <utility>
+#include <type_traits>
+#include <cstddef>
+#include <cstdint>
+
+#include "entity.h"
+#include "component.h"
+#include "registry.h"
+#include "../internal_common/all.h"
+
+namespace gsx::ecs
+{
+
+    // an entity created through a command buffer. it only becomes an
+    // entity_t when the buffer is played back, but components can be added
+    // to it before that.
+    // * the handle expires when the buffer is played back, after which
+    //   commands on it are skipped like the ones on dead entities.
+    struct pending_entity_t
+    {
+        // index of the buffer that created the entity
+        u32 buffer;
+
+        // index of the entity among the ones the buffer created
+        u32 index;
+
+        // number of times the buffer was cleared before the entity was
+        // created
+        u32 epoch;
+    };
+
+    // records structural changes to a registry (creating and destroying
+    // entities, and adding, removing and setting components) so that they
+    // can be made later, when nothing else is accessing the registry. a
+    // world keeps a buffer per thread, so systems running in parallel can
+    // record changes without locking (see world_t::get_commands()).
+    // * every command is tagged with where it was recorded (see key_t), and
+    //   the commands of all the buffers are played back sorted by their
+    //   keys, so the result doesn't depend on which threads the systems ran
+    //   on or in which order they finished. commands recorded outside of
+    //   the systems are played back last, in the order they were recorded.
+    // * commands on entities that are no longer alive when they're played
+    //   back are skipped, like destroying an entity that another system
+    //   has destroyed already.
+    // * setting a component only replaces one that the entity already has,
+    //   while adding it attaches it if the entity doesn't have one.
+    // * component values are kept in blocks that are reused after every
+    //   playback, so recording doesn't allocate once the blocks are large
+    //   enough.
+    class command_buffer_t
+    {
+    public:
+        // where a command was recorded
+        struct key_t
+        {
+            // the system index of commands recorded outside of the systems
+            static constexpr u64 no_system = ~(u64)0;
+
+            // order of the system in the group that was running
+            u64 system = no_system;
+
+            // bumped when the system starts and finishes a
+            // world_t::parallel_for(), so commands recorded after a loop
+            // are played back after the ones of its ranges
+            u64 phase = 0;
+
+            // 0 for the system itself, or 1 + the start of a range of
+            // world_t::parallel_for() run by the system
+            u64 range = 0;
+
+            auto operator<=>(const key_t&) const = default;
+        };
+
+        // * index is the position of the buffer in the list it's played
+        //   back with.
+        command_buffer_t(u32 index);
+        no_copy_construct_no_assignment(command_buffer_t);
+        ~command_buffer_t();
+
+        constexpr u32 get_index() const
+        {
+            return index;
+        }
+
+        // number of recorded commands
+        constexpr usize size() const
+        {
+            return commands.size();
+        }
+
+        pending_entity_t create();
+
+        void destroy(entity_t entity);
+
+        template<typename T, typename... Args>
+        void add(entity_t entity, Args&&... args)
+        {
+            push_value<T>(
+                kind_t::add,
+                target_t{ entity },
+                std::forward<Args>(args)...
+            );
+        }
+
+        template<typename T, typename... Args>
+        void add(pending_entity_t entity, Args&&... args)
+        {
+            push_value<T>(
+                kind_t::add,
+                target_t{ null_entity, true, entity },
+                std::forward<Args>(args)...
+            );
+        }
+
+        template<typename T>
+        void remove(entity_t entity)
+        {
+            push(kind_t::remove, target_t{ entity }, &ops_of<T>(), nullptr);
+        }
+
+        template<typename T, typename... Args>
+        void set(entity_t entity, Args&&... args)
+        {
+            push_value<T>(
+                kind_t::set,
+                target_t{ entity },
+                std::forward<Args>(args)...
+            );
+        }
+
+        // the key that the following commands are tagged with.
+        // * these functions are called internally by world_t.
+        constexpr key_t get_key() const
+        {
+            return key;
+        }
+
+        void set_key(key_t key)
+        {
+            this->key = key;
+        }
+
+        // make the changes recorded in a list of buffers, where the buffer
+        // at index i has an index of i, and clear them. returns the number
+        // of commands played back.
+        // * if a command throws, like when the registry runs out of entity
+        //   IDs, the rest of the commands are dropped and the exception is
+        //   rethrown.
+        static usize play_back(
+            std::vector<std::unique_ptr<command_buffer_t>>& buffers,
+            registry_t& registry
+        );
+
+    private:
+        enum class kind_t : u8
+        {
+            create,
+            destroy,
+            add,
+            remove,
+            set
+        };
+
+        // type-erased operations on a component type
+        struct ops_t
+        {
+            // move a value into a component of an entity. if add is false,
+            // this only replaces an existing component.
+            void (*apply)(
+                registry_t& registry,
+                entity_t entity,
+                void* value,
+                bool add
+                );
+
+            void (*remove)(registry_t& registry, entity_t entity);
+
+            void (*destroy)(void* value);
+        };
+
+        // an entity that's alive or pending
+        struct target_t
+        {
+            entity_t entity = null_entity;
+            bool is_pending = false;
+            pending_entity_t pending{};
+        };
+
+        struct command_t
+        {
+            kind_t kind;
+            key_t key;
+
+            // when the command was recorded, for commands recorded outside
+            // of the systems. 0 for the others, which are ordered by their
+            // position in their buffer.
+            u64 sequence;
+
+            target_t target;
+            const ops_t* ops;
+
+            // the component value, for adding and setting
+            void* value;
+        };
+
+        // memory that component values are constructed in
+        struct block_t
+        {
+            std::unique_ptr<std::byte[]> data;
+            usize size;
+        };
+
+        static constexpr usize block_size = 4096;
+
+        const u32 index;
+        key_t key;
+        std::vector<command_t> commands;
+        u32 n_created = 0;
+
+        // bumped every time the buffer is cleared, so that the pending
+        // entities of earlier playbacks can be told apart
+        u32 epoch = 0;
+
+        // the entities created by the last playback, indexed like the
+        // pending entities
+        std::vector<entity_t> created;
+
+        std::vector<block_t> blocks;
+        usize block_index = 0;
+        usize block_used = 0;
+
+        template<typename T>
+        static const ops_t& ops_of()
+        {
+            static const ops_t ops{
+                [](registry_t& registry, entity_t entity, void* value, bool add)
+                {
+                    T& v = *static_cast<T*>(value);
+                    if (add)
+                    {
+                        registry.add<T>(entity, std::move(v));
+                    }
+                    else if (T* component = registry.try_get<T>(entity))
+                    {
+                        *component = std::move(v);
+                    }
+                },
+                [](registry_t& registry, entity_t entity)
+                {
+                    registry.remove<T>(entity);
+                },
+                [](void* value)
+                {
+                    std::destroy_at(static_cast<T*>(value));
+                }
+            };
+            return ops;
+        }
+
+        template<typename T, typename... Args>
+        void push_value(kind_t kind, const target_t& target, Args&&... args)
+        {
+            static_assert(
+                std::is_move_constructible_v<T>,
+                "components must be move constructible"
+            );
+
+            void* value = allocate(sizeof(T), alignof(T));
+            new(value) T(std::forward<Args>(args)...);
+            push(kind, target, &ops_of<T>(), value);
+        }
+
+        void push(
+            kind_t kind,
+            const target_t& target,
+            const ops_t* ops,
+            void* value
+        );
+
+        void* allocate(usize size, usize align);
+
+        // destroy the values of the commands and forget them, keeping the
+        // blocks for reuse
+        void clear();
+
+    };
+
+}
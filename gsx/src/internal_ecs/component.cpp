@@ -0,0 +1,14 @@
+#include "component.h"
+
+#include <atomic>
+
+namespace gsx::ecs
+{
+
+    type_id_t next_type_id()
+    {
+        static std::atomic<type_id_t> counter = 0;
+        return counter.fetch_add(1, std::memory_order_relaxed);
+    }
+
+}
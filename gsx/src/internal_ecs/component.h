@@ -0,0 +1,101 @@
+#pragma once
+
+#include <new>
+#include <memory>
+#include <type_traits>
+#include <cstdint>
+
+#include "../internal_common/all.h"
+
+namespace gsx::ecs
+{
+
+    // a small dense identifier that is unique for every type it's requested
+    // for. identifiers are handed out at runtime starting from 0 in the order
+    // in which the types are first seen.
+    using type_id_t = u32;
+
+    // for internal use only. use type_id_of() instead.
+    type_id_t next_type_id();
+
+    template<typename T>
+    type_id_t type_id_of()
+    {
+        if constexpr (!std::is_same_v<T, std::remove_cvref_t<T>>)
+        {
+            return type_id_of<std::remove_cvref_t<T>>();
+        }
+        else
+        {
+            static const type_id_t id = next_type_id();
+            return id;
+        }
+    }
+
+    // type-erased information about a component type, used by archetypes to
+    // store components of arbitrary types in raw memory.
+    struct component_info_t
+    {
+        type_id_t id;
+        usize size;
+        usize align;
+
+        // whether the type can be moved around with memcpy() and doesn't need
+        // to be destroyed
+        bool trivial;
+
+        // move-construct an instance at dst from the one at src, and destroy
+        // the instance at src
+        void (*relocate)(void* dst, void* src);
+
+        // destroy the instance at ptr
+        void (*destroy)(void* ptr);
+
+        // copy-construct an instance at dst from the one at src, or nullptr
+        // if the type isn't copy constructible. see world_snapshot_t.
+        void (*copy)(void* dst, const void* src);
+    };
+
+    // * T must be move constructible.
+    template<typename T>
+    const component_info_t& component_info_of()
+    {
+        static_assert(
+            std::is_move_constructible_v<T>,
+            "components must be move constructible"
+        );
+
+        static const component_info_t info{
+            type_id_of<T>(),
+            sizeof(T),
+            alignof(T),
+            std::is_trivially_copyable_v<T>,
+            [](void* dst, void* src)
+            {
+                T* src_t = static_cast<T*>(src);
+                new(dst) T(std::move(*src_t));
+                std::destroy_at(src_t);
+            },
+            [](void* ptr)
+            {
+                std::destroy_at(static_cast<T*>(ptr));
+            },
+            []()
+            {
+                if constexpr (std::is_copy_constructible_v<T>)
+                {
+                    return +[](void* dst, const void* src)
+                    {
+                        new(dst) T(*static_cast<const T*>(src));
+                    };
+                }
+                else
+                {
+                    return (void (*)(void*, const void*))nullptr;
+                }
+            }()
+        };
+        return info;
+    }
+
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+
+#include "../internal_common/all.h"
+
+namespace gsx::ecs
+{
+
+    // an entity is nothing but an identifier that components can be attached
+    // to. entities are created and destroyed by a registry_t.
+    // * an entity identifier is a generational handle: the low bits are the
+    //   index of a slot in the registry, and the high bits are the
+    //   generation of the slot. the registry recycles the slots of destroyed
+    //   entities with the next generation, so a handle to a destroyed entity
+    //   doesn't refer to the new entity in its slot.
+    // * handles are 32-bit by default, with up to about a million entities
+    //   alive at a time and 4096 generations per slot before a handle is
+    //   repeated. define GSX_ECS_64_BIT_ENTITIES for 64-bit handles with 32
+    //   bits for each.
+#if defined(GSX_ECS_64_BIT_ENTITIES)
+    using entity_t = u64;
+    inline constexpr u32 entity_index_bits = 32;
+#else
+    using entity_t = u32;
+    inline constexpr u32 entity_index_bits = 20;
+#endif
+
+    inline constexpr u32 entity_generation_bits =
+        8 * sizeof(entity_t) - entity_index_bits;
+
+    inline constexpr entity_t entity_index_mask =
+        ((entity_t)1 << entity_index_bits) - 1;
+
+    inline constexpr entity_t entity_generation_mask =
+        ((entity_t)1 << entity_generation_bits) - 1;
+
+    // an identifier that never refers to a valid entity
+    inline constexpr entity_t null_entity = ~(entity_t)0;
+
+    constexpr entity_t entity_index(entity_t entity)
+    {
+        return entity & entity_index_mask;
+    }
+
+    constexpr entity_t entity_generation(entity_t entity)
+    {
+        return entity >> entity_index_bits;
+    }
+
+    constexpr entity_t make_entity(entity_t index, entity_t generation)
+    {
+        return (index & entity_index_mask)
+            | ((generation & entity_generation_mask) << entity_index_bits);
+    }
+
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <any>
+#include <utility>
 #include <cstdint>
 
 #include "../internal_common/all.h"
@@ -19,6 +20,13 @@ namespace gsx::ecs
 
         event_t(event_type_t type, const std::any& data);
 
+        // construct the data in place as a T from the given arguments
+        template<typename T, typename... Args>
+        event_t(event_type_t type, std::in_place_type_t<T>, Args&&... args)
+            : type(type),
+            data(std::in_place_type<T>, std::forward<Args>(args)...)
+        {}
+
     };
 
 }
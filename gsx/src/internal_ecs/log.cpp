@@ -1,20 +1,113 @@
 #include "log.h"
 
 #include <stdexcept>
+#include <algorithm>
+#include <utility>
+#include <unordered_set>
 
 namespace gsx::ecs
 {
 
+    log_message_t::log_message_t(const char* text)
+        : text(text)
+    {}
+
+    log_message_t::log_message_t(std::string text)
+        : text(std::move(text))
+    {}
+
+    log_message_t::log_message_t(const log_message_t& other)
+        : text(other.text), fmt(other.fmt), ops(other.ops)
+    {
+        if (ops)
+        {
+            ops->copy(storage, other.storage);
+        }
+    }
+
+    log_message_t::log_message_t(log_message_t&& other) noexcept
+        : text(std::move(other.text)), fmt(other.fmt), ops(other.ops)
+    {
+        if (ops)
+        {
+            ops->move(storage, other.storage);
+        }
+    }
+
+    log_message_t& log_message_t::operator=(const log_message_t& other)
+    {
+        if (this != &other)
+        {
+            reset();
+            text = other.text;
+            fmt = other.fmt;
+            ops = other.ops;
+            if (ops)
+            {
+                ops->copy(storage, other.storage);
+            }
+        }
+        return *this;
+    }
+
+    log_message_t& log_message_t::operator=(log_message_t&& other) noexcept
+    {
+        if (this != &other)
+        {
+            reset();
+            text = std::move(other.text);
+            fmt = other.fmt;
+            ops = other.ops;
+            if (ops)
+            {
+                ops->move(storage, other.storage);
+            }
+        }
+        return *this;
+    }
+
+    log_message_t::~log_message_t()
+    {
+        reset();
+    }
+
+    std::string log_message_t::str() const
+    {
+        if (!ops)
+            return text;
+        return ops->format(fmt, storage);
+    }
+
+    void log_message_t::reset()
+    {
+        if (ops)
+        {
+            ops->destroy(storage);
+            ops = nullptr;
+        }
+    }
+
+    std::string_view intern_log_name(std::string_view name)
+    {
+        // the nodes of an unordered_set don't move, so the views stay valid
+        static std::mutex mutex;
+        static std::unordered_set<std::string> names;
+
+        std::scoped_lock lock(mutex);
+        return *names.emplace(name).first;
+    }
+
     log_entry_t::log_entry_t(
         log_level_t log_level,
-        const std::string& world_name,
+        std::string_view world_name,
         std::thread::id thread_id,
-        const std::string& message
+        log_message_t message
     )
         : log_level(log_level),
         world_name(world_name),
         thread_id(thread_id),
-        message(message)
+        message(std::move(message)),
+        time(std::chrono::system_clock::now())
     {}
 
     ostream_logger_t::ostream_logger_t(std::ostream& stream)
@@ -30,12 +123,12 @@ namespace gsx::ecs
 
     ostream_logger_t::~ostream_logger_t()
     {
-        std::scoped_lock(mutex);
+        std::scoped_lock lock(mutex);
     }
 
     void ostream_logger_t::log(const log_entry_t& entry)
     {
-        std::scoped_lock(mutex);
+        std::scoped_lock lock(mutex);
 
         if (!stream)
         {
@@ -44,7 +137,7 @@ namespace gsx::ecs
             );
         }
 
-        stream << std::format("{} | ", str::from_time());
+        stream << std::format("{} | ", str::from_time(entry.time));
 
         switch (entry.log_level)
         {
@@ -64,9 +157,9 @@ namespace gsx::ecs
             break;
         }
 
-        stream << std::format("{} | ", entry.world_name);
+        stream << entry.world_name << " | ";
         stream << entry.thread_id << " | ";
-        stream << entry.message << '\n';
+        stream << entry.message.str() << '\n';
 
         stream.flush();
     }
@@ -91,12 +184,12 @@ namespace gsx::ecs
 
     csv_logger_t::~csv_logger_t()
     {
-        std::scoped_lock(mutex);
+        std::scoped_lock lock(mutex);
     }
 
     void csv_logger_t::log(const log_entry_t& entry)
     {
-        std::scoped_lock(mutex);
+        std::scoped_lock lock(mutex);
 
         if (!log_file)
         {
@@ -108,17 +201,17 @@ namespace gsx::ecs
 
         // replace " with "" because CSV
         std::string world_name_copy = str::replace(
-            entry.world_name,
+            std::string(entry.world_name),
             "\"",
             "\"\""
         );
         std::string message_copy = str::replace(
-            entry.message,
+            entry.message.str(),
             "\"",
             "\"\""
         );
 
-        log_file << '"' << str::from_time() << "\",";
+        log_file << '"' << str::from_time(entry.time) << "\",";
 
         switch (entry.log_level)
         {
@@ -152,8 +245,240 @@ namespace gsx::ecs
 
     void csv_logger_t::close()
     {
-        std::scoped_lock(mutex);
+        std::scoped_lock lock(mutex);
         log_file.close();
     }
 
+    static std::atomic<u64> next_async_logger_id = 0;
+
+    async_logger_t::async_logger_t(
+        std::shared_ptr<base_logger_t> target,
+        usize ring_capacity,
+        log_overflow_t overflow,
+        f64 flush_interval
+    )
+        : id(next_async_logger_id++),
+        target(target),
+        ring_capacity(std::max<usize>(1, ring_capacity)),
+        overflow(overflow),
+        flush_interval(flush_interval)
+    {
+        if (target == nullptr)
+            throw std::runtime_error("the target logger must not be null");
+
+        thread = std::jthread(
+            [this]()
+            {
+                std::unique_lock lock(mutex_wake);
+                while (!stopping)
+                {
+                    cv_wake.wait_for(
+                        lock,
+                        std::chrono::duration<f64>(this->flush_interval)
+                    );
+
+                    lock.unlock();
+                    flush();
+                    lock.lock();
+                }
+            }
+        );
+    }
+
+    async_logger_t::~async_logger_t()
+    {
+        {
+            std::scoped_lock lock(mutex_wake);
+            stopping = true;
+        }
+        cv_wake.notify_one();
+        thread.join();
+
+        flush();
+
+        std::scoped_lock lock(mutex_rings);
+        for (auto& ring : rings)
+        {
+            ring->closed.store(true, std::memory_order_release);
+        }
+    }
+
+    void async_logger_t::log(const log_entry_t& entry)
+    {
+        ring_t& ring = current_ring();
+        if (auto* slot = reserve(ring))
+        {
+            *slot = entry;
+            push(ring);
+        }
+    }
+
+    void async_logger_t::log(log_entry_t&& entry)
+    {
+        ring_t& ring = current_ring();
+        if (auto* slot = reserve(ring))
+        {
+            *slot = std::move(entry);
+            push(ring);
+        }
+    }
+
+    void async_logger_t::flush()
+    {
+        std::scoped_lock lock(mutex_drain);
+        drain();
+    }
+
+    u64 async_logger_t::get_n_dropped() const
+    {
+        return n_dropped.load(std::memory_order_relaxed);
+    }
+
+    async_logger_t::ring_t& async_logger_t::current_ring()
+    {
+        // the rings of the calling thread, by logger ID. they're marked as
+        // abandoned when the thread exits, so that their loggers can free
+        // them.
+        struct thread_rings_t
+        {
+            std::vector<std::pair<u64, std::shared_ptr<ring_t>>> rings;
+
+            ~thread_rings_t()
+            {
+                for (auto& [id, ring] : rings)
+                {
+                    ring->abandoned.store(true, std::memory_order_release);
+                }
+            }
+        };
+        static thread_local thread_rings_t tl_rings;
+
+        for (auto& [ring_id, ring] : tl_rings.rings)
+        {
+            if (ring_id == id)
+                return *ring;
+        }
+
+        // forget the rings of destroyed loggers
+        std::erase_if(
+            tl_rings.rings,
+            [](const auto& pair)
+            {
+                return pair.second->closed.load(std::memory_order_acquire);
+            }
+        );
+
+        auto ring = std::make_shared<ring_t>();
+        ring->slots.resize(ring_capacity);
+        ring->thread_id = std::this_thread::get_id();
+        {
+            std::scoped_lock lock(mutex_rings);
+            rings.push_back(ring);
+        }
+        tl_rings.rings.emplace_back(id, ring);
+        return *ring;
+    }
+
+    std::optional<log_entry_t>* async_logger_t::reserve(ring_t& ring)
+    {
+        usize head = ring.head.load(std::memory_order_relaxed);
+        while (head - ring.tail.load(std::memory_order_acquire)
+            >= ring.slots.size())
+        {
+            if (overflow == log_overflow_t::drop)
+            {
+                ring.n_dropped.fetch_add(1, std::memory_order_relaxed);
+                n_dropped.fetch_add(1, std::memory_order_relaxed);
+                return nullptr;
+            }
+
+            // wake the background thread up and wait for it to make room
+            cv_wake.notify_one();
+            std::this_thread::yield();
+        }
+        return &ring.slots[head % ring.slots.size()];
+    }
+
+    void async_logger_t::push(ring_t& ring)
+    {
+        usize head = ring.head.load(std::memory_order_relaxed);
+        ring.head.store(head + 1, std::memory_order_release);
+    }
+
+    void async_logger_t::drain()
+    {
+        std::vector<std::shared_ptr<ring_t>> rings_copy;
+        {
+            std::scoped_lock lock(mutex_rings);
+            rings_copy = rings;
+        }
+
+        batch.clear();
+        for (auto& ring : rings_copy)
+        {
+            usize tail = ring->tail.load(std::memory_order_relaxed);
+            usize head = ring->head.load(std::memory_order_acquire);
+            for (; tail < head; tail++)
+            {
+                auto& slot = ring->slots[tail % ring->slots.size()];
+                batch.push_back(std::move(*slot));
+                slot.reset();
+            }
+            ring->tail.store(tail, std::memory_order_release);
+
+            u64 ring_dropped = ring->n_dropped.exchange(
+                0,
+                std::memory_order_relaxed
+            );
+            if (ring_dropped > 0)
+            {
+                batch.push_back(log_entry_t(
+                    log_level_t::warning,
+                    "",
+                    ring->thread_id,
+                    std::format(
+                        "dropped {} log entries because the thread logged "
+                        "faster than they could be written",
+                        ring_dropped
+                    )
+                ));
+            }
+        }
+
+        // entries from different threads are interleaved by time
+        std::stable_sort(
+            batch.begin(),
+            batch.end(),
+            [](const log_entry_t& a, const log_entry_t& b)
+            {
+                return a.time < b.time;
+            }
+        );
+
+        for (auto& entry : batch)
+        {
+            try
+            {
+                target->log(entry);
+            }
+            catch (const std::exception&)
+            {
+                // there's nowhere else to report the error, and the logging
+                // threads have already moved on
+            }
+        }
+
+        // free the rings of the threads that have exited, once they're empty
+        std::scoped_lock lock(mutex_rings);
+        std::erase_if(
+            rings,
+            [](const std::shared_ptr<ring_t>& ring)
+            {
+                return ring->abandoned.load(std::memory_order_acquire)
+                    && ring->tail.load(std::memory_order_relaxed)
+                    == ring->head.load(std::memory_order_acquire);
+            }
+        );
+    }
+
 }
@@ -3,17 +3,34 @@
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <string_view>
+#include <format>
+#include <tuple>
+#include <type_traits>
+#include <new>
+#include <cstddef>
+#include <vector>
+#include <memory>
+#include <optional>
+#include <chrono>
 #include <thread>
 #include <mutex>
+#include <condition_variable>
+#include <atomic>
 
 #include "../internal_common/all.h"
 #include "../internal_str/all.h"
 
 // for internal use only. use world_t::log() instead.
-#define gsx_log(world_ptr, log_level, message) \
+// * the arguments after log_level are either a plain message, or a format
+//   string followed by its arguments (see log_message_t).
+#define gsx_log(world_ptr, log_level, ...) \
 if (log_level <= world_ptr->max_log_level) \
 logger->log(log_entry_t(\
-    log_level, world_ptr->name, std::this_thread::get_id(), message\
+    log_level, \
+    world_ptr->log_name, \
+    std::this_thread::get_id(), \
+    log_message_t(__VA_ARGS__)\
 ))
 
 namespace gsx::ecs
@@ -27,19 +44,175 @@ namespace gsx::ecs
         verbose
     };
 
+    // a log message, either as plain text, or as a format string along with
+    // its arguments. formatting is deferred until a logger actually reads
+    // the message with str(), so the thread that logs it only pays for
+    // copying the arguments into a small inline buffer, and an
+    // async_logger_t moves the formatting off to its background thread.
+    // * the format string is checked at compile time, and it must outlive the
+    //   message, which is always the case for string literals.
+    // * the arguments are copied by value (C strings are copied into
+    //   std::string), so other pointers and views among them must stay valid
+    //   until the message is read.
+    class log_message_t
+    {
+    public:
+        log_message_t(const char* text);
+        log_message_t(std::string text);
+
+        template<typename... Args>
+            requires (sizeof...(Args) > 0)
+        log_message_t(std::format_string<Args...> fmt, Args&&... args)
+            : fmt(fmt.get()), ops(&ops_of<std::tuple<stored_t<Args>...>>())
+        {
+            using tuple_t = std::tuple<stored_t<Args>...>;
+            if constexpr (fits_inline<tuple_t>)
+            {
+                new(storage) tuple_t(std::forward<Args>(args)...);
+            }
+            else
+            {
+                new(storage) tuple_t*(new tuple_t(std::forward<Args>(args)...));
+            }
+        }
+
+        log_message_t(const log_message_t& other);
+        log_message_t(log_message_t&& other) noexcept;
+        log_message_t& operator=(const log_message_t& other);
+        log_message_t& operator=(log_message_t&& other) noexcept;
+        ~log_message_t();
+
+        // get the formatted message
+        std::string str() const;
+
+    private:
+        // functions that work on the captured arguments of a given type
+        struct ops_t
+        {
+            std::string(*format)(std::string_view fmt, const void* storage);
+            void(*copy)(void* dst_storage, const void* src_storage);
+            void(*move)(void* dst_storage, void* src_storage);
+            void(*destroy)(void* storage);
+        };
+
+        // how an argument of type T is stored
+        template<typename T>
+        using stored_t = std::conditional_t<
+            std::is_same_v<std::decay_t<T>, const char*>
+            || std::is_same_v<std::decay_t<T>, char*>,
+            std::string,
+            std::decay_t<T>
+        >;
+
+        // arguments that don't fit in here are allocated separately
+        static constexpr usize inline_bytes = 64;
+
+        template<typename T>
+        static constexpr bool fits_inline =
+            sizeof(T) <= inline_bytes
+            && alignof(T) <= alignof(std::max_align_t);
+
+        // plain text, used when there are no arguments
+        std::string text;
+
+        std::string_view fmt;
+
+        // nullptr if there are no arguments
+        const ops_t* ops = nullptr;
+
+        // the arguments as a std::tuple, or a pointer to one if it doesn't
+        // fit inline
+        alignas(std::max_align_t) std::byte storage[inline_bytes];
+
+        template<typename T>
+        static const T& args_in(const void* storage)
+        {
+            if constexpr (fits_inline<T>)
+                return *std::launder(static_cast<const T*>(storage));
+            else
+                return **static_cast<T* const*>(storage);
+        }
+
+        template<typename T>
+        static const ops_t& ops_of()
+        {
+            static constexpr ops_t ops{
+                [](std::string_view fmt, const void* storage)
+                {
+                    return std::apply(
+                        [fmt](const auto&... args)
+                        {
+                            return std::vformat(
+                                fmt,
+                                std::make_format_args(args...)
+                            );
+                        },
+                        args_in<T>(storage)
+                    );
+                },
+                [](void* dst_storage, const void* src_storage)
+                {
+                    if constexpr (fits_inline<T>)
+                        new(dst_storage) T(args_in<T>(src_storage));
+                    else
+                        new(dst_storage) T*(new T(args_in<T>(src_storage)));
+                },
+                [](void* dst_storage, void* src_storage)
+                {
+                    if constexpr (fits_inline<T>)
+                    {
+                        new(dst_storage) T(std::move(
+                            *std::launder(static_cast<T*>(src_storage))
+                        ));
+                    }
+                    else
+                    {
+                        T*& src = *static_cast<T**>(src_storage);
+                        new(dst_storage) T*(src);
+                        src = nullptr;
+                    }
+                },
+                [](void* storage)
+                {
+                    if constexpr (fits_inline<T>)
+                        std::launder(static_cast<T*>(storage))->~T();
+                    else
+                        delete *static_cast<T**>(storage);
+                }
+            };
+            return ops;
+        }
+
+        void reset();
+
+    };
+
+    // get a copy of a name that's kept until the process exits, so that log
+    // entries can refer to it without copying it. every world interns its
+    // name once when it's created.
+    std::string_view intern_log_name(std::string_view name);
+
     class log_entry_t
     {
     public:
         log_level_t log_level;
-        std::string world_name;
+
+        // * not owned by the entry, so it must outlive the entry, like string
+        //   literals and the names returned by intern_log_name() do.
+        std::string_view world_name;
+
         std::thread::id thread_id;
-        std::string message;
+        log_message_t message;
+
+        // when the entry was made, which is not necessarily when a logger
+        // writes it
+        std::chrono::system_clock::time_point time;
 
         log_entry_t(
             log_level_t log_level,
-            const std::string& world_name,
+            std::string_view world_name,
             std::thread::id thread_id,
-            const std::string& message
+            log_message_t message
         );
 
     };
@@ -52,6 +225,14 @@ namespace gsx::ecs
         virtual ~base_logger_t() = default;
         virtual void log(const log_entry_t& entry) = 0;
 
+        // log an entry that the caller doesn't need anymore. loggers that
+        // keep entries, like async_logger_t, can move it instead of copying
+        // it.
+        virtual void log(log_entry_t&& entry)
+        {
+            log(static_cast<const log_entry_t&>(entry));
+        }
+
     };
 
     class ostream_logger_t : public base_logger_t
@@ -63,6 +244,7 @@ namespace gsx::ecs
         no_copy_construct_no_assignment(ostream_logger_t);
         virtual ~ostream_logger_t();
 
+        using base_logger_t::log;
         virtual void log(const log_entry_t& entry) override;
 
     private:
@@ -77,6 +259,7 @@ namespace gsx::ecs
         no_copy_construct_no_assignment(csv_logger_t);
         virtual ~csv_logger_t();
 
+        using base_logger_t::log;
         virtual void log(const log_entry_t& entry) override;
         bool is_open() const;
         void close();
@@ -88,4 +271,103 @@ namespace gsx::ecs
 
     };
 
+    // what an async_logger_t does when a thread logs faster than the
+    // background thread can keep up with
+    enum class log_overflow_t
+    {
+        // drop the new entry. the number of dropped entries is reported
+        // through the target logger later.
+        drop = 0,
+
+        // wait until there's room for the new entry
+        wait
+    };
+
+    // forwards log entries to another logger on a background thread, so that
+    // threads don't wait for the target logger to format and write them.
+    // every logging thread gets its own bounded ring buffer that only it
+    // writes to, so logging never takes a lock. the background thread drains
+    // the rings periodically, orders the entries by time, and hands them to
+    // the target logger in batches.
+    class async_logger_t : public base_logger_t
+    {
+    public:
+        // * ring_capacity is the number of entries that each thread can have
+        //   waiting to be forwarded.
+        // * flush_interval is the number of seconds the background thread
+        //   sleeps between drains.
+        async_logger_t(
+            std::shared_ptr<base_logger_t> target,
+            usize ring_capacity = 4096,
+            log_overflow_t overflow = log_overflow_t::drop,
+            f64 flush_interval = .01
+        );
+        no_copy_construct_no_assignment(async_logger_t);
+
+        // forward the remaining entries and stop the background thread
+        virtual ~async_logger_t();
+
+        virtual void log(const log_entry_t& entry) override;
+        virtual void log(log_entry_t&& entry) override;
+
+        // forward every entry logged so far, on the calling thread
+        void flush();
+
+        // total number of entries dropped because a ring was full
+        u64 get_n_dropped() const;
+
+    private:
+        // entries logged by a single thread. only the logging thread moves
+        // the head, and only the draining thread moves the tail.
+        struct ring_t
+        {
+            std::vector<std::optional<log_entry_t>> slots;
+            std::atomic<usize> head = 0;
+            std::atomic<usize> tail = 0;
+            std::atomic<u64> n_dropped = 0;
+            std::thread::id thread_id;
+
+            // set when the logging thread exits
+            std::atomic<bool> abandoned = false;
+
+            // set when the logger is destroyed
+            std::atomic<bool> closed = false;
+        };
+
+        // unique across all loggers, since a new logger may have the same
+        // address as a destroyed one
+        const u64 id;
+
+        std::shared_ptr<base_logger_t> target;
+        const usize ring_capacity;
+        const log_overflow_t overflow;
+        const f64 flush_interval;
+
+        std::mutex mutex_rings;
+        std::vector<std::shared_ptr<ring_t>> rings;
+
+        // held while draining, so that there's a single consumer
+        std::mutex mutex_drain;
+        std::vector<log_entry_t> batch;
+
+        std::atomic<u64> n_dropped = 0;
+
+        std::mutex mutex_wake;
+        std::condition_variable cv_wake;
+        bool stopping = false;
+        std::jthread thread;
+
+        // get the ring of the calling thread, creating it on first use
+        ring_t& current_ring();
+
+        // get the ring slot for a new entry, or nullptr if it's dropped.
+        // * push() must be called after the slot is filled in.
+        std::optional<log_entry_t>* reserve(ring_t& ring);
+        void push(ring_t& ring);
+
+        // * mutex_drain must be locked.
+        void drain();
+
+    };
+
 }
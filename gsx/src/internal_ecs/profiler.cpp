@@ -0,0 +1,289 @@
+#include "profiler.h"
+
+#include <algorithm>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#include "system.h"
+#include "../internal_misc/all.h"
+
+namespace gsx::ecs
+{
+
+    // seconds of CPU time used by the calling thread so far
+    // * on Windows, this only advances in scheduler ticks (usually about
+    //   15.6 ms), so CPU times of short systems only make sense on average.
+    static f64 thread_cpu_time()
+    {
+#if defined(_WIN32)
+        FILETIME creation_time, exit_time, kernel_time, user_time;
+        if (!GetThreadTimes(
+            GetCurrentThread(),
+            &creation_time,
+            &exit_time,
+            &kernel_time,
+            &user_time
+        ))
+        {
+            return 0;
+        }
+
+        // in units of 100 nanoseconds
+        auto to_u64 = [](const FILETIME& t)
+        {
+            return ((u64)t.dwHighDateTime << 32) | t.dwLowDateTime;
+        };
+        return 1e-7 * (f64)(to_u64(kernel_time) + to_u64(user_time));
+#else
+        timespec t;
+        if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t) != 0)
+            return 0;
+        return (f64)t.tv_sec + 1e-9 * (f64)t.tv_nsec;
+#endif
+    }
+
+    static timing_stats_t make_timing_stats(std::vector<f64>& values)
+    {
+        timing_stats_t stats;
+        if (values.empty())
+            return stats;
+
+        f64 sum = 0;
+        for (auto v : values)
+        {
+            sum += v;
+        }
+        stats.mean = sum / (f64)values.size();
+
+        std::sort(values.begin(), values.end());
+        stats.min = values.front();
+        stats.max = values.back();
+
+        // nearest-rank percentile
+        usize rank = (99 * values.size() + 99) / 100;
+        stats.p99 = values[std::max<usize>(rank, 1) - 1];
+
+        return stats;
+    }
+
+    void profile_ring_t::record(u64 iteration, f64 wall_time, f64 cpu_time)
+    {
+        // only this thread writes, so relaxed loads of the ring are enough
+        u64 n = n_recorded.load(std::memory_order_relaxed);
+        if (n > 0)
+        {
+            slot_t& last = slots[(n - 1) % capacity];
+            if (last.iteration.load(std::memory_order_relaxed) == iteration)
+            {
+                last.wall_time.store(
+                    last.wall_time.load(std::memory_order_relaxed) + wall_time,
+                    std::memory_order_relaxed
+                );
+                last.cpu_time.store(
+                    last.cpu_time.load(std::memory_order_relaxed) + cpu_time,
+                    std::memory_order_relaxed
+                );
+                return;
+            }
+        }
+
+        slot_t& slot = slots[n % capacity];
+        slot.iteration.store(iteration, std::memory_order_relaxed);
+        slot.wall_time.store(wall_time, std::memory_order_relaxed);
+        slot.cpu_time.store(cpu_time, std::memory_order_relaxed);
+        n_recorded.store(n + 1, std::memory_order_release);
+    }
+
+    void profile_ring_t::get_samples(
+        std::vector<profile_sample_t>& out_samples
+    ) const
+    {
+        out_samples.clear();
+
+        u64 n = n_recorded.load(std::memory_order_acquire);
+        u64 first = (n > capacity) ? n - capacity : 0;
+        for (u64 i = first; i < n; i++)
+        {
+            const slot_t& slot = slots[i % capacity];
+            out_samples.push_back(profile_sample_t{
+                slot.iteration.load(std::memory_order_relaxed),
+                slot.wall_time.load(std::memory_order_relaxed),
+                slot.cpu_time.load(std::memory_order_relaxed)
+            });
+        }
+    }
+
+    void profile_ring_t::clear()
+    {
+        n_recorded.store(0, std::memory_order_release);
+    }
+
+    profiler_t::system_profile_t::system_profile_t(
+        const std::string& system_name
+    )
+        : system_name(system_name)
+    {}
+
+    void profiler_t::set_enabled(bool enabled)
+    {
+        this->enabled.store(enabled, std::memory_order_relaxed);
+    }
+
+    bool profiler_t::is_enabled() const
+    {
+        return enabled.load(std::memory_order_relaxed);
+    }
+
+    std::vector<profile_stats_t> profiler_t::get_stats() const
+    {
+        std::scoped_lock lock(mutex);
+
+        std::vector<profile_stats_t> all_stats;
+        for (auto& profile : profiles)
+        {
+            for (usize phase = 0; phase < profile->phases.size(); phase++)
+            {
+                if (auto stats = make_stats(*profile, (profile_phase_t)phase))
+                {
+                    all_stats.push_back(std::move(*stats));
+                }
+            }
+        }
+        return all_stats;
+    }
+
+    std::optional<profile_stats_t> profiler_t::get_stats(
+        const std::string& system_name,
+        profile_phase_t phase
+    ) const
+    {
+        std::scoped_lock lock(mutex);
+
+        for (auto& profile : profiles)
+        {
+            if (profile->system_name == system_name)
+                return make_stats(*profile, phase);
+        }
+        return std::nullopt;
+    }
+
+    std::vector<profiler_t::system_profile_t*> profiler_t::begin_run(
+        const std::vector<std::shared_ptr<base_system_t>>& systems
+    )
+    {
+        std::scoped_lock lock(mutex);
+
+        profiles.clear();
+        std::vector<system_profile_t*> result;
+        for (auto& system : systems)
+        {
+            profiles.push_back(
+                std::make_unique<system_profile_t>(system->name)
+            );
+            result.push_back(profiles.back().get());
+        }
+        return result;
+    }
+
+    void profiler_t::clear_samples()
+    {
+        std::scoped_lock lock(mutex);
+
+        for (auto& profile : profiles)
+        {
+            for (auto& ring : profile->phases)
+            {
+                ring.clear();
+            }
+        }
+    }
+
+    profiler_t::system_profile_t* profiler_t::add_profile(
+        const std::string& system_name
+    )
+    {
+        std::scoped_lock lock(mutex);
+
+        profiles.push_back(std::make_unique<system_profile_t>(system_name));
+        return profiles.back().get();
+    }
+
+    void profiler_t::remove_profile(system_profile_t* profile)
+    {
+        std::scoped_lock lock(mutex);
+
+        for (usize i = 0; i < profiles.size(); i++)
+        {
+            if (profiles[i].get() == profile)
+            {
+                profiles.erase(profiles.begin() + i);
+                break;
+            }
+        }
+    }
+
+    profiler_t::timestamp_t profiler_t::now() const
+    {
+        if (!is_enabled())
+            return timestamp_t{};
+
+        return timestamp_t{
+            true,
+            std::chrono::high_resolution_clock::now(),
+            thread_cpu_time()
+        };
+    }
+
+    void profiler_t::record(
+        system_profile_t* profile,
+        profile_phase_t phase,
+        u64 iteration,
+        const timestamp_t& start
+    ) const
+    {
+        if (!profile || !start.enabled)
+            return;
+
+        f64 cpu_time = thread_cpu_time() - start.cpu_time;
+        f64 wall_time = misc::elapsed_sec<f64>(start.wall_time);
+
+        profile->phases[(usize)phase].record(
+            iteration,
+            wall_time,
+            std::max(0., cpu_time)
+        );
+    }
+
+    std::optional<profile_stats_t> profiler_t::make_stats(
+        const system_profile_t& profile,
+        profile_phase_t phase
+    )
+    {
+        std::vector<profile_sample_t> samples;
+        profile.phases[(usize)phase].get_samples(samples);
+        if (samples.empty())
+            return std::nullopt;
+
+        std::vector<f64> wall_times, cpu_times;
+        for (auto& sample : samples)
+        {
+            wall_times.push_back(sample.wall_time);
+            cpu_times.push_back(sample.cpu_time);
+        }
+
+        profile_stats_t stats;
+        stats.system_name = profile.system_name;
+        stats.phase = phase;
+        stats.n_samples = samples.size();
+        stats.wall_time = make_timing_stats(wall_times);
+        stats.cpu_time = make_timing_stats(cpu_times);
+        return stats;
+    }
+
+}
@@ -0,0 +1,205 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <array>
+#include <memory>
+#include <optional>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+
+#include "../internal_common/all.h"
+
+namespace gsx::ecs
+{
+
+    class base_system_t;
+
+    // the part of an iteration that a system is profiled in
+    enum class profile_phase_t : u8
+    {
+        // on_trigger_batch() and the delivery of typed events
+        trigger = 0,
+
+        // on_update()
+        update = 1
+    };
+
+    // the time spent by a system in a phase in a single iteration
+    struct profile_sample_t
+    {
+        u64 iteration = 0;
+
+        // seconds between entering and leaving the system
+        f64 wall_time = 0;
+
+        // seconds of CPU time used by the calling thread in the meantime.
+        // this is lower than the wall time when the system waits or gets
+        // preempted, and it doesn't include the time spent by other threads
+        // (like in parallel loops).
+        f64 cpu_time = 0;
+    };
+
+    struct timing_stats_t
+    {
+        f64 min = 0;
+        f64 mean = 0;
+        f64 p99 = 0;
+        f64 max = 0;
+    };
+
+    // rolling statistics of a system in a phase, over the most recent
+    // samples
+    struct profile_stats_t
+    {
+        std::string system_name;
+        profile_phase_t phase = profile_phase_t::update;
+        usize n_samples = 0;
+        timing_stats_t wall_time;
+        timing_stats_t cpu_time;
+    };
+
+    // a ring buffer of the most recent samples of a system in a phase.
+    // recording never takes a lock, so that profiling doesn't serialize the
+    // systems.
+    // * only one thread may record at a time, which holds since a system is
+    //   never invoked by more than one thread at a time. any number of
+    //   threads may read at the same time.
+    // * a sample that's overwritten while being read may be torn, which only
+    //   skews the statistics slightly.
+    class profile_ring_t
+    {
+    public:
+        static constexpr usize capacity = 256;
+
+        profile_ring_t() = default;
+        no_copy_construct_no_assignment(profile_ring_t);
+
+        // add a sample, or add the times to the last sample if it's of the
+        // same iteration (like when a system is triggered several times).
+        void record(u64 iteration, f64 wall_time, f64 cpu_time);
+
+        // get the samples in the ring, oldest first
+        void get_samples(std::vector<profile_sample_t>& out_samples) const;
+
+        // discard every sample
+        void clear();
+
+    private:
+        struct slot_t
+        {
+            std::atomic<u64> iteration = 0;
+            std::atomic<f64> wall_time = 0;
+            std::atomic<f64> cpu_time = 0;
+        };
+
+        std::array<slot_t, capacity> slots;
+
+        // number of samples ever recorded. the newest sample is in
+        // slots[(n_recorded - 1) % capacity].
+        std::atomic<u64> n_recorded = 0;
+
+    };
+
+    // measures how long the systems of a world take in every iteration. the
+    // world records the samples while it's running, and the statistics can
+    // be read from any thread, even during a run, to find out which systems
+    // take most of the iteration time.
+    class profiler_t
+    {
+    public:
+        // the profile of a single system in a run
+        struct system_profile_t
+        {
+            std::string system_name;
+            std::array<profile_ring_t, 2> phases;
+
+            system_profile_t(const std::string& system_name);
+            no_copy_construct_no_assignment(system_profile_t);
+        };
+
+        // the start of a measurement
+        struct timestamp_t
+        {
+            // whether profiling was enabled when the measurement started
+            bool enabled = false;
+
+            std::chrono::high_resolution_clock::time_point wall_time;
+            f64 cpu_time = 0;
+        };
+
+        profiler_t() = default;
+        no_copy_construct_no_assignment(profiler_t);
+
+        // enable or disable recording. this can be called at any time, and
+        // profiling is enabled by default.
+        void set_enabled(bool enabled);
+
+        bool is_enabled() const;
+
+        // statistics of every system in the current or most recent run, in
+        // the order in which the systems were added, for the trigger and the
+        // update phases. phases without samples are skipped.
+        std::vector<profile_stats_t> get_stats() const;
+
+        // statistics of the first system with a given name in a phase, if it
+        // has any samples
+        std::optional<profile_stats_t> get_stats(
+            const std::string& system_name,
+            profile_phase_t phase
+        ) const;
+
+        // make a new profile for every system when the world prepares its
+        // schedule and return them, indexed like the systems. the previous
+        // profiles are discarded.
+        // * this function is called internally by world_t::run().
+        std::vector<system_profile_t*> begin_run(
+            const std::vector<std::shared_ptr<base_system_t>>& systems
+        );
+
+        // discard the samples of every profile, at the start of a run that
+        // reuses the profiles of the previous run.
+        // * this function is called internally by world_t::run().
+        void clear_samples();
+
+        // make a profile for a system that's added while the world is
+        // running. the profile is listed after the existing ones.
+        // * this function is called internally by world_t::run().
+        system_profile_t* add_profile(const std::string& system_name);
+
+        // discard the profile of a system that's removed while the world is
+        // running.
+        // * this function is called internally by world_t::run() while no
+        //   other thread is recording samples.
+        void remove_profile(system_profile_t* profile);
+
+        // start a measurement on the calling thread
+        timestamp_t now() const;
+
+        // record the time since a measurement started on the calling thread.
+        // does nothing if profile is null or profiling was disabled when the
+        // measurement started.
+        void record(
+            system_profile_t* profile,
+            profile_phase_t phase,
+            u64 iteration,
+            const timestamp_t& start
+        ) const;
+
+    private:
+        std::atomic<bool> enabled = true;
+
+        // guards the list of profiles, not their samples
+        mutable std::mutex mutex;
+        std::vector<std::unique_ptr<system_profile_t>> profiles;
+
+        static std::optional<profile_stats_t> make_stats(
+            const system_profile_t& profile,
+            profile_phase_t phase
+        );
+
+    };
+
+}
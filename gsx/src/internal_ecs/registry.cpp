@@ -0,0 +1,484 @@
+#include "registry.h"
+
+#include <algorithm>
+#include <unordered_map>
+#include <new>
+#include <cstring>
+
+namespace gsx::ecs
+{
+
+    registry_t::registry_t()
+    {
+        empty_archetype = get_or_create_archetype({});
+    }
+
+    entity_t registry_t::create()
+    {
+        entity_t index;
+        if (!free_indices.empty())
+        {
+            index = free_indices.back();
+            free_indices.pop_back();
+        }
+        else
+        {
+            // the last index is reserved so that no handle equals null_entity
+            if (records.size() >= entity_index_mask)
+                throw std::runtime_error("ran out of entity IDs");
+
+            index = (entity_t)records.size();
+            records.emplace_back();
+        }
+
+        record_t& record = records[index];
+        entity_t entity = make_entity(index, record.generation);
+        record.archetype = empty_archetype;
+        record.row = empty_archetype->push(entity);
+        n_alive++;
+        return entity;
+    }
+
+    void registry_t::destroy(entity_t entity)
+    {
+        checked_record(entity);
+        entity_t index = entity_index(entity);
+        record_t& record = records[index];
+
+        entity_t moved = record.archetype->erase(record.row);
+        if (moved != null_entity)
+        {
+            records[entity_index(moved)].row = record.row;
+            record.archetype->set_row_version(record.row, version);
+        }
+
+        free_slot(index);
+        n_alive--;
+    }
+
+    void registry_t::clear()
+    {
+        for (auto& archetype : archetypes)
+        {
+            while (archetype->size() > 0)
+            {
+                archetype->erase(archetype->size() - 1);
+            }
+        }
+
+        // recycle the lowest indices first
+        free_indices.clear();
+        for (usize i = records.size(); i > 0; i--)
+        {
+            if (records[i - 1].archetype)
+            {
+                free_slot((entity_t)(i - 1));
+            }
+            else
+            {
+                free_indices.push_back((entity_t)(i - 1));
+            }
+        }
+        n_alive = 0;
+    }
+
+    void registry_t::save(registry_snapshot_t& out_snapshot) const
+    {
+        // * the snapshot is built on the side, so that a copy constructor
+        //   throwing leaves out_snapshot as it was, and the local snapshot
+        //   destroys what was copied before it.
+        registry_snapshot_t snapshot;
+
+        // lay out the columns of the archetypes that have entities
+        std::vector<const archetype_t*> saved;
+        std::vector<std::vector<usize>> offsets;
+        usize n_bytes = 0;
+        usize align = registry_snapshot_t::data_align;
+        for (auto& archetype : archetypes)
+        {
+            if (archetype->size() == 0)
+                continue;
+
+            std::vector<usize> column_offsets;
+            for (usize i = 0; i < archetype->column_count(); i++)
+            {
+                const component_info_t& info = archetype->column_info(i);
+                if (!info.trivial && !info.copy)
+                    throw std::runtime_error(
+                        "a component type in the registry can't be copied"
+                    );
+
+                const usize column_align = std::max(
+                    registry_snapshot_t::data_align,
+                    info.align
+                );
+                align = std::max(align, column_align);
+                n_bytes = (n_bytes + column_align - 1)
+                    / column_align
+                    * column_align;
+                column_offsets.push_back(n_bytes);
+                n_bytes += archetype->size() * info.size;
+            }
+            saved.push_back(archetype.get());
+            offsets.push_back(std::move(column_offsets));
+        }
+
+        if (n_bytes > 0)
+        {
+            snapshot.data = static_cast<std::byte*>(::operator new(
+                n_bytes,
+                std::align_val_t(align)
+            ));
+            snapshot.n_bytes = n_bytes;
+            snapshot.align = align;
+        }
+
+        for (usize a = 0; a < saved.size(); a++)
+        {
+            const archetype_t& archetype = *saved[a];
+
+            // * the state is added before its columns are copied, and a
+            //   column is only added to it once all of its rows are copied,
+            //   so that the snapshot destroys the complete columns if a copy
+            //   throws.
+            snapshot.archetypes.emplace_back();
+            registry_snapshot_t::archetype_state_t& state =
+                snapshot.archetypes.back();
+            state.column_offsets = std::move(offsets[a]);
+            state.entities.reserve(archetype.size());
+            for (usize chunk = 0; chunk < archetype.chunk_count(); chunk++)
+            {
+                const entity_t* entities = archetype.entities(chunk);
+                state.entities.insert(
+                    state.entities.end(),
+                    entities,
+                    entities + archetype.chunk_size(chunk)
+                );
+            }
+
+            for (usize i = 0; i < archetype.column_count(); i++)
+            {
+                const component_info_t& info = archetype.column_info(i);
+                std::byte* const column =
+                    snapshot.data + state.column_offsets[i];
+                std::byte* dst = column;
+                const usize n_chunks = archetype.chunk_count();
+                try
+                {
+                    for (usize chunk = 0; chunk < n_chunks; chunk++)
+                    {
+                        const std::byte* src = static_cast<const std::byte*>(
+                            archetype.column(chunk, i)
+                        );
+                        usize count = archetype.chunk_size(chunk);
+                        if (info.trivial)
+                        {
+                            std::memcpy(dst, src, count * info.size);
+                            dst += count * info.size;
+                            continue;
+                        }
+                        for (usize row = 0; row < count; row++)
+                        {
+                            info.copy(dst, src + row * info.size);
+                            dst += info.size;
+                        }
+                    }
+                }
+                catch (...)
+                {
+                    // destroy the rows of the column copied so far
+                    for (std::byte* p = column; p < dst; p += info.size)
+                    {
+                        info.destroy(p);
+                    }
+                    throw;
+                }
+                state.infos.push_back(&info);
+            }
+        }
+
+        std::unordered_map<const archetype_t*, isize> saved_indices;
+        for (usize a = 0; a < saved.size(); a++)
+        {
+            saved_indices[saved[a]] = (isize)a;
+        }
+
+        snapshot.records.reserve(records.size());
+        for (auto& record : records)
+        {
+            snapshot.records.push_back(registry_snapshot_t::record_t{
+                record.archetype ? saved_indices[record.archetype] : -1,
+                record.row,
+                record.generation
+            });
+        }
+        snapshot.free_indices = free_indices;
+        snapshot.n_alive = n_alive;
+
+        // the previous contents of out_snapshot are destroyed with the local
+        // snapshot
+        out_snapshot.swap(snapshot);
+    }
+
+    void registry_t::restore(const registry_snapshot_t& snapshot)
+    {
+        for (auto& archetype : archetypes)
+        {
+            while (archetype->size() > 0)
+            {
+                archetype->erase(archetype->size() - 1);
+            }
+        }
+
+        // restored components are newer than anything seen before
+        next_version();
+
+        std::vector<archetype_t*> restored;
+        for (auto& state : snapshot.archetypes)
+        {
+            archetype_t* archetype = get_or_create_archetype(state.infos);
+            restored.push_back(archetype);
+
+            // the column being copied, and the number of its rows copied
+            usize i = 0;
+            usize n_copied = 0;
+            try
+            {
+                for (auto entity : state.entities)
+                {
+                    archetype->push(entity);
+                }
+
+                for (; i < state.infos.size(); i++)
+                {
+                    const component_info_t& info = *state.infos[i];
+                    const std::byte* src =
+                        snapshot.data + state.column_offsets[i];
+                    const usize n_chunks = archetype->chunk_count();
+                    n_copied = 0;
+                    for (usize chunk = 0; chunk < n_chunks; chunk++)
+                    {
+                        std::byte* dst = static_cast<std::byte*>(
+                            archetype->column(chunk, i)
+                        );
+                        usize count = archetype->chunk_size(chunk);
+                        if (info.trivial)
+                        {
+                            std::memcpy(dst, src, count * info.size);
+                            src += count * info.size;
+                            n_copied += count;
+                            continue;
+                        }
+                        for (usize row = 0; row < count; row++)
+                        {
+                            info.copy(dst, src);
+                            dst += info.size;
+                            src += info.size;
+                            n_copied++;
+                        }
+                    }
+                }
+            }
+            catch (...)
+            {
+                // destroy the components copied so far and drop the rows,
+                // since the rest of their components were never
+                // constructed, then leave the registry empty
+                for (usize j = 0; j <= i && j < state.infos.size(); j++)
+                {
+                    const component_info_t& info = *state.infos[j];
+                    if (info.trivial)
+                        continue;
+
+                    usize n = (j < i) ? archetype->size() : n_copied;
+                    for (usize row = 0; row < n; row++)
+                    {
+                        info.destroy(archetype->at(row, j));
+                    }
+                }
+                while (archetype->size() > 0)
+                {
+                    archetype->pop_dead(archetype->size() - 1);
+                }
+                clear();
+                throw;
+            }
+            for (usize chunk = 0; chunk < archetype->chunk_count(); chunk++)
+            {
+                archetype->set_row_version(
+                    chunk * archetype->chunk_capacity(),
+                    version
+                );
+            }
+        }
+
+        records.clear();
+        records.reserve(snapshot.records.size());
+        for (auto& record : snapshot.records)
+        {
+            records.push_back(record_t{
+                (record.archetype >= 0)
+                    ? restored[(usize)record.archetype]
+                    : nullptr,
+                record.row,
+                record.generation
+            });
+        }
+        free_indices = snapshot.free_indices;
+        n_alive = snapshot.n_alive;
+    }
+
+    bool registry_t::alive(entity_t entity) const
+    {
+        entity_t index = entity_index(entity);
+        return index < records.size()
+            && records[index].archetype
+            && records[index].generation == entity_generation(entity);
+    }
+
+    const registry_t::record_t& registry_t::checked_record(
+        entity_t entity
+    ) const
+    {
+        if (!alive(entity))
+            throw std::runtime_error("the entity is not alive");
+        return records[entity_index(entity)];
+    }
+
+    void registry_t::free_slot(entity_t index)
+    {
+        record_t& record = records[index];
+        record.archetype = nullptr;
+        record.row = 0;
+        record.generation = (record.generation + 1) & entity_generation_mask;
+        free_indices.push_back(index);
+    }
+
+    archetype_t* registry_t::get_or_create_archetype(
+        const std::vector<const component_info_t*>& infos
+    )
+    {
+        std::vector<type_id_t> signature;
+        signature.reserve(infos.size());
+        for (auto info : infos)
+        {
+            signature.push_back(info->id);
+        }
+
+        auto it = archetype_map.find(signature);
+        if (it != archetype_map.end())
+            return it->second;
+
+        archetypes.push_back(std::make_unique<archetype_t>(infos));
+        archetype_t* archetype = archetypes.back().get();
+        archetype_map[signature] = archetype;
+        return archetype;
+    }
+
+    archetype_t* registry_t::archetype_with(
+        archetype_t* from,
+        const component_info_t& info
+    )
+    {
+        auto it = from->edges_add.find(info.id);
+        if (it != from->edges_add.end())
+            return it->second;
+
+        std::vector<const component_info_t*> infos;
+        for (usize i = 0; i < from->column_count(); i++)
+        {
+            infos.push_back(&from->column_info(i));
+        }
+        infos.insert(
+            std::upper_bound(
+                infos.begin(),
+                infos.end(),
+                &info,
+                [](const component_info_t* a, const component_info_t* b)
+                {
+                    return a->id < b->id;
+                }
+            ),
+            &info
+        );
+
+        archetype_t* to = get_or_create_archetype(infos);
+        from->edges_add[info.id] = to;
+        to->edges_remove[info.id] = from;
+        return to;
+    }
+
+    archetype_t* registry_t::archetype_without(
+        archetype_t* from,
+        type_id_t id
+    )
+    {
+        auto it = from->edges_remove.find(id);
+        if (it != from->edges_remove.end())
+            return it->second;
+
+        std::vector<const component_info_t*> infos;
+        for (usize i = 0; i < from->column_count(); i++)
+        {
+            if (from->column_info(i).id != id)
+            {
+                infos.push_back(&from->column_info(i));
+            }
+        }
+
+        archetype_t* to = get_or_create_archetype(infos);
+        from->edges_remove[id] = to;
+        to->edges_add[id] = from;
+        return to;
+    }
+
+    usize registry_t::move_entity(entity_t entity, archetype_t* to)
+    {
+        record_t& record = records[entity_index(entity)];
+        archetype_t* from = record.archetype;
+        usize from_row = record.row;
+        usize to_row = to->push(entity);
+
+        // relocate the components that both archetypes have and destroy the
+        // rest. both signatures are sorted so they can be walked together.
+        usize j = 0;
+        for (usize i = 0; i < from->column_count(); i++)
+        {
+            const component_info_t& info = from->column_info(i);
+            while (j < to->column_count() && to->column_info(j).id < info.id)
+            {
+                j++;
+            }
+
+            void* src = from->at(from_row, i);
+            if (j < to->column_count() && to->column_info(j).id == info.id)
+            {
+                if (info.trivial)
+                {
+                    std::memcpy(to->at(to_row, j), src, info.size);
+                }
+                else
+                {
+                    info.relocate(to->at(to_row, j), src);
+                }
+            }
+            else if (!info.trivial)
+            {
+                info.destroy(src);
+            }
+        }
+
+        entity_t moved = from->pop_dead(from_row);
+        if (moved != null_entity)
+        {
+            records[entity_index(moved)].row = from_row;
+            from->set_row_version(from_row, version);
+        }
+        to->set_row_version(to_row, version);
+
+        record.archetype = to;
+        record.row = to_row;
+        return to_row;
+    }
+
+}
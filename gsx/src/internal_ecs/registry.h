@@ -0,0 +1,302 @@
+#pragma once
+
+#include <vector>
+#include <map>
+#include <memory>
+#include <utility>
+#include <type_traits>
+#include <stdexcept>
+#include <cstdint>
+
+#include "entity.h"
+#include "component.h"
+#include "archetype.h"
+#include "view.h"
+#include "snapshot.h"
+#include "../internal_common/all.h"
+
+namespace gsx::ecs
+{
+
+    // creates entities and stores their components. components are grouped by
+    // archetype (the exact set of component types an entity has), so that
+    // entities sharing the same component types are packed together.
+    // * the records of the entities, indexed by the indices in their handles,
+    //   form a sparse set over the packed rows of the archetypes, so adding,
+    //   removing and looking up components is O(1), and iterating over them
+    //   only walks packed columns.
+    // * the slots of destroyed entities are recycled by the next entities
+    //   that are created, with a new generation (see entity_t), so creating
+    //   and destroying entities in a long run doesn't keep growing the
+    //   registry.
+    // * adding or removing a component moves the entity (and all of its
+    //   components) to a different archetype. references and pointers to
+    //   components are invalidated by any structural change (creating or
+    //   destroying entities, adding or removing components).
+    // * the registry has a version that's stamped on every chunk column
+    //   that's written to (see archetype_t), so that readers can tell which
+    //   chunks changed since they last looked (see view_t::changed_since()).
+    //   getting mutable access to a component counts as writing to it.
+    // * the registry is not thread-safe. structural changes must not happen
+    //   while other threads are accessing the registry. reading and writing
+    //   existing components from several threads is fine as long as no two
+    //   threads access the same component.
+    class registry_t
+    {
+    public:
+        registry_t();
+        no_copy_construct_no_assignment(registry_t);
+        ~registry_t() = default;
+
+        // create a new entity without any components
+        // * throws an exception if too many entities are alive.
+        entity_t create();
+
+        // destroy an entity along with all of its components
+        void destroy(entity_t entity);
+
+        // destroy every entity
+        void clear();
+
+        bool alive(entity_t entity) const;
+
+        // number of alive entities
+        constexpr usize size() const
+        {
+            return n_alive;
+        }
+
+        // number of entity slots, including the slots of destroyed entities
+        // that are waiting to be recycled
+        constexpr usize capacity() const
+        {
+            return records.size();
+        }
+
+        constexpr const std::vector<std::unique_ptr<archetype_t>>&
+            get_archetypes() const
+        {
+            return archetypes;
+        }
+
+        // the version that writes are currently stamped with. it starts at 1,
+        // so a version of 0 is older than every write.
+        constexpr u64 get_version() const
+        {
+            return version;
+        }
+
+        // advance the version and return the new one.
+        // * a world does this before every group of systems is updated and
+        //   before every round of triggers.
+        u64 next_version()
+        {
+            return ++version;
+        }
+
+        // attach a component of type T to an entity, constructed from the
+        // given arguments. if the entity already has a component of type T, it
+        // will be replaced.
+        template<typename T, typename... Args>
+        T& add(entity_t entity, Args&&... args)
+        {
+            T value(std::forward<Args>(args)...);
+
+            const record_t& record = checked_record(entity);
+            isize index = record.archetype->column_index(type_id_of<T>());
+            if (index >= 0)
+            {
+                T* ptr = static_cast<T*>(
+                    record.archetype->at(record.row, (usize)index)
+                );
+                *ptr = std::move(value);
+                stamp(record, (usize)index);
+                return *ptr;
+            }
+
+            archetype_t* to = archetype_with(
+                record.archetype,
+                component_info_of<T>()
+            );
+            usize row = move_entity(entity, to);
+            void* ptr = to->at(row, (usize)to->column_index(type_id_of<T>()));
+            return *new(ptr) T(std::move(value));
+        }
+
+        // detach the component of type T from an entity, if it has one
+        template<typename T>
+        void remove(entity_t entity)
+        {
+            const record_t& record = checked_record(entity);
+            if (!record.archetype->has(type_id_of<T>()))
+                return;
+
+            archetype_t* to = archetype_without(
+                record.archetype,
+                type_id_of<T>()
+            );
+            move_entity(entity, to);
+        }
+
+        template<typename T>
+        bool has(entity_t entity) const
+        {
+            return checked_record(entity).archetype->has(type_id_of<T>());
+        }
+
+        // get the component of type T attached to an entity, or nullptr if
+        // the entity doesn't have one.
+        // * the non-const overloads count as writing to the component (see
+        //   get_version()), so readers should use the const ones.
+        template<typename T>
+        T* try_get(entity_t entity)
+        {
+            const record_t& record = checked_record(entity);
+            isize index = record.archetype->column_index(type_id_of<T>());
+            if (index < 0)
+                return nullptr;
+            stamp(record, (usize)index);
+            return static_cast<T*>(
+                record.archetype->at(record.row, (usize)index)
+            );
+        }
+
+        template<typename T>
+        const T* try_get(entity_t entity) const
+        {
+            const record_t& record = checked_record(entity);
+            isize index = record.archetype->column_index(type_id_of<T>());
+            if (index < 0)
+                return nullptr;
+            return static_cast<const T*>(
+                record.archetype->at(record.row, (usize)index)
+            );
+        }
+
+        // get the component of type T attached to an entity, and throw an
+        // exception if the entity doesn't have one.
+        template<typename T>
+        T& get(entity_t entity)
+        {
+            T* ptr = try_get<T>(entity);
+            if (!ptr)
+                throw std::runtime_error(
+                    "the entity doesn't have the requested component"
+                );
+            return *ptr;
+        }
+
+        template<typename T>
+        const T& get(entity_t entity) const
+        {
+            const T* ptr = try_get<T>(entity);
+            if (!ptr)
+                throw std::runtime_error(
+                    "the entity doesn't have the requested component"
+                );
+            return *ptr;
+        }
+
+        // make a view over every entity that has all of the component types
+        // Ts. see view_t.
+        template<typename... Ts>
+        view_t<Ts...> view()
+        {
+            return view_t<Ts...>(archetypes, version);
+        }
+
+        // * a view of a const registry only gives read-only access, so every
+        //   component type must be const.
+        template<typename... Ts>
+        view_t<Ts...> view() const
+        {
+            static_assert(
+                (std::is_const_v<Ts> && ...),
+                "a view of a const registry needs const component types"
+            );
+            return view_t<Ts...>(archetypes, version);
+        }
+
+        // copy every entity and component into a snapshot, replacing what it
+        // had before. see registry_snapshot_t.
+        // * throws an exception if a component type that's not trivially
+        //   copyable isn't copy constructible either.
+        void save(registry_snapshot_t& out_snapshot) const;
+
+        // replace every entity and component with the ones in a snapshot,
+        // keeping the same entity handles. the snapshot can be restored again
+        // later.
+        // * the restored components count as written to (see get_version()).
+        // * if a copy constructor throws, the registry is left empty and the
+        //   exception is rethrown.
+        void restore(const registry_snapshot_t& snapshot);
+
+    private:
+        // location of an entity's components. a null archetype means the
+        // entity has been destroyed.
+        struct record_t
+        {
+            archetype_t* archetype = nullptr;
+            usize row = 0;
+
+            // generation of the entity in the slot, or of the next one if
+            // the slot is free
+            entity_t generation = 0;
+        };
+
+        // indexed by entity index
+        std::vector<record_t> records;
+
+        // indices of the free slots, the last of which is recycled first
+        std::vector<entity_t> free_indices;
+
+        std::vector<std::unique_ptr<archetype_t>> archetypes;
+        std::map<std::vector<type_id_t>, archetype_t*> archetype_map;
+
+        // archetype with no components, where new entities start out
+        archetype_t* empty_archetype;
+
+        usize n_alive = 0;
+
+        u64 version = 1;
+
+        const record_t& checked_record(entity_t entity) const;
+
+        // stamp the current version on a column of the chunk holding an
+        // entity's components
+        void stamp(const record_t& record, usize column_index)
+        {
+            archetype_t* archetype = record.archetype;
+            archetype->set_version(
+                record.row / archetype->chunk_capacity(),
+                column_index,
+                version
+            );
+        }
+
+        // mark a slot as free and bump its generation
+        void free_slot(entity_t index);
+
+        // * infos must be sorted by type ID.
+        archetype_t* get_or_create_archetype(
+            const std::vector<const component_info_t*>& infos
+        );
+
+        // get the archetype with the same components as from, plus one more
+        archetype_t* archetype_with(
+            archetype_t* from,
+            const component_info_t& info
+        );
+
+        // get the archetype with the same components as from, minus one
+        archetype_t* archetype_without(archetype_t* from, type_id_t id);
+
+        // move an entity to a different archetype and return its new row.
+        // components that the new archetype doesn't have are destroyed, and
+        // components that the old archetype didn't have are left
+        // uninitialized.
+        usize move_entity(entity_t entity, archetype_t* to);
+
+    };
+
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <vector>
+#include <functional>
+#include <cstdint>
+
+#include "../internal_common/all.h"
+
+namespace gsx::ecs
+{
+
+    class world_t;
+
+    // what a world does with its recording in the next runs. see
+    // world_t::set_replay().
+    enum class replay_mode_t : u8
+    {
+        // run normally
+        none,
+
+        // record the runs, replacing the recording every time
+        record,
+
+        // replay the run in the recording
+        replay
+    };
+
+    // something that came into a world from outside while it was recording,
+    // like an event enqueued by another thread. invoking it gives the same
+    // input to the world again.
+    using recorded_input_t = std::function<void(world_t&)>;
+
+    // an iteration of a recorded run
+    struct recorded_iteration_t
+    {
+        // see iteration_t
+        f64 time = 0;
+        f64 dt = 0;
+
+        // inputs given to the world at the start of the iteration, in the
+        // order in which they came
+        std::vector<recorded_input_t> inputs;
+    };
+
+    // everything that can make two runs of a world differ other than the
+    // systems themselves: the seed, the timing of the iterations, and the
+    // events that came from outside the world. replaying a recording with
+    // the same systems and the same initial state reproduces the recorded
+    // run bit-exactly, as long as the systems don't depend on the timing of
+    // the worker threads in their own parallel loops (see
+    // world_t::set_deterministic()).
+    // * recordings are kept in memory, since the events can hold any data.
+    struct world_recording_t
+    {
+        // see world_t::set_seed()
+        u64 seed = 0;
+
+        std::vector<recorded_iteration_t> iterations;
+    };
+
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <memory>
+#include <utility>
+#include <type_traits>
+#include <stdexcept>
+
+#include "../internal_common/all.h"
+
+namespace gsx::ecs
+{
+
+    // type-erased interface of resource_t, used by the world to keep the
+    // resources of every type in a single table indexed by type ID.
+    class base_resource_t
+    {
+    public:
+        virtual ~base_resource_t() = default;
+
+        // make a copy of the resource, for world_snapshot_t
+        // * throws an exception if the type isn't copy constructible.
+        virtual std::unique_ptr<base_resource_t> clone() const = 0;
+
+        // replace the value with a copy of the value of another resource of
+        // the same type
+        // * throws an exception if the type isn't copy assignable.
+        virtual void assign(const base_resource_t& other) = 0;
+
+        // whether assign() can copy the value of another resource
+        virtual bool is_assignable() const = 0;
+    };
+
+    // the single instance of a type that a world holds as a resource. see
+    // world_t::add_resource().
+    template<typename T>
+    class resource_t : public base_resource_t
+    {
+    public:
+        T value;
+
+        template<typename... Args>
+        resource_t(Args&&... args)
+            : value(std::forward<Args>(args)...)
+        {}
+
+        no_copy_construct_no_assignment(resource_t);
+
+        virtual std::unique_ptr<base_resource_t> clone() const override
+        {
+            if constexpr (std::is_copy_constructible_v<T>)
+            {
+                return std::make_unique<resource_t<T>>(value);
+            }
+            else
+            {
+                throw std::runtime_error(
+                    "the resource isn't copy constructible"
+                );
+            }
+        }
+
+        virtual void assign(const base_resource_t& other) override
+        {
+            if constexpr (std::is_copy_assignable_v<T>)
+            {
+                value = static_cast<const resource_t<T>&>(other).value;
+            }
+            else
+            {
+                throw std::runtime_error(
+                    "the resource isn't copy assignable"
+                );
+            }
+        }
+
+        virtual bool is_assignable() const override
+        {
+            return std::is_copy_assignable_v<T>;
+        }
+    };
+
+}
@@ -0,0 +1,85 @@
+#include "snapshot.h"
+
+#include <new>
+#include <utility>
+
+namespace gsx::ecs
+{
+
+    registry_snapshot_t::~registry_snapshot_t()
+    {
+        clear();
+    }
+
+    void registry_snapshot_t::clear()
+    {
+        if (data)
+        {
+            for (auto& archetype : archetypes)
+            {
+                for (usize i = 0; i < archetype.infos.size(); i++)
+                {
+                    const component_info_t& info = *archetype.infos[i];
+                    if (info.trivial)
+                        continue;
+
+                    std::byte* column = data + archetype.column_offsets[i];
+                    for (usize row = 0; row < archetype.entities.size(); row++)
+                    {
+                        info.destroy(column + row * info.size);
+                    }
+                }
+            }
+            ::operator delete(data, std::align_val_t(align));
+        }
+
+        records.clear();
+        free_indices.clear();
+        n_alive = 0;
+        archetypes.clear();
+        data = nullptr;
+        n_bytes = 0;
+        align = data_align;
+    }
+
+    void registry_snapshot_t::swap(registry_snapshot_t& other)
+    {
+        std::swap(records, other.records);
+        std::swap(free_indices, other.free_indices);
+        std::swap(n_alive, other.n_alive);
+        std::swap(archetypes, other.archetypes);
+        std::swap(data, other.data);
+        std::swap(n_bytes, other.n_bytes);
+        std::swap(align, other.align);
+    }
+
+    usize world_snapshot_t::typed_event_count() const
+    {
+        usize n = 0;
+        for (auto& saved : channels)
+        {
+            if (saved)
+            {
+                n += saved->size();
+            }
+        }
+        return n;
+    }
+
+    void world_snapshot_t::swap(world_snapshot_t& other)
+    {
+        registry.swap(other.registry);
+        std::swap(resources, other.resources);
+        std::swap(events, other.events);
+        std::swap(channels, other.channels);
+    }
+
+    void world_snapshot_t::clear()
+    {
+        registry.clear();
+        resources.clear();
+        events.clear();
+        channels.clear();
+    }
+
+}
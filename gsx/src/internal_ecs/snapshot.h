@@ -0,0 +1,148 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+
+#include "event.h"
+#include "channel.h"
+#include "entity.h"
+#include "component.h"
+#include "resource.h"
+#include "../internal_common/all.h"
+
+namespace gsx::ecs
+{
+
+    // a copy of every entity and component of a registry. see
+    // registry_t::save() and registry_t::restore().
+    // * the components of every archetype are kept column by column in a
+    //   single block of memory. trivially copyable columns are copied with
+    //   memcpy() a chunk at a time, and the rest are copy-constructed, which
+    //   throws an exception if a component type isn't copy constructible.
+    // * snapshots are kept in memory and refer to the component types of the
+    //   process, so they can be restored into any registry of the same
+    //   process, but not saved to disk.
+    class registry_snapshot_t
+    {
+    public:
+        registry_snapshot_t() = default;
+        no_copy_construct_no_assignment(registry_snapshot_t);
+        ~registry_snapshot_t();
+
+        // number of entities in the snapshot
+        constexpr usize size() const
+        {
+            return n_alive;
+        }
+
+        // number of bytes of component data in the snapshot
+        constexpr usize size_bytes() const
+        {
+            return n_bytes;
+        }
+
+        // forget the snapshot, destroying the copied components
+        void clear();
+
+        // exchange the contents of two snapshots
+        void swap(registry_snapshot_t& other);
+
+    private:
+        struct record_t
+        {
+            // index of the archetype in the snapshot, or -1 if the slot is
+            // free
+            isize archetype;
+
+            usize row;
+            entity_t generation;
+        };
+
+        struct archetype_state_t
+        {
+            // sorted by type ID, like the signature of the archetype
+            std::vector<const component_info_t*> infos;
+
+            // in the order of the rows
+            std::vector<entity_t> entities;
+
+            // byte offset of every column in data, where the components of
+            // all the rows are packed together
+            std::vector<usize> column_offsets;
+        };
+
+        // columns start at multiples of this in data, or of the alignment
+        // of their component type if it's larger
+        static constexpr usize data_align = 64;
+
+        std::vector<record_t> records;
+        std::vector<entity_t> free_indices;
+        usize n_alive = 0;
+
+        std::vector<archetype_state_t> archetypes;
+
+        std::byte* data = nullptr;
+        usize n_bytes = 0;
+
+        // alignment of data, which is the largest of data_align and the
+        // alignments of the component types
+        usize align = data_align;
+
+        friend class registry_t;
+
+    };
+
+    // a copy of the state of a world: its entities and components, its
+    // resources and the events that are waiting to be processed. see
+    // world_t::save_snapshot() and world_t::restore_snapshot().
+    // * resources and events are copied with their copy constructors, and
+    //   saving a snapshot throws an exception if any of them isn't copyable.
+    // * events emitted with world_t::emit<T>() are part of the snapshot
+    //   until they're delivered.
+    class world_snapshot_t
+    {
+    public:
+        world_snapshot_t() = default;
+        no_copy_construct_no_assignment(world_snapshot_t);
+        ~world_snapshot_t() = default;
+
+        constexpr const registry_snapshot_t& get_registry() const
+        {
+            return registry;
+        }
+
+        // number of pending events in the snapshot
+        constexpr usize event_count() const
+        {
+            return events.size();
+        }
+
+        // number of pending typed events in the snapshot, of every type
+        usize typed_event_count() const;
+
+        void clear();
+
+        // exchange the contents of two snapshots
+        void swap(world_snapshot_t& other);
+
+    private:
+        registry_snapshot_t registry;
+
+        // indexed by type ID, like the resources of a world
+        std::vector<std::unique_ptr<base_resource_t>> resources;
+
+        // in the order in which they were enqueued
+        std::vector<event_t> events;
+
+        // the pending events of every typed event channel, indexed by type
+        // ID like the channels of a world. entries are null for channels
+        // without pending events.
+        std::vector<std::unique_ptr<base_event_list_t>> channels;
+
+        friend class world_t;
+
+    };
+
+}
@@ -10,6 +10,29 @@ namespace gsx::ecs
         : name(name), exec_scheme(exec_scheme)
     {}
 
+    bool base_system_t::declares_access() const
+    {
+        return !reads.empty() || !writes.empty();
+    }
+
+    bool base_system_t::conflicts_with(const base_system_t& other) const
+    {
+        if (!declares_access() || !other.declares_access())
+            return true;
+
+        for (auto id : writes)
+        {
+            if (other.reads.contains(id) || other.writes.contains(id))
+                return true;
+        }
+        for (auto id : other.writes)
+        {
+            if (reads.contains(id))
+                return true;
+        }
+        return false;
+    }
+
     void base_system_t::on_start(world_t& world)
     {}
 
@@ -23,6 +46,18 @@ namespace gsx::ecs
     )
     {}
 
+    void base_system_t::on_trigger_batch(
+        world_t& world,
+        const iteration_t& iter,
+        std::span<const event_t> events
+    )
+    {
+        for (auto& event : events)
+        {
+            on_trigger(world, iter, event);
+        }
+    }
+
     void base_system_t::on_stop(world_t& world, const iteration_t& iter)
     {}
 
@@ -3,10 +3,14 @@
 // STD
 #include <string>
 #include <set>
+#include <vector>
+#include <span>
 #include <cstdint>
 
 // Internal
 #include "event.h"
+#include "channel.h"
+#include "component.h"
 #include "world.h"
 #include "../internal_common/all.h"
 
@@ -17,9 +21,10 @@ namespace gsx::ecs
     struct execution_scheme_t
     {
         // a system with a higher update order will have its on_update()
-        // function invoked after a system with a lower update order. systems
-        // with the same order will have their on_update() functions invoked in
-        // parallel.
+        // function invoked after a system with a lower update order, if the
+        // two systems conflict (see base_system_t::conflicts_with()). systems
+        // with the same order, or ones that don't conflict, will have their
+        // on_update() functions invoked in parallel.
         // * the on_start() functions are invoked in the same order in which the
         //   systems were added to the world, while the on_stop() functions are
         //   invoked in reverse order.
@@ -27,22 +32,53 @@ namespace gsx::ecs
 
         // force the parent world to invoke the abstract functions of the system
         // on the same thread that is running the world. if this option is
-        // disabled, the system may or may not run in a separate thread. if it
-        // does so, all of its abstract functions will be invoked on that thread
-        // only. otherwise, they will be invoked on the same thread that is
-        // running the world. this option is especially helpful when working
-        // with single-threaded contexts like in the OpenGL API.
-        // * if several systems with the same update order have this option
+        // disabled, on_update() and on_trigger_batch() may be invoked on any of
+        // the worker threads of the world's thread pool, and not necessarily
+        // the same one in every iteration. the other abstract functions are
+        // always invoked on the same thread that is running the world. this
+        // option is especially helpful when working with single-threaded
+        // contexts like in the OpenGL API.
+        // * if several systems that could run in parallel have this option
         //   enabled, they will not be parallelized, as they'll need to run on the
         //   same thread.
         bool run_on_world_thread = false;
 
+        // update the system in fixed time steps when the world has a fixed
+        // timestep (see world_t::set_fixed_timestep()), which suits systems
+        // that simulate physics or anything else that must not depend on the
+        // frame rate. the world simulates the time since the last iteration
+        // with as many steps as needed, updating the fixed-step systems in
+        // each step before updating the rest of the systems once.
+        // * without a fixed timestep, the system is updated once per
+        //   iteration like the others.
+        bool fixed_step = false;
+
+        // update the system at most this many times per second instead of in
+        // every iteration, for expensive systems that don't need to keep up
+        // with the frame rate (like AI). use 0 to update in every iteration.
+        // * fixed-step systems count the simulated time, not the real time.
+        f64 tick_rate = 0;
+
+        // update the system only in every n-th iteration (or fixed step, for
+        // fixed-step systems). use 1 to update in every iteration.
+        u32 tick_divisor = 1;
+
+        // * the world spreads out the ticks of systems with the same tick
+        //   rate or divisor over the iterations in between, so that they
+        //   don't all get updated in the same iteration.
+        // * a system that's not updated in an iteration doesn't hold back the
+        //   systems that depend on it, and its iter.dt is the time since its
+        //   last update.
+        // * these don't affect how the system is triggered by events.
+
         constexpr execution_scheme_t(
             i32 update_order,
-            bool run_on_world_thread = false
+            bool run_on_world_thread = false,
+            bool fixed_step = false
         )
             : update_order(update_order),
-            run_on_world_thread(run_on_world_thread)
+            run_on_world_thread(run_on_world_thread),
+            fixed_step(fixed_step)
         {}
     };
 
@@ -53,8 +89,37 @@ namespace gsx::ecs
     public:
         const std::string name;
         const execution_scheme_t exec_scheme;
+
+        // types of the events (event_t) that trigger the system.
+        // * the world looks these up along with the subscriptions when it
+        //   prepares its schedule, so changing them after the system was
+        //   added only takes effect once world_t::invalidate_schedule() is
+        //   called, in the next run.
         std::set<event_type_t> triggers;
 
+        // a typed event channel that the system receives events from. see
+        // subscribe().
+        struct subscription_t
+        {
+            type_id_t type;
+
+            // the system as an event_handler_t<T>*, where T is the event type
+            void* handler;
+        };
+
+        std::vector<subscription_t> subscriptions;
+
+        // types of the components (or any other data shared between systems)
+        // that on_update() reads from and writes to. the parent world uses
+        // these to find out which systems can be updated in parallel
+        // regardless of their update orders.
+        // * a system that declares neither reads nor writes is assumed to
+        //   access everything.
+        // * like the triggers, these are looked up when the world prepares
+        //   its schedule.
+        std::set<type_id_t> reads;
+        std::set<type_id_t> writes;
+
         base_system_t(
             const std::string& name,
             const execution_scheme_t& exec_scheme
@@ -62,13 +127,42 @@ namespace gsx::ecs
         no_copy_construct_no_assignment(base_system_t);
         virtual ~base_system_t() = default;
 
+        template<typename T>
+        void declare_read()
+        {
+            reads.insert(type_id_of<T>());
+        }
+
+        template<typename T>
+        void declare_write()
+        {
+            writes.insert(type_id_of<T>());
+        }
+
+        // receive the events of type T emitted with world_t::emit<T>(). the
+        // handler is usually the system itself (this).
+        template<typename T>
+        void subscribe(event_handler_t<T>* handler)
+        {
+            subscriptions.push_back(subscription_t{ type_id_of<T>(), handler });
+        }
+
+        // whether the system has declared reads or writes
+        bool declares_access() const;
+
+        // whether the system and another one can't be updated at the same
+        // time, because either of them writes to a type that the other one
+        // accesses, or either of them hasn't declared its access.
+        bool conflicts_with(const base_system_t& other) const;
+
         // called when the world starts running, in the order in which the
         // systems were added.
         // * avoid starting separate threads that keep running after returning
         //   from this function.
         virtual void on_start(world_t& world);
 
-        // called when triggered by an event.
+        // called when triggered by an event. this is invoked by the default
+        // implementation of on_trigger_batch().
         // * avoid starting separate threads that keep running after returning
         //   from this function.
         virtual void on_trigger(
@@ -77,6 +171,20 @@ namespace gsx::ecs
             const event_t& event
         );
 
+        // called at the start of an iteration with every pending event of a
+        // given type that triggers the system, in the order in which they
+        // were enqueued. this is invoked once per event type, and systems
+        // that don't conflict may be triggered in parallel (see
+        // conflicts_with()). the default implementation invokes on_trigger()
+        // for each event.
+        // * avoid starting separate threads that keep running after returning
+        //   from this function.
+        virtual void on_trigger_batch(
+            world_t& world,
+            const iteration_t& iter,
+            std::span<const event_t> events
+        );
+
         // called in every iteration when the world is running. a system would
         // typically get a list of components it's interested in, iterate over
         // them, and update them. the iteration can be manually parallelized by
@@ -0,0 +1,179 @@
+#include "trace.h"
+
+#include <format>
+#include <stdexcept>
+
+namespace gsx::ecs
+{
+
+    // the trace only describes a single process, the world
+    static constexpr u32 trace_pid = 1;
+
+    void tracer_t::set_output(const std::string& filename)
+    {
+        std::scoped_lock lock(mutex_output);
+        output = filename;
+    }
+
+    std::string tracer_t::get_output() const
+    {
+        std::scoped_lock lock(mutex_output);
+        return output;
+    }
+
+    void tracer_t::begin_run(const std::string& world_name, usize n_workers)
+    {
+        std::string filename = get_output();
+        active = !filename.empty();
+        if (!active)
+            return;
+
+        trace_file.open(filename, std::ofstream::out | std::ofstream::trunc);
+        if (!trace_file.is_open())
+        {
+            active = false;
+            throw std::runtime_error(std::format(
+                "trace file \"{}\" couldn't be created/opened",
+                filename
+            ));
+        }
+
+        time_start = std::chrono::high_resolution_clock::now();
+        iteration = 0;
+        buffers.assign(n_workers + 1, {});
+
+        trace_file << '[';
+
+        // name the process and the threads
+        trace_file << std::format(
+            "\n{{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":{},\"tid\":0,"
+            "\"args\":{{\"name\":",
+            trace_pid
+        );
+        write_json_string(trace_file, world_name);
+        trace_file << "}}";
+
+        write_thread_name(0, "world runner thread");
+        for (usize i = 0; i < n_workers; i++)
+        {
+            write_thread_name(i + 1, std::format("worker thread #{}", i));
+        }
+    }
+
+    void tracer_t::begin_iteration(u64 iteration)
+    {
+        this->iteration = iteration;
+    }
+
+    void tracer_t::record(
+        usize thread_index,
+        std::string_view category,
+        std::string_view name,
+        time_point_t start
+    )
+    {
+        if (!active || thread_index >= buffers.size())
+            return;
+
+        auto end = std::chrono::high_resolution_clock::now();
+        auto to_us = [this](time_point_t t)
+        {
+            return 1e-3 * (f64)std::chrono::duration_cast<
+                std::chrono::nanoseconds
+            >(t - time_start).count();
+        };
+
+        f64 start_us = to_us(start);
+        buffers[thread_index].push_back(span_t{
+            category,
+            name,
+            iteration,
+            start_us,
+            to_us(end) - start_us
+        });
+    }
+
+    void tracer_t::flush()
+    {
+        if (!active)
+            return;
+
+        for (usize thread = 0; thread < buffers.size(); thread++)
+        {
+            for (auto& span : buffers[thread])
+            {
+                trace_file << ",\n{\"name\":";
+                write_json_string(trace_file, span.name);
+                trace_file << ",\"cat\":";
+                write_json_string(trace_file, span.category);
+                trace_file << std::format(
+                    ",\"ph\":\"X\",\"ts\":{:.3f},\"dur\":{:.3f},\"pid\":{},"
+                    "\"tid\":{},\"args\":{{\"iteration\":{}}}}}",
+                    span.start,
+                    span.duration,
+                    trace_pid,
+                    thread,
+                    span.iteration
+                );
+            }
+            buffers[thread].clear();
+        }
+    }
+
+    void tracer_t::end_run()
+    {
+        if (!active)
+            return;
+
+        flush();
+        trace_file << "\n]\n";
+        trace_file.close();
+        active = false;
+    }
+
+    void tracer_t::write_thread_name(
+        usize thread_index,
+        const std::string& name
+    )
+    {
+        trace_file << std::format(
+            ",\n{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":{},\"tid\":{},"
+            "\"args\":{{\"name\":",
+            trace_pid,
+            thread_index
+        );
+        write_json_string(trace_file, name);
+        trace_file << "}}";
+    }
+
+    void tracer_t::write_json_string(std::ostream& stream, std::string_view s)
+    {
+        stream << '"';
+        for (char c : s)
+        {
+            switch (c)
+            {
+            case '"':
+                stream << "\\\"";
+                break;
+            case '\\':
+                stream << "\\\\";
+                break;
+            case '\n':
+                stream << "\\n";
+                break;
+            case '\t':
+                stream << "\\t";
+                break;
+            default:
+                if ((u8)c < 0x20)
+                    stream << std::format("\\u{:04x}", (u32)(u8)c);
+                else
+                    stream << c;
+                break;
+            }
+        }
+        stream << '"';
+    }
+
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <fstream>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+
+#include "../internal_common/all.h"
+
+namespace gsx::ecs
+{
+
+    // writes a trace of a world's runs in the Trace Event format, which can
+    // be opened in chrome://tracing or in Perfetto (ui.perfetto.dev) to see
+    // when and on which thread every system was triggered and updated, and
+    // where threads were waiting or sleeping.
+    // * every span is written as a complete event ("ph": "X"), which is a
+    //   begin and an end event in one, tagged with the thread that ran it
+    //   (0 for the thread running the world, i + 1 for worker thread #i) and
+    //   the iteration it belongs to.
+    // * spans are gathered in a buffer per thread without locking, and the
+    //   world writes them to the file at the end of every iteration, so
+    //   traces of long runs don't fill up the memory.
+    class tracer_t
+    {
+    public:
+        using time_point_t = std::chrono::high_resolution_clock::time_point;
+
+        tracer_t() = default;
+        no_copy_construct_no_assignment(tracer_t);
+
+        // trace the next runs of the world to a file, which is overwritten at
+        // the start of every run. use an empty filename to stop tracing.
+        // * this takes effect in the next run.
+        void set_output(const std::string& filename);
+
+        std::string get_output() const;
+
+        // whether the current run is being traced
+        constexpr bool is_active() const
+        {
+            return active;
+        }
+
+        // open the output file, if any, and prepare a buffer for each thread.
+        // * throws an exception if the file can't be created.
+        // * this function is called internally by world_t::run().
+        void begin_run(const std::string& world_name, usize n_workers);
+
+        // set the iteration that the following spans belong to.
+        // * this function is called internally by world_t::run() while no
+        //   other thread is recording spans.
+        void begin_iteration(u64 iteration);
+
+        time_point_t now() const
+        {
+            if (!active)
+                return time_point_t{};
+            return std::chrono::high_resolution_clock::now();
+        }
+
+        // record a span that started at start and ends now, on a thread.
+        // category and name must stay valid until the next flush().
+        void record(
+            usize thread_index,
+            std::string_view category,
+            std::string_view name,
+            time_point_t start
+        );
+
+        // write the recorded spans to the file.
+        // * this function is called internally by world_t::run() while no
+        //   other thread is recording spans.
+        void flush();
+
+        // write the remaining spans and close the file.
+        // * this function is called internally by world_t::run().
+        void end_run();
+
+    private:
+        struct span_t
+        {
+            std::string_view category;
+            std::string_view name;
+            u64 iteration;
+
+            // microseconds since the start of the run
+            f64 start;
+            f64 duration;
+        };
+
+        mutable std::mutex mutex_output;
+        std::string output;
+
+        bool active = false;
+        std::ofstream trace_file;
+        time_point_t time_start;
+        u64 iteration = 0;
+
+        // spans recorded by each thread since the last flush
+        std::vector<std::vector<span_t>> buffers;
+
+        void write_thread_name(usize thread_index, const std::string& name);
+
+        static void write_json_string(std::ostream& stream, std::string_view s);
+
+    };
+
+}
@@ -0,0 +1,296 @@
+#pragma once
+
+#include <vector>
+#include <array>
+#include <span>
+#include <memory>
+#include <algorithm>
+#include <type_traits>
+#include <utility>
+#include <cstdint>
+
+#include "entity.h"
+#include "component.h"
+#include "archetype.h"
+#include "../internal_common/all.h"
+
+namespace gsx::ecs
+{
+
+    // a query over every entity that has all of the component types Ts. the
+    // component types are resolved at compile time, and the matching
+    // archetypes are found once upon construction, so iterating over a view
+    // only walks packed component columns.
+    // * use const component types for read-only access. iterating over a
+    //   chunk stamps the version of the view on the columns of the non-const
+    //   component types (see archetype_t), whether they're written to or not.
+    // * a view must not be used after a structural change in the registry it
+    //   was created from (creating or destroying entities, adding or removing
+    //   components). make a new view instead.
+    template<typename... Ts>
+    class view_t
+    {
+    public:
+        static_assert(sizeof...(Ts) > 0, "a view needs at least 1 component");
+
+        // * version is stamped on the chunks that are given out with mutable
+        //   access, so it must be the current version of the registry (see
+        //   registry_t::get_version()). an older one would hide the writes
+        //   from changed_since().
+        view_t(
+            const std::vector<std::unique_ptr<archetype_t>>& archetypes,
+            u64 version
+        )
+            : version(version)
+        {
+            const std::array<type_id_t, sizeof...(Ts)> ids{
+                type_id_of<Ts>()...
+            };
+            for (auto& archetype : archetypes)
+            {
+                match_t match;
+                match.archetype = archetype.get();
+
+                bool has_all = true;
+                for (usize i = 0; i < ids.size(); i++)
+                {
+                    isize index = archetype->column_index(ids[i]);
+                    if (index < 0)
+                    {
+                        has_all = false;
+                        break;
+                    }
+                    match.columns[i] = (usize)index;
+                }
+
+                if (has_all)
+                {
+                    matches.push_back(match);
+                }
+            }
+        }
+
+        // skip the entities that have any of the component types Us
+        template<typename... Us>
+        view_t& exclude()
+        {
+            const std::array<type_id_t, sizeof...(Us)> ids{
+                type_id_of<Us>()...
+            };
+            std::erase_if(
+                matches,
+                [&ids](const match_t& match)
+                {
+                    for (auto id : ids)
+                    {
+                        if (match.archetype->has(id))
+                            return true;
+                    }
+                    return false;
+                }
+            );
+            return *this;
+        }
+
+        // skip the chunks where none of the component types Us (or Ts, if
+        // Us is empty) have been written to since a given version, like the
+        // last version a system has seen (see iteration_t::last_version).
+        // * chunks are skipped as a whole, so some of the entities in a chunk
+        //   that isn't skipped may not have changed.
+        template<typename... Us>
+        view_t& changed_since(u64 version)
+        {
+            since = version;
+            is_filtering_changes = true;
+
+            const std::array<type_id_t, sizeof...(Us)> ids{
+                type_id_of<Us>()...
+            };
+            for (auto& match : matches)
+            {
+                match.changed_columns.clear();
+                if constexpr (sizeof...(Us) == 0)
+                {
+                    match.changed_columns.assign(
+                        match.columns.begin(),
+                        match.columns.end()
+                    );
+                }
+
+                // an archetype without any of Us never has changes in them
+                for (auto id : ids)
+                {
+                    isize index = match.archetype->column_index(id);
+                    if (index >= 0)
+                    {
+                        match.changed_columns.push_back((usize)index);
+                    }
+                }
+            }
+            return *this;
+        }
+
+        // total number of matching entities
+        usize size() const
+        {
+            usize count = 0;
+            for (auto& match : matches)
+            {
+                count += match.archetype->size();
+            }
+            return count;
+        }
+
+        // invoke fn(entities, columns...) for every chunk of matching
+        // entities, where entities is a std::span<const entity_t> and columns
+        // are tightly packed spans of each component type (std::span<Ts>...),
+        // all with the same length.
+        // * fn can also take the offset of the chunk as its first argument
+        //   (fn(offset, entities, columns...)), which is the number of
+        //   matching entities in the chunks before it, including the ones
+        //   skipped by changed_since().
+        template<typename F>
+        void each_chunk(F&& fn) const
+        {
+            usize offset = 0;
+            for (auto& match : matches)
+            {
+                archetype_t* archetype = match.archetype;
+                usize n_chunks = archetype->chunk_count();
+                for (usize chunk = 0; chunk < n_chunks; chunk++)
+                {
+                    if (!is_filtering_changes || has_changed(match, chunk))
+                    {
+                        invoke_chunk(
+                            fn,
+                            match,
+                            chunk,
+                            offset,
+                            std::index_sequence_for<Ts...>{}
+                        );
+                    }
+                    offset += archetype->chunk_size(chunk);
+                }
+            }
+        }
+
+        // invoke fn(entity, components...) or fn(components...) for every
+        // matching entity, where components are references (Ts&...).
+        template<typename F>
+        void each(F&& fn) const
+        {
+            each_chunk(
+                [&fn](
+                    std::span<const entity_t> entities,
+                    std::span<Ts>... cols
+                    )
+                {
+                    for (usize i = 0; i < entities.size(); i++)
+                    {
+                        if constexpr (std::is_invocable_v<F, entity_t, Ts&...>)
+                        {
+                            fn(entities[i], cols[i]...);
+                        }
+                        else
+                        {
+                            fn(cols[i]...);
+                        }
+                    }
+                }
+            );
+        }
+
+    private:
+        struct match_t
+        {
+            archetype_t* archetype;
+
+            // column index of each component type, in the same order as Ts
+            std::array<usize, sizeof...(Ts)> columns;
+
+            // column indices checked by changed_since()
+            std::vector<usize> changed_columns;
+        };
+
+        std::vector<match_t> matches;
+        u64 version;
+
+        // see changed_since()
+        u64 since = 0;
+        bool is_filtering_changes = false;
+
+        bool has_changed(const match_t& match, usize chunk) const
+        {
+            for (auto column : match.changed_columns)
+            {
+                if (match.archetype->get_version(chunk, column) >= since)
+                    return true;
+            }
+            return false;
+        }
+
+        template<typename F, usize... I>
+        void invoke_chunk(
+            F& fn,
+            const match_t& match,
+            usize chunk,
+            usize offset,
+            std::index_sequence<I...>
+        ) const
+        {
+            archetype_t* archetype = match.archetype;
+            usize count = archetype->chunk_size(chunk);
+            (
+                [&]
+                {
+                    if constexpr (!std::is_const_v<Ts>)
+                    {
+                        archetype->set_version(
+                            chunk,
+                            match.columns[I],
+                            version
+                        );
+                    }
+                }(),
+                ...
+            );
+
+            std::span<const entity_t> entities(
+                archetype->entities(chunk),
+                count
+            );
+            if constexpr (std::is_invocable_v<
+                F&,
+                usize,
+                std::span<const entity_t>,
+                std::span<Ts>...
+            >)
+            {
+                fn(
+                    offset,
+                    entities,
+                    std::span<Ts>(
+                        static_cast<Ts*>(
+                            archetype->column(chunk, match.columns[I])
+                        ),
+                        count
+                    )...
+                );
+            }
+            else
+            {
+                fn(
+                    entities,
+                    std::span<Ts>(
+                        static_cast<Ts*>(
+                            archetype->column(chunk, match.columns[I])
+                        ),
+                        count
+                    )...
+                );
+            }
+        }
+
+    };
+
+}
@@ -1,32 +1,109 @@
 #include "world.h"
 
 #include <stdexcept>
+#include <algorithm>
+#include <functional>
+#include <optional>
+#include <deque>
+#include <unordered_map>
+#include <atomic>
+#include <array>
+#include <cmath>
+#include <thread>
 
 #include "system.h"
 
 namespace gsx::ecs
 {
 
+    // the world whose system is running on the calling thread, if any
+    static thread_local const world_t* system_world = nullptr;
+
+    // the world whose parallel_for() range is running on the calling thread,
+    // if any
+    static thread_local const world_t* range_world = nullptr;
+
+    static std::atomic<u64> next_world_id = 0;
+
+    // the IDs of the worlds that are alive, and the number of worlds
+    // destroyed so far, so that threads can forget the command buffers and
+    // channels of destroyed worlds. see world_t::get_commands().
+    static std::mutex mutex_live_worlds;
+    static std::vector<u64> live_world_ids;
+    static std::atomic<u64> n_destroyed_worlds = 0;
+
+    // remove the entries of destroyed worlds from a list that belongs to the
+    // calling thread, if any world was destroyed since it was last pruned.
+    // * the lists are pruned here rather than when the worlds are destroyed,
+    //   since they belong to the threads. threads that run many short-lived
+    //   worlds, like the workers of a shared pool, don't keep a growing list
+    //   this way.
+    template<typename T>
+    static void prune_destroyed_worlds(
+        std::vector<std::pair<u64, T>>& entries,
+        u64& n_pruned_destroyed
+    )
+    {
+        const u64 n_destroyed =
+            n_destroyed_worlds.load(std::memory_order_acquire);
+        if (n_destroyed == n_pruned_destroyed)
+            return;
+
+        std::scoped_lock lock(mutex_live_worlds);
+        std::erase_if(
+            entries,
+            [](const std::pair<u64, T>& entry)
+            {
+                return std::find(
+                    live_world_ids.begin(),
+                    live_world_ids.end(),
+                    entry.first
+                ) == live_world_ids.end();
+            }
+        );
+        n_pruned_destroyed = n_destroyed;
+    }
+
     world_t::world_t(
         const std::string& name,
         log_level_t max_log_level,
-        std::shared_ptr<base_logger_t> logger
+        std::shared_ptr<base_logger_t> logger,
+        std::shared_ptr<misc::thread_pool_t> thread_pool
     )
         : name(name),
         max_log_level(max_log_level),
-        logger(logger)
+        logger(logger),
+        log_name(intern_log_name(name)),
+        id(next_world_id++),
+        thread_pool(thread_pool)
     {
         if (logger == nullptr)
             throw std::runtime_error("the world logger must not be null");
 
+        {
+            std::scoped_lock lock(mutex_live_worlds);
+            live_world_ids.push_back(id);
+        }
+
         gsx_log(this, log_level_t::info, "world created");
     }
 
     world_t::~world_t()
     {
+        {
+            std::scoped_lock lock(mutex_live_worlds);
+            std::erase(live_world_ids, id);
+            n_destroyed_worlds.fetch_add(1, std::memory_order_release);
+        }
+
         gsx_log(this, log_level_t::info, "world destroyed");
     }
 
+    void world_t::log(log_level_t log_level, const char* message)
+    {
+        gsx_log(this, log_level, message);
+    }
+
     void world_t::log(log_level_t log_level, const std::string& message)
     {
         gsx_log(this, log_level, message);
@@ -34,17 +111,28 @@ namespace gsx::ecs
 
     void world_t::enqueue_event(const event_t& event)
     {
-        gsx_log(this, log_level_t::verbose,
-            "enqueueing an event of type " + std::to_string(event.type));
+        check_event_order();
+        if (is_external_input())
+        {
+            add_input(
+                [event](world_t& world)
+                {
+                    world.log_enqueue_event(event.type);
+                    world.events.push(event);
+                }
+            );
+            return;
+        }
 
-        std::scoped_lock lock(mutex_events);
-        events.push_back(event);
+        log_enqueue_event(event.type);
+        events.push(event);
     }
 
     std::shared_ptr<base_system_t> world_t::get_system_named(
         const std::string& name
     )
     {
+        std::scoped_lock lock(mutex_systems);
         for (auto& system : systems)
         {
             if (system->name == name)
@@ -57,55 +145,329 @@ namespace gsx::ecs
 
     void world_t::add_system(const std::shared_ptr<base_system_t>& system)
     {
-        gsx_log(this, log_level_t::verbose, std::format(
+        gsx_log(this, log_level_t::verbose,
             "adding a new system named \"{}\"",
             system->name
-        ));
+        );
 
-        systems.push_back(system);
+        change_systems(system_change_t{
+            system_change_t::kind_t::add,
+            system
+        });
     }
 
     void world_t::remove_first_system_named(const std::string& sname)
     {
-        gsx_log(this, log_level_t::verbose, std::format(
+        gsx_log(this, log_level_t::verbose,
             "removing the first system named \"{}\"",
             sname
-        ));
+        );
+
+        change_systems(system_change_t{
+            system_change_t::kind_t::remove_first_named,
+            nullptr,
+            sname
+        });
+    }
+
+    void world_t::remove_all_systems_named(const std::string& sname)
+    {
+        gsx_log(this, log_level_t::verbose,
+            "removing all systems named \"{}\"",
+            sname
+        );
+
+        change_systems(system_change_t{
+            system_change_t::kind_t::remove_all_named,
+            nullptr,
+            sname
+        });
+    }
+
+    void world_t::remove_all_systems()
+    {
+        gsx_log(this, log_level_t::verbose, "removing all systems");
+
+        change_systems(system_change_t{
+            system_change_t::kind_t::remove_all
+        });
+    }
+
+    void world_t::change_systems(system_change_t change)
+    {
+        std::scoped_lock lock(mutex_systems);
+        if (is_running)
+        {
+            system_changes.push_back(std::move(change));
+            return;
+        }
+
+        apply_system_change(change);
+    }
 
-        for (usize i = 0; i < systems.size(); i++)
+    void world_t::apply_system_change(const system_change_t& change)
+    {
+        switch (change.kind)
         {
-            if (systems[i]->name == sname)
+        case system_change_t::kind_t::add:
+            systems.push_back(change.system);
+            invalidate_schedule();
+            break;
+
+        case system_change_t::kind_t::remove_first_named:
+            for (usize i = 0; i < systems.size(); i++)
             {
-                misc::vec_remove(systems, i);
-                break;
+                if (systems[i]->name == change.name)
+                {
+                    misc::vec_remove(systems, i);
+                    invalidate_schedule();
+                    break;
+                }
+            }
+            break;
+
+        case system_change_t::kind_t::remove_all_named:
+            for (usize i = 0; i < systems.size();)
+            {
+                if (systems[i]->name == change.name)
+                {
+                    misc::vec_remove(systems, i);
+                    invalidate_schedule();
+                }
+                else
+                {
+                    i++;
+                }
             }
+            break;
+
+        case system_change_t::kind_t::remove_all:
+            misc::vec_clear(systems);
+            invalidate_schedule();
+            break;
         }
     }
 
-    void world_t::remove_all_systems_named(const std::string& sname)
+    command_buffer_t& world_t::get_commands()
     {
-        gsx_log(this, log_level_t::verbose, std::format(
-            "removing all systems named \"{}\"",
-            sname
+#if !defined(NDEBUG)
+        if (is_playback_active.load(std::memory_order_relaxed)
+            && system_world != this
+            && range_world != this)
+        {
+            throw std::runtime_error(
+                "commands can only be recorded from the systems while the "
+                "world is running"
+            );
+        }
+#endif
+
+        // the buffers of the calling thread by world ID
+        thread_local std::vector<std::pair<u64, command_buffer_t*>> buffers;
+
+        // the number of destroyed worlds when the buffers were last pruned
+        thread_local u64 n_pruned_destroyed = 0;
+
+        for (auto& [world_id, buffer] : buffers)
+        {
+            if (world_id == id)
+                return *buffer;
+        }
+
+        prune_destroyed_worlds(buffers, n_pruned_destroyed);
+
+        std::scoped_lock lock(mutex_commands);
+        command_buffers.push_back(std::make_unique<command_buffer_t>(
+            (u32)command_buffers.size()
         ));
+        buffers.emplace_back(id, command_buffers.back().get());
+        return *command_buffers.back();
+    }
+
+    std::vector<base_event_channel_t*>& world_t::get_channel_cache()
+    {
+        // the channels of the calling thread by world ID
+        thread_local std::vector<
+            std::pair<u64, std::vector<base_event_channel_t*>>
+        > caches;
+
+        // the number of destroyed worlds when the caches were last pruned
+        thread_local u64 n_pruned_destroyed = 0;
+
+        for (auto& [world_id, cache] : caches)
+        {
+            if (world_id == id)
+                return cache;
+        }
+
+        prune_destroyed_worlds(caches, n_pruned_destroyed);
+        caches.emplace_back(id, std::vector<base_event_channel_t*>());
+        return caches.back().second;
+    }
+
+    entity_t world_t::create_entity()
+    {
+        return registry.create();
+    }
+
+    void world_t::destroy_entity(entity_t entity)
+    {
+        registry.destroy(entity);
+    }
+
+    void world_t::save_snapshot(world_snapshot_t& out_snapshot)
+    {
+        auto lock_run = lock_for_snapshot("save");
+
+        // * the snapshot is built on the side, so that if copying anything
+        //   throws, out_snapshot is left as it was.
+        world_snapshot_t snapshot;
+        registry.save(snapshot.registry);
 
-        for (usize i = 0; i < systems.size();)
         {
-            if (systems[i]->name == sname)
+            std::scoped_lock lock(mutex_resources);
+            snapshot.resources.resize(resources.size());
+            for (usize i = 0; i < resources.size(); i++)
             {
-                misc::vec_remove(systems, i);
+                if (resources[i])
+                {
+                    snapshot.resources[i] = resources[i]->clone();
+                }
             }
-            else
+        }
+
+        // the events are copied in place, so events enqueued meanwhile stay
+        // behind the older ones
+        events.for_each(
+            [&snapshot](const event_t& event)
+            {
+                snapshot.events.push_back(event);
+            }
+        );
+
+        {
+            std::shared_lock lock(mutex_channels);
+            snapshot.channels.resize(channels.size());
+            for (usize i = 0; i < channels.size(); i++)
             {
-                i++;
+                if (!channels[i])
+                    continue;
+
+                auto saved = channels[i]->save_pending();
+                if (saved->size() > 0)
+                {
+                    snapshot.channels[i] = std::move(saved);
+                }
             }
         }
+
+        out_snapshot.swap(snapshot);
+
+        gsx_log(this, log_level_t::info,
+            "saved a snapshot of {} entities ({} bytes of components), "
+            "{} event(s) and {} typed event(s)",
+            out_snapshot.registry.size(),
+            out_snapshot.registry.size_bytes(),
+            out_snapshot.events.size(),
+            out_snapshot.typed_event_count()
+        );
     }
 
-    void world_t::remove_all_systems()
+    void world_t::restore_snapshot(const world_snapshot_t& snapshot)
     {
-        gsx_log(this, log_level_t::verbose, "removing all systems");
-        misc::vec_clear(systems);
+        auto lock_run = lock_for_snapshot("restore");
+
+        {
+            std::scoped_lock lock(mutex_resources);
+
+            // copy the resources that the world doesn't have and check that
+            // the rest can be assigned before changing anything, so that a
+            // resource that can't be copied leaves the world as it was
+            std::vector<std::unique_ptr<base_resource_t>> added(
+                snapshot.resources.size()
+            );
+            for (usize i = 0; i < snapshot.resources.size(); i++)
+            {
+                const base_resource_t* saved = snapshot.resources[i].get();
+                if (!saved)
+                    continue;
+
+                if (i < resources.size() && resources[i])
+                {
+                    if (!resources[i]->is_assignable())
+                        throw std::runtime_error(
+                            "the resource isn't copy assignable"
+                        );
+                }
+                else
+                {
+                    added[i] = saved->clone();
+                }
+            }
+
+            registry.restore(snapshot.registry);
+
+            if (resources.size() < snapshot.resources.size())
+            {
+                resources.resize(snapshot.resources.size());
+            }
+            for (usize i = 0; i < resources.size(); i++)
+            {
+                const base_resource_t* saved = (i < snapshot.resources.size())
+                    ? snapshot.resources[i].get()
+                    : nullptr;
+                if (!saved)
+                {
+                    resources[i].reset();
+                }
+                else if (added[i])
+                {
+                    resources[i] = std::move(added[i]);
+                }
+                else
+                {
+                    resources[i]->assign(*saved);
+                }
+            }
+        }
+
+        events.drain([](event_t&) {});
+        for (auto& event : snapshot.events)
+        {
+            events.push(event);
+        }
+
+        // the typed events emitted since the snapshot was saved are
+        // discarded along with the rest of the pending ones
+        {
+            std::unique_lock lock(mutex_channels);
+            if (channels.size() < snapshot.channels.size())
+            {
+                channels.resize(snapshot.channels.size());
+            }
+            for (usize i = 0; i < channels.size(); i++)
+            {
+                const base_event_list_t* saved =
+                    (i < snapshot.channels.size())
+                    ? snapshot.channels[i].get()
+                    : nullptr;
+                if (!channels[i])
+                {
+                    if (!saved)
+                        continue;
+                    channels[i] = saved->make_channel();
+                }
+                channels[i]->restore_pending(saved);
+            }
+        }
+
+        gsx_log(this, log_level_t::info,
+            "restored a snapshot of {} entities, {} event(s) and {} typed "
+            "event(s)",
+            snapshot.registry.size(),
+            snapshot.events.size(),
+            snapshot.typed_event_count()
+        );
     }
 
     void world_t::run(const f64 max_update_rate, const f64 max_run_time)
@@ -113,37 +475,108 @@ namespace gsx::ecs
         gsx_log(this, log_level_t::info, "preparing to run");
 
         if (max_update_rate != 0)
-            gsx_log(this, log_level_t::info, std::format(
+            gsx_log(this, log_level_t::info,
                 "max_update_rate = {:.3f} iterations/s",
                 max_update_rate
-            ));
+            );
 
         if (max_run_time != 0)
-            gsx_log(this, log_level_t::info, std::format(
+            gsx_log(this, log_level_t::info,
                 "max_run_time = {:.3f} s",
                 max_run_time
-            ));
+            );
 
         should_stop = true;
         std::scoped_lock lock(mutex_run);
         should_stop = false;
 
-        // make a copy of the system list and only ever work with the copied
-        // list.
-        auto systems_copy = systems;
+        // without a fixed timestep, every system is updated once per
+        // iteration
+        const f64 step = fixed_timestep;
+        const u32 max_steps = std::max(1u, max_substeps);
 
-        std::vector<system_group_t> system_groups;
-        worker_map_t worker_map;
-        prepare_system_groups_and_workers(
-            systems_copy,
-            system_groups,
-            worker_map
-        );
+        // changes to the system list are queued from now on, and applied at
+        // the start of the next iteration
+        run_scope_t run_scope(*this);
+
+        const replay_mode_t mode = replay_mode;
+        if (mode == replay_mode_t::record)
+        {
+            gsx_log(this, log_level_t::info, "recording the run");
+            recording->seed = seed;
+            recording->iterations.clear();
+        }
+        else if (mode == replay_mode_t::replay)
+        {
+            gsx_log(this, log_level_t::info,
+                "replaying a run of {} iteration(s)",
+                recording->iterations.size()
+            );
+            seed = recording->seed;
+        }
+        is_run_deterministic = deterministic || mode != replay_mode_t::none;
+
+        // reuse the schedule of the previous run unless something it was
+        // prepared from has changed
+        bool is_stale = is_schedule_stale.exchange(false);
+        if (!schedule || is_stale || schedule->fixed_timestep != step)
+        {
+            prepare_schedule(step);
+        }
+        else
+        {
+            gsx_log(this, log_level_t::info,
+                "reusing the schedule of the previous run"
+            );
+            profiler.clear_samples();
+        }
+
+        // only ever work with the copied system list
+        auto& systems_copy = schedule->systems;
+        auto& profiles = schedule->profiles;
+        auto& fixed_system_nodes = schedule->fixed_system_nodes;
+        auto& system_nodes = schedule->system_nodes;
+        auto& event_subscribers = schedule->event_subscribers;
+
+        reset_ticks(fixed_system_nodes);
+        reset_ticks(system_nodes);
+
+        if (step > 0)
+            gsx_log(this, log_level_t::info,
+                "fixed timestep = {:.6f} s (at most {} step(s) per iteration)",
+                step,
+                max_steps
+            );
+
+        if (!thread_pool)
+        {
+            thread_pool = std::make_shared<misc::thread_pool_t>();
+            gsx_log(this, log_level_t::info,
+                "created a thread pool with {} worker thread(s)",
+                thread_pool->size()
+            );
+        }
+
+        try
+        {
+            tracer.begin_run(name, thread_pool->size());
+        }
+        catch (const std::exception& e)
+        {
+            gsx_log(this, log_level_t::error,
+                "the run won't be traced: \"{}\"",
+                e.what()
+            );
+        }
 
         bool did_start_all;
-        start_systems(systems_copy, worker_map, did_start_all);
+        start_systems(systems_copy, did_start_all);
 
         iteration_t iter;
+
+        // time that's yet to be simulated in fixed steps
+        f64 accumulator = 0;
+
         auto time_start = std::chrono::high_resolution_clock::now();
         auto time_last_iter = time_start;
         const f64 min_dt =
@@ -153,48 +586,140 @@ namespace gsx::ecs
 
         if (did_start_all)
         {
+            // make the changes recorded before the run or in on_start(), so
+            // the first group sees them
+            play_back_commands();
+
             gsx_log(this, log_level_t::info, "starting the loop");
 
+            frame_pacer.reset(min_dt);
+
             // start the loop
             while (!should_stop)
             {
-                gsx_log(this, log_level_t::verbose, std::format(
+                gsx_log(this, log_level_t::verbose,
                     "loop iteration {} (elapsed = {:.3f} s, dt = {:.3f} s)",
                     iter.i, iter.time, iter.dt
-                ));
+                );
 
                 bool did_process_all_events = false;
                 bool did_update_all = false;
 
+                tracer.begin_iteration(iter.i);
+                auto trace_iter = tracer.now();
+
+                bool did_start_added;
+                apply_system_changes(iter, did_start_added);
+                if (!did_start_added)
+                    break;
+
+                if (mode == replay_mode_t::replay
+                    && iter.i >= recording->iterations.size())
+                {
+                    gsx_log(this, log_level_t::info,
+                        "breaking the loop because the replay is over"
+                    );
+                    break;
+                }
+                if (mode != replay_mode_t::none)
+                {
+                    record_or_replay_inputs(iter);
+                }
+
+                auto trace_start = tracer.now();
                 process_events(
                     systems_copy,
-                    worker_map,
+                    profiles,
+                    event_subscribers,
                     iter,
                     did_process_all_events
                 );
+                tracer.record(0, "world", "process events", trace_start);
 
                 if (did_process_all_events)
                 {
-                    update_systems(
-                        system_groups,
-                        worker_map,
-                        iter,
-                        did_update_all
-                    );
+                    trace_start = tracer.now();
+                    did_update_all = true;
+
+                    // simulate the time since the last iteration in fixed
+                    // steps
+                    if (step > 0)
+                    {
+                        accumulator += iter.dt;
+
+                        u32 n_steps = 0;
+                        while (accumulator >= step
+                            && n_steps < max_steps
+                            && did_update_all)
+                        {
+                            iteration_t step_iter = iter;
+                            step_iter.time = (f64)iter.step * step;
+                            step_iter.dt = step;
+
+                            update_systems(
+                                fixed_system_nodes,
+                                step_iter,
+                                step_iter.step,
+                                did_update_all
+                            );
+
+                            accumulator -= step;
+                            iter.step++;
+                            n_steps++;
+                        }
+
+                        if (accumulator >= step)
+                        {
+                            f64 n_dropped = std::floor(accumulator / step);
+                            accumulator -= n_dropped * step;
+                            gsx_log(this, log_level_t::verbose,
+                                "falling behind, dropped {} fixed step(s)",
+                                n_dropped
+                            );
+                        }
+
+                        iter.alpha = accumulator / step;
+                    }
+
+                    if (did_update_all)
+                    {
+                        update_systems(
+                            system_nodes,
+                            iter,
+                            iter.i,
+                            did_update_all
+                        );
+                    }
+                    tracer.record(0, "world", "update systems", trace_start);
                 }
 
                 // don't go faster than the maximum update rate
-                f64 time_left = min_dt - misc::elapsed_sec<f64>(time_last_iter);
-                if (time_left > 0)
+                if (min_dt > 0)
                 {
-                    misc::sleep(time_left);
+                    trace_start = tracer.now();
+                    frame_pacer.wait();
+                    tracer.record(0, "sleep", "sleep", trace_start);
                 }
 
-                // update iter
+                tracer.record(0, "world", "iteration", trace_iter);
+
+                // every worker is idle now, so the spans can be written
+                trace_start = tracer.now();
+                tracer.flush();
+                tracer.record(0, "world", "write trace", trace_start);
+
+                // update iter. a replay uses the recorded times, so that the
+                // run stops at the same time too.
                 iter.i++;
                 iter.time = misc::elapsed_sec<f64>(time_start);
                 iter.dt = misc::elapsed_sec<f64>(time_last_iter);
                 time_last_iter = std::chrono::high_resolution_clock::now();
+                if (mode == replay_mode_t::replay
+                    && iter.i < recording->iterations.size())
+                {
+                    iter.time = recording->iterations[iter.i].time;
+                    iter.dt = recording->iterations[iter.i].dt;
+                }
 
                 // stop running if one or more system failed to update or get
                 // triggered
@@ -215,245 +740,1061 @@ namespace gsx::ecs
             }
         }
 
-        stop_systems(systems_copy, worker_map, iter);
+        if (did_start_all && min_dt > 0)
+        {
+            auto pacing = frame_pacer.get_stats();
+            gsx_log(this, log_level_t::info,
+                "frame pacing: {} missed deadline(s) in {} iteration(s), "
+                "mean jitter = {:.1f} us, max jitter = {:.1f} us",
+                pacing.n_missed,
+                pacing.n_frames,
+                pacing.mean_jitter * 1e6,
+                pacing.max_jitter * 1e6
+            );
+        }
 
-        gsx_log(this, log_level_t::info, "stopped running");
+        stop_systems(systems_copy, iter);
+        play_back_commands();
     }
 
-    void world_t::stop(bool wait)
+    void world_t::set_fixed_timestep(f64 step, u32 max_substeps)
     {
-        gsx_log(this, log_level_t::info, std::format(
-            "signaling the world to stop running (wait = {})",
-            wait
-        ));
+        if (step < 0)
+            throw std::runtime_error("the fixed timestep must not be negative");
 
-        should_stop = true;
-        if (wait)
+        fixed_timestep = step;
+        this->max_substeps = max_substeps;
+    }
+
+    void world_t::set_seed(u64 seed)
+    {
+        this->seed = seed;
+    }
+
+    math::prng_t world_t::make_prng(
+        const base_system_t& system,
+        const iteration_t& iter
+    ) const
+    {
+        // FNV-1a, so that the streams don't depend on the standard library
+        u64 name_hash = 14695981039346656037ull;
+        for (char c : system.name)
         {
-            std::scoped_lock lock(mutex_run);
+            name_hash ^= (u8)c;
+            name_hash *= 1099511628211ull;
         }
+
+        const std::array<u64, 4> key{ seed, name_hash, iter.i, iter.step };
+        return math::prng_t(key);
     }
 
-    void world_t::prepare_system_groups_and_workers(
-        std::vector<std::shared_ptr<base_system_t>>& systems_copy,
-        std::vector<system_group_t>& out_system_groups,
-        worker_map_t& out_worker_map
+    void world_t::set_deterministic(bool deterministic)
+    {
+        this->deterministic = deterministic;
+    }
+
+    void world_t::set_replay(
+        replay_mode_t mode,
+        std::shared_ptr<world_recording_t> recording
     )
     {
-        gsx_log(
-            this,
-            log_level_t::info,
-            "preparing system groups and workers"
-        );
+        if (mode != replay_mode_t::none && !recording)
+            throw std::runtime_error("the recording must not be null");
 
-        // make a sorted and unique set of the update order values
-        std::set<i32, std::less<i32>> update_orders;
-        for (auto& system : systems_copy)
-        {
-            update_orders.insert(system->exec_scheme.update_order);
-        }
+        replay_mode = mode;
+        this->recording = recording;
+    }
 
-        // iterate over the sorted and unique update order values
-        for (auto curr_order : update_orders)
+    std::unique_lock<std::mutex> world_t::lock_for_snapshot(const char* action)
+    {
+        // * is_running is checked first, since a system of the running world
+        //   runs on the thread that holds mutex_run, and locking it again
+        //   from there would deadlock.
+        // * mutex_run is also held for a moment while a run wraps up after
+        //   clearing is_running, and while stop(true) waits for a run, so
+        //   this tries again until the world is either running or free.
+        while (true)
         {
-            // make a system group
-            system_group_t group;
-            group.update_order = curr_order;
-
-            // gather every system in the world with the current update order
-            for (auto& system : systems_copy)
             {
-                if (system->exec_scheme.update_order == curr_order)
-                {
-                    group.systems.push_back(system);
-                }
+                std::scoped_lock lock(mutex_systems);
+                if (is_running)
+                    throw std::runtime_error(std::format(
+                        "can't {} a snapshot while the world is running",
+                        action
+                    ));
             }
 
-            // prepare a worker for every system in the group, unless it wants
-            // to be updated on the same thread that is running the world. if
-            // the group contains only 1 system, then there will also be no
-            // paralellization and no need for a worker.
-            if (group.systems.size() > 1)
-            {
-                for (auto& system : group.systems)
-                {
-                    if (system->exec_scheme.run_on_world_thread)
-                    {
-                        out_worker_map[system.get()] = nullptr;
-                    }
-                    else
-                    {
-                        out_worker_map[system.get()] =
-                            std::make_shared<misc::worker_t>(
-                                out_worker_map.size()
-                            );
-                    }
-                }
+            std::unique_lock lock(mutex_run, std::try_to_lock);
+            if (lock.owns_lock())
+                return lock;
+
+            std::this_thread::yield();
+        }
+    }
+
+    std::unique_lock<std::mutex> world_t::lock_for_resource_change(
+        const char* action
+    )
+    {
+        // * run() sets is_running while holding mutex_systems, so it can't
+        //   start updating the systems until the lock is released
+        std::unique_lock lock(mutex_systems);
+        if (is_running)
+            throw std::runtime_error(std::format(
+                "can't {} a resource while the world is running",
+                action
+            ));
+        return lock;
+    }
+
+    void world_t::stop(bool wait)
+    {
+        gsx_log(this, log_level_t::info,
+            "signaling the world to stop running (wait = {})",
+            wait
+        );
+
+        should_stop = true;
+        if (wait)
+        {
+            std::scoped_lock lock(mutex_run);
+        }
+    }
+
+    world_t::system_scope_t::system_scope_t(const world_t& world)
+        : prev_world(system_world),
+        prev_range_world(range_world)
+    {
+        system_world = &world;
+        range_world = nullptr;
+    }
+
+    world_t::system_scope_t::system_scope_t(
+        world_t& world,
+        command_buffer_t::key_t key
+    )
+        : system_scope_t(world)
+    {
+        commands = &world.get_commands();
+        prev_key = commands->get_key();
+        commands->set_key(key);
+        if (key.range != 0)
+        {
+            range_world = &world;
+        }
+    }
+
+    world_t::system_scope_t::~system_scope_t()
+    {
+        if (commands)
+        {
+            commands->set_key(prev_key);
+        }
+        system_world = prev_world;
+        range_world = prev_range_world;
+    }
+
+    world_t::run_scope_t::run_scope_t(world_t& world)
+        : world(world)
+    {
+        world.begin_running();
+    }
+
+    world_t::run_scope_t::~run_scope_t()
+    {
+        world.end_running();
+    }
+
+    void world_t::begin_running()
+    {
+        {
+            std::scoped_lock lock_systems(mutex_systems);
+            is_running = true;
+        }
+        is_playback_active = true;
+    }
+
+    void world_t::end_running()
+    {
+        is_playback_active = false;
+        tracer.end_run();
+
+        // changes queued after the last iteration only change the list
+        {
+            std::scoped_lock lock_systems(mutex_systems);
+            is_running = false;
+            for (auto& change : system_changes)
+            {
+                apply_system_change(change);
             }
-            else if (group.systems.size() == 1)
+            system_changes.clear();
+        }
+
+        gsx_log(this, log_level_t::info, "stopped running");
+    }
+
+    bool world_t::is_external_input() const
+    {
+        return replay_mode.load(std::memory_order_relaxed)
+            != replay_mode_t::none
+            && system_world != this;
+    }
+
+    bool world_t::is_in_parallel_range() const
+    {
+        return range_world == this;
+    }
+
+    void world_t::add_input(recorded_input_t input)
+    {
+        if (replay_mode == replay_mode_t::replay)
+        {
+            gsx_log(this, log_level_t::verbose,
+                "ignoring an event from outside the world while replaying"
+            );
+            return;
+        }
+
+        inputs.push(std::move(input));
+    }
+
+    void world_t::record_or_replay_inputs(iteration_t& iter)
+    {
+        if (replay_mode == replay_mode_t::replay)
+        {
+            auto& recorded = recording->iterations[iter.i];
+            iter.time = recorded.time;
+            iter.dt = recorded.dt;
+            for (auto& input : recorded.inputs)
             {
-                out_worker_map[group.systems[0].get()] = nullptr;
+                input(*this);
             }
+            return;
+        }
+
+        auto& recorded = recording->iterations.emplace_back();
+        recorded.time = iter.time;
+        recorded.dt = iter.dt;
+        inputs.drain(
+            [this, &recorded](recorded_input_t& input)
+            {
+                input(*this);
+                recorded.inputs.push_back(std::move(input));
+            }
+        );
+    }
+
+    void world_t::invalidate_schedule()
+    {
+        is_schedule_stale = true;
+    }
+
+    void world_t::prepare_schedule(f64 step)
+    {
+        gsx_log(this, log_level_t::info, "preparing the schedule");
 
-            // add the group to the list
-            out_system_groups.push_back(group);
+        schedule = std::make_unique<schedule_t>();
+        schedule->fixed_timestep = step;
+
+        // make a copy of the system list so that changing the list while
+        // running doesn't affect the iteration in progress
+        {
+            std::scoped_lock lock(mutex_systems);
+            schedule->systems = systems;
         }
+
+        // profiles of the systems, indexed like the copied list
+        schedule->profiles = profiler.begin_run(schedule->systems);
+
+        build_schedule(*schedule);
     }
 
-    void world_t::start_systems(
-        std::vector<std::shared_ptr<base_system_t>>& systems_copy,
-        worker_map_t& worker_map,
+    void world_t::build_schedule(schedule_t& schedule)
+    {
+        auto& systems_copy = schedule.systems;
+
+        std::vector<usize> fixed_indices, variable_indices;
+        for (usize i = 0; i < systems_copy.size(); i++)
+        {
+            if (schedule.fixed_timestep > 0
+                && systems_copy[i]->exec_scheme.fixed_step)
+                fixed_indices.push_back(i);
+            else
+                variable_indices.push_back(i);
+        }
+
+        prepare_system_graph(
+            systems_copy,
+            schedule.profiles,
+            fixed_indices,
+            schedule.fixed_system_nodes
+        );
+        prepare_system_graph(
+            systems_copy,
+            schedule.profiles,
+            variable_indices,
+            schedule.system_nodes
+        );
+
+        prepare_event_subscribers(systems_copy, schedule.event_subscribers);
+    }
+
+    void world_t::apply_system_changes(
+        const iteration_t& iter,
         bool& out_did_start_all
     )
     {
         out_did_start_all = true;
 
-        // start the systems in serial in the order in which they were added
-        for (auto& system : systems_copy)
+        std::vector<std::shared_ptr<base_system_t>> new_systems;
         {
-            auto& worker = worker_map[system.get()];
-            if (worker)
+            std::scoped_lock lock(mutex_systems);
+            if (system_changes.empty())
+                return;
+
+            for (auto& change : system_changes)
             {
-                worker->enqueue(
-                    [this, &system, &worker, &out_did_start_all]()
-                    {
-                        if (!try_start_system(system, worker))
-                        {
-                            out_did_start_all = false;
-                        }
-                    }
-                );
-                worker->wait();
+                apply_system_change(change);
+            }
+            system_changes.clear();
+            new_systems = systems;
+
+            // the schedule is brought up to date below
+            is_schedule_stale = false;
+        }
+
+        auto trace_start = tracer.now();
+        gsx_log(this, log_level_t::info,
+            "applying the changes to the system list"
+        );
+
+        auto& old_systems = schedule->systems;
+        auto& old_profiles = schedule->profiles;
+
+        // the systems that are still in the list keep their profiles and
+        // their tick state
+        std::unordered_map<base_system_t*, usize> old_indices;
+        for (usize i = 0; i < old_systems.size(); i++)
+        {
+            old_indices.emplace(old_systems[i].get(), i);
+        }
+
+        std::vector<bool> is_kept(old_systems.size(), false);
+        std::vector<profiler_t::system_profile_t*> new_profiles(
+            new_systems.size(),
+            nullptr
+        );
+        std::vector<usize> added_indices;
+        for (usize i = 0; i < new_systems.size(); i++)
+        {
+            auto it = old_indices.find(new_systems[i].get());
+            if (it != old_indices.end() && !is_kept[it->second])
+            {
+                is_kept[it->second] = true;
+                new_profiles[i] = old_profiles[it->second];
             }
             else
             {
-                if (!try_start_system(system, worker))
+                added_indices.push_back(i);
+            }
+        }
+
+        // stop the removed systems before starting the added ones, so that a
+        // system can be replaced by another one with the same name
+        for (isize i = old_systems.size() - 1; i >= 0; i--)
+        {
+            if (is_kept[i])
+                continue;
+
+            try_stop_system(old_systems[i], iter);
+            profiler.remove_profile(old_profiles[i]);
+        }
+
+        for (auto index : added_indices)
+        {
+            if (!try_start_system(new_systems[index]))
+            {
+                out_did_start_all = false;
+            }
+            new_profiles[index] = profiler.add_profile(
+                new_systems[index]->name
+            );
+        }
+
+        struct tick_state_t
+        {
+            u64 tick_offset;
+            f64 next_tick_time;
+            f64 last_tick_time;
+            u64 last_version;
+        };
+        std::unordered_map<base_system_t*, tick_state_t> tick_states;
+        for (auto* nodes :
+            { &schedule->fixed_system_nodes, &schedule->system_nodes })
+        {
+            for (auto& node : *nodes)
+            {
+                tick_states[node.system.get()] = tick_state_t{
+                    node.tick_offset,
+                    node.next_tick_time,
+                    node.last_tick_time,
+                    node.last_version
+                };
+            }
+        }
+
+        schedule->systems = std::move(new_systems);
+        schedule->profiles = std::move(new_profiles);
+        build_schedule(*schedule);
+
+        // fixed-step systems count time in fixed steps
+        reset_ticks(
+            schedule->fixed_system_nodes,
+            (f64)iter.step * schedule->fixed_timestep
+        );
+        reset_ticks(schedule->system_nodes, iter.time);
+        for (auto* nodes :
+            { &schedule->fixed_system_nodes, &schedule->system_nodes })
+        {
+            for (auto& node : *nodes)
+            {
+                auto it = tick_states.find(node.system.get());
+                if (it == tick_states.end())
+                    continue;
+
+                node.tick_offset = it->second.tick_offset;
+                node.next_tick_time = it->second.next_tick_time;
+                node.last_tick_time = it->second.last_tick_time;
+                node.last_version = it->second.last_version;
+            }
+        }
+
+        gsx_log(this, log_level_t::info,
+            "{} system(s) added and {} removed while running",
+            added_indices.size(),
+            std::count(is_kept.begin(), is_kept.end(), false)
+        );
+        tracer.record(0, "world", "apply system changes", trace_start);
+    }
+
+    void world_t::prepare_system_graph(
+        std::vector<std::shared_ptr<base_system_t>>& systems_copy,
+        const std::vector<profiler_t::system_profile_t*>& profiles,
+        const std::vector<usize>& indices,
+        std::vector<system_node_t>& out_system_nodes
+    )
+    {
+        gsx_log(this, log_level_t::info, "preparing the system graph");
+
+        // sort the systems by their update orders. systems with the same
+        // update order stay in the order in which they were added.
+        std::vector<usize> sorted_indices = indices;
+        std::stable_sort(
+            sorted_indices.begin(),
+            sorted_indices.end(),
+            [&systems_copy](usize a, usize b)
+            {
+                return systems_copy[a]->exec_scheme.update_order
+                    < systems_copy[b]->exec_scheme.update_order;
+            }
+        );
+
+        out_system_nodes.clear();
+        for (auto index : sorted_indices)
+        {
+            system_node_t node{ systems_copy[index] };
+            node.profile = profiles[index];
+            out_system_nodes.push_back(std::move(node));
+        }
+
+        // make every system depend on the systems with lower update orders
+        // that it conflicts with
+        usize n_dependencies = 0;
+        for (usize i = 0; i < out_system_nodes.size(); i++)
+        {
+            const base_system_t& system = *out_system_nodes[i].system;
+            for (usize j = 0; j < i; j++)
+            {
+                const base_system_t& other = *out_system_nodes[j].system;
+                if (other.exec_scheme.update_order
+                    == system.exec_scheme.update_order)
+                    continue;
+
+                if (!system.conflicts_with(other))
+                    continue;
+
+                out_system_nodes[j].dependents.push_back(i);
+                out_system_nodes[i].n_dependencies++;
+                n_dependencies++;
+            }
+        }
+
+        gsx_log(this, log_level_t::info,
+            "the system graph has {} system(s) and {} dependencies",
+            out_system_nodes.size(),
+            n_dependencies
+        );
+    }
+
+    void world_t::prepare_event_subscribers(
+        std::vector<std::shared_ptr<base_system_t>>& systems_copy,
+        event_subscribers_t& out_subscribers
+    )
+    {
+        gsx_log(this, log_level_t::info, "preparing the event subscribers");
+
+        out_subscribers = event_subscribers_t();
+
+        for (usize i = 0; i < systems_copy.size(); i++)
+        {
+            auto& system = systems_copy[i];
+            for (auto type : system->triggers)
+            {
+                out_subscribers.by_event_type[type].push_back(i);
+            }
+            for (auto& subscription : system->subscriptions)
+            {
+                if (subscription.type >= out_subscribers.by_type_id.size())
                 {
-                    out_did_start_all = false;
+                    out_subscribers.by_type_id.resize(subscription.type + 1);
                 }
+                out_subscribers.by_type_id[subscription.type].push_back(
+                    channel_subscriber_t{ i, subscription.handler }
+                );
+            }
+        }
+    }
+
+    void world_t::start_systems(
+        std::vector<std::shared_ptr<base_system_t>>& systems_copy,
+        bool& out_did_start_all
+    )
+    {
+        out_did_start_all = true;
+
+        // start the systems in serial in the order in which they were added
+        for (auto& system : systems_copy)
+        {
+            if (!try_start_system(system))
+            {
+                out_did_start_all = false;
             }
         }
     }
 
     void world_t::process_events(
         std::vector<std::shared_ptr<base_system_t>>& systems_copy,
-        worker_map_t& worker_map,
+        const std::vector<profiler_t::system_profile_t*>& profiles,
+        const event_subscribers_t& subscribers,
         const iteration_t& iter,
         bool& out_did_process_all
     )
     {
         out_did_process_all = true;
 
-        std::unique_lock lock(mutex_events);
-        while (!events.empty())
+        // pending events bucketed by type, in the order in which they were
+        // enqueued
+        std::unordered_map<event_type_t, std::vector<event_t>> buckets;
+        std::vector<event_type_t> bucket_types;
+
+        // a batch of typed events to deliver to a system
+        struct delivery_t
         {
-            auto event = events.front();
-            events.pop_front();
-            lock.unlock();
-            for (auto& system : systems_copy)
+            type_id_t type;
+            base_event_channel_t* channel;
+            void* handler;
+        };
+
+        // what each system (indexed like systems_copy) is triggered with in
+        // the current round
+        std::vector<std::vector<event_type_t>> pending_event_types(
+            systems_copy.size()
+        );
+        std::vector<std::vector<delivery_t>> pending_deliveries(
+            systems_copy.size()
+        );
+
+        // indices of the systems that are triggered in the current round
+        std::vector<usize> triggered;
+
+        auto mark_triggered = [&](usize index)
+        {
+            if (pending_event_types[index].empty()
+                && pending_deliveries[index].empty())
             {
-                if (system->triggers.contains(event.type))
+                triggered.push_back(index);
+            }
+        };
+
+        // events enqueued while triggering the systems are processed in this
+        // iteration too, in another round
+        while (true)
+        {
+            for (auto index : triggered)
+            {
+                pending_event_types[index].clear();
+                pending_deliveries[index].clear();
+            }
+            triggered.clear();
+            for (auto& [type, bucket] : buckets)
+            {
+                bucket.clear();
+            }
+
+            usize n_events = events.drain(
+                [&buckets](event_t& event)
                 {
-                    auto& worker = worker_map[system.get()];
-                    if (worker)
+                    buckets[event.type].push_back(std::move(event));
+                }
+            );
+
+            // hand out the untyped events to their subscribers, in increasing
+            // order of event types
+            bucket_types.clear();
+            for (auto& [type, bucket] : buckets)
+            {
+                if (!bucket.empty())
+                {
+                    bucket_types.push_back(type);
+                }
+            }
+            std::sort(bucket_types.begin(), bucket_types.end());
+
+            for (auto type : bucket_types)
+            {
+                auto it = subscribers.by_event_type.find(type);
+                if (it == subscribers.by_event_type.end())
+                    continue;
+
+                for (auto index : it->second)
+                {
+                    mark_triggered(index);
+                    pending_event_types[index].push_back(type);
+                }
+            }
+
+            // make the typed events emitted so far ready for delivery, and
+            // hand them out to their subscribers
+            usize n_ready_channels = 0;
+            {
+                std::shared_lock lock(mutex_channels);
+                for (type_id_t type = 0; type < channels.size(); type++)
+                {
+                    if (!channels[type])
+                        continue;
+
+                    usize n_ready = channels[type]->flip();
+                    if (n_ready == 0)
+                        continue;
+
+                    n_events += n_ready;
+                    n_ready_channels++;
+
+                    if (type >= subscribers.by_type_id.size())
+                        continue;
+
+                    for (auto& subscriber : subscribers.by_type_id[type])
                     {
-                        worker->enqueue(
-                            [
-                                this, &system, &worker, &iter, &event,
-                                &out_did_process_all
-                            ]()
-                            {
-                                if (!try_trigger_system(
-                                    system, worker, iter, event
-                                ))
-                                {
-                                    out_did_process_all = false;
-                                }
+                        mark_triggered(subscriber.system_index);
+                        pending_deliveries[subscriber.system_index].push_back(
+                            delivery_t{
+                                type,
+                                channels[type].get(),
+                                subscriber.handler
                             }
                         );
-                        worker->wait();
                     }
-                    else
+                }
+            }
+
+            if (n_events == 0)
+                break;
+
+            // make a graph of the triggered systems, where a system depends on
+            // the systems added before it that it conflicts with.
+            std::sort(triggered.begin(), triggered.end());
+
+            std::vector<system_node_t> system_nodes;
+            for (auto index : triggered)
+            {
+                auto& system = systems_copy[index];
+
+                usize node_index = system_nodes.size();
+                system_nodes.push_back(system_node_t{ system });
+                system_nodes[node_index].profile = profiles[index];
+                for (usize i = 0; i < node_index; i++)
+                {
+                    if (system->conflicts_with(*system_nodes[i].system))
+                    {
+                        system_nodes[i].dependents.push_back(node_index);
+                        system_nodes[node_index].n_dependencies++;
+                    }
+                }
+            }
+
+            gsx_log(this, log_level_t::verbose,
+                "processing {} event(s) of {} type(s) with {} system(s)",
+                n_events,
+                bucket_types.size() + n_ready_channels,
+                system_nodes.size()
+            );
+
+            // trigger every system with a batch of events per type
+            registry.next_version();
+            bool did_trigger_all;
+            run_system_graph(
+                system_nodes,
+                [&](usize node_index)
+                {
+                    usize index = triggered[node_index];
+                    auto& system = system_nodes[node_index].system;
+                    system_scope_t scope(
+                        *this,
+                        command_buffer_t::key_t{ node_index }
+                    );
+                    auto start = profiler.now();
+                    auto trace_start = tracer.now();
+
+                    bool did_trigger = true;
+                    for (auto type : pending_event_types[index])
+                    {
+                        if (!try_trigger_system(
+                            system,
+                            iter,
+                            type,
+                            buckets.find(type)->second
+                        ))
+                        {
+                            did_trigger = false;
+                        }
+                    }
+                    for (auto& delivery : pending_deliveries[index])
                     {
-                        if (!try_trigger_system(system, worker, iter, event))
+                        if (!try_deliver_events(
+                            system,
+                            iter,
+                            delivery.type,
+                            *delivery.channel,
+                            delivery.handler
+                        ))
                         {
-                            out_did_process_all = false;
+                            did_trigger = false;
                         }
                     }
-                }
+
+                    profiler.record(
+                        system_nodes[node_index].profile,
+                        profile_phase_t::trigger,
+                        iter.i,
+                        start
+                    );
+                    tracer.record(
+                        current_trace_thread(),
+                        "trigger",
+                        system->name,
+                        trace_start
+                    );
+                    return did_trigger;
+                },
+                did_trigger_all
+            );
+
+            play_back_commands();
+
+            if (!did_trigger_all)
+            {
+                out_did_process_all = false;
             }
-            lock.lock();
         }
     }
 
     void world_t::update_systems(
-        std::vector<system_group_t>& system_groups,
-        worker_map_t& worker_map,
+        std::vector<system_node_t>& system_nodes,
         const iteration_t& iter,
+        u64 tick,
         bool& out_did_update_all
     )
     {
-        out_did_update_all = true;
+        gsx_log(this, log_level_t::verbose,
+            "updating {} system(s)",
+            system_nodes.size()
+        );
+
+        u64 version = registry.next_version();
+        run_system_graph(
+            system_nodes,
+            [this, &system_nodes, &iter, tick, version](usize index)
+            {
+                auto& node = system_nodes[index];
+
+                iteration_t node_iter;
+                if (!is_tick_due(node, iter, tick, node_iter))
+                    return true;
+
+                // the system sees its own writes from the last update too
+                node_iter.last_version = node.last_version;
+                node.last_version = version;
+
+                system_scope_t scope(*this, command_buffer_t::key_t{ index });
+                auto start = profiler.now();
+                auto trace_start = tracer.now();
+                bool did_update = try_update_system(node.system, node_iter);
+                profiler.record(
+                    node.profile,
+                    profile_phase_t::update,
+                    iter.i,
+                    start
+                );
+                tracer.record(
+                    current_trace_thread(),
+                    "update",
+                    node.system->name,
+                    trace_start
+                );
+                return did_update;
+            },
+            out_did_update_all
+        );
+
+        play_back_commands();
+    }
+
+    void world_t::play_back_commands()
+    {
+        std::scoped_lock lock(mutex_commands);
+
+        auto trace_start = tracer.now();
+        usize n_commands = command_buffer_t::play_back(
+            command_buffers,
+            registry
+        );
+        if (n_commands == 0)
+            return;
+
+        gsx_log(this, log_level_t::verbose,
+            "played back {} command(s)",
+            n_commands
+        );
+        tracer.record(0, "world", "play back commands", trace_start);
+    }
+
+    void world_t::reset_ticks(
+        std::vector<system_node_t>& system_nodes,
+        f64 time
+    )
+    {
+        // spread out the ticks of the systems with the same tick rate or
+        // divisor
+        std::unordered_map<u32, u64> n_with_divisor;
+        std::unordered_map<f64, std::vector<system_node_t*>> with_rate;
+        for (auto& node : system_nodes)
+        {
+            const execution_scheme_t& scheme = node.system->exec_scheme;
+            node.tick_offset = 0;
+            node.next_tick_time = time;
+            node.last_tick_time = time;
+            node.last_version = 0;
+            if (scheme.tick_divisor > 1)
+            {
+                node.tick_offset =
+                    n_with_divisor[scheme.tick_divisor]++ % scheme.tick_divisor;
+            }
+            if (scheme.tick_rate > 0)
+            {
+                with_rate[scheme.tick_rate].push_back(&node);
+            }
+        }
+        for (auto& [rate, nodes] : with_rate)
+        {
+            for (usize i = 0; i < nodes.size(); i++)
+            {
+                nodes[i]->next_tick_time =
+                    time + (f64)i / ((f64)nodes.size() * rate);
+            }
+        }
+    }
 
-        for (auto& group : system_groups)
+    bool world_t::is_tick_due(
+        system_node_t& node,
+        const iteration_t& iter,
+        u64 tick,
+        iteration_t& out_iter
+    )
+    {
+        const execution_scheme_t& scheme = node.system->exec_scheme;
+
+        if (scheme.tick_divisor > 1
+            && tick % scheme.tick_divisor != node.tick_offset)
         {
-            gsx_log(this, log_level_t::verbose, std::format(
-                "updating {} system(s) at order {}",
-                group.systems.size(),
-                group.update_order
-            ));
+            return false;
+        }
+
+        if (scheme.tick_rate > 0)
+        {
+            if (iter.time < node.next_tick_time)
+                return false;
+
+            // don't try to catch up with missed ticks
+            const f64 period = 1. / scheme.tick_rate;
+            node.next_tick_time += period;
+            if (node.next_tick_time <= iter.time)
+            {
+                node.next_tick_time = iter.time + period;
+            }
+        }
+
+        out_iter = iter;
+        if (scheme.tick_divisor > 1 || scheme.tick_rate > 0)
+        {
+            out_iter.dt = iter.time - node.last_tick_time;
+        }
+        node.last_tick_time = iter.time;
+        return true;
+    }
 
-            // first, update every system in the group that needs to run on a
-            // worker thread.
-            for (auto& system : group.systems)
+    void world_t::run_system_graph(
+        std::vector<system_node_t>& system_nodes,
+        const std::function<bool(usize)>& fn,
+        bool& out_did_run_all
+    )
+    {
+        // in a fixed order, which respects the dependencies since every
+        // node only depends on nodes before it
+        if (is_run_deterministic)
+        {
+            out_did_run_all = true;
+            for (usize i = 0; i < system_nodes.size(); i++)
             {
-                auto& worker = worker_map[system.get()];
-                if (worker)
+                if (!fn(i))
                 {
-                    worker->enqueue(
-                        [
-                            this, &system, &group, &worker, &iter,
-                            &out_did_update_all
-                        ]()
-                        {
-                            if (!try_update_system(system, group, worker, iter))
-                            {
-                                out_did_update_all = false;
-                            }
-                        }
-                    );
+                    out_did_run_all = false;
+                }
+            }
+            return;
+        }
+
+        std::atomic<bool> did_run_all = true;
+
+        // number of unfinished dependencies of each node
+        std::vector<std::atomic<usize>> n_waiting(system_nodes.size());
+        for (usize i = 0; i < system_nodes.size(); i++)
+        {
+            n_waiting[i].store(system_nodes[i].n_dependencies);
+        }
+
+        // nodes that are ready to be updated on this thread
+        std::mutex mutex_ready;
+        std::deque<usize> ready_on_world_thread;
+
+        std::atomic<usize> n_finished = 0;
+
+        // incremented whenever a node is finished or becomes ready on this
+        // thread, so that this thread can sleep until it changes.
+        std::atomic<u32> progress = 0;
+
+        misc::job_group_t jobs;
+
+        // hand out a node whose dependencies are all finished
+        std::function<void(usize)> dispatch;
+
+        auto update = [&](usize index)
+        {
+            if (!fn(index))
+            {
+                did_run_all = false;
+            }
+
+            for (auto dependent : system_nodes[index].dependents)
+            {
+                if (n_waiting[dependent].fetch_sub(1) == 1)
+                {
+                    dispatch(dependent);
                 }
             }
 
-            // then, update every system in the group that needs to run on this
-            // thread.
-            for (auto& system : group.systems)
+            n_finished++;
+            progress++;
+            progress.notify_all();
+        };
+
+        dispatch = [&](usize index)
+        {
+            if (system_nodes[index].system->exec_scheme.run_on_world_thread)
             {
-                auto& worker = worker_map[system.get()];
-                if (!worker)
                 {
-                    if (!try_update_system(system, group, worker, iter))
-                    {
-                        out_did_update_all = false;
-                    }
+                    std::scoped_lock lock(mutex_ready);
+                    ready_on_world_thread.push_back(index);
                 }
+                progress++;
+                progress.notify_all();
             }
+            else
+            {
+                thread_pool->enqueue(
+                    [&update, index]()
+                    {
+                        update(index);
+                    },
+                    &jobs
+                );
+            }
+        };
 
-            // wait for the workers to finish their job
-            for (auto& v : worker_map)
+        for (usize i = 0; i < system_nodes.size(); i++)
+        {
+            if (system_nodes[i].n_dependencies == 0)
             {
-                auto& worker = v.second;
-                if (worker)
+                dispatch(i);
+            }
+        }
+
+        // update the nodes that need to run on this thread as they become
+        // ready, and help the worker threads in the meantime.
+        while (true)
+        {
+            // load this before checking the state so that a change in between
+            // is not missed.
+            u32 seen = progress.load();
+            if (n_finished.load() == system_nodes.size())
+                break;
+
+            std::optional<usize> index;
+            {
+                std::scoped_lock lock(mutex_ready);
+                if (!ready_on_world_thread.empty())
                 {
-                    worker->wait();
+                    index = ready_on_world_thread.front();
+                    ready_on_world_thread.pop_front();
                 }
             }
+
+            if (index)
+            {
+                update(*index);
+                continue;
+            }
+
+            // only this graph's jobs, since the pool may be shared with other
+            // worlds, whose traces and profiles expect every thread outside
+            // the pool to be their own world thread
+            if (thread_pool->run_pending_job(jobs))
+                continue;
+
+            // nothing to do until other systems are finished
+            auto trace_start = tracer.now();
+            progress.wait(seen);
+            tracer.record(0, "wait", "wait for dependencies", trace_start);
         }
+
+        // every node is finished, but the last jobs might still be returning,
+        // so wait for them before the state above goes out of scope.
+        thread_pool->wait(jobs);
+
+        out_did_run_all = did_run_all;
     }
 
     void world_t::stop_systems(
         std::vector<std::shared_ptr<base_system_t>>& systems_copy,
-        worker_map_t& worker_map,
         const iteration_t& iter
     )
     {
@@ -462,58 +1803,31 @@ namespace gsx::ecs
         // will be stopped at the end.
         for (isize i = systems_copy.size() - 1; i >= 0; i--)
         {
-            auto& system = systems_copy[i];
-            auto& worker = worker_map[system.get()];
-            if (worker)
-            {
-                worker->enqueue(
-                    [this, &iter, &system, &worker]()
-                    {
-                        try_stop_system(system, worker, iter);
-                    }
-                );
-                worker->wait();
-            }
-            else
-            {
-                try_stop_system(system, worker, iter);
-            }
+            try_stop_system(systems_copy[i], iter);
         }
     }
 
-    bool world_t::try_start_system(
-        std::shared_ptr<base_system_t>& system,
-        const std::shared_ptr<misc::worker_t>& worker
-    )
+    bool world_t::try_start_system(std::shared_ptr<base_system_t>& system)
     {
-        if (worker)
-        {
-            gsx_log(this, log_level_t::info, std::format(
-                "starting system named \"{}\" on worker thread #{}",
-                system->name,
-                worker->id
-            ));
-        }
-        else
-        {
-            gsx_log(this, log_level_t::info, std::format(
-                "starting system named \"{}\" on the world runner thread",
-                system->name
-            ));
-        }
+        gsx_log(this, log_level_t::info,
+            "starting system named \"{}\" {}",
+            system->name,
+            current_thread_name()
+        );
 
         try
         {
+            system_scope_t scope(*this);
             system->on_start(*this);
             return true;
         }
         catch (const std::exception& e)
         {
-            gsx_log(this, log_level_t::error, std::format(
+            gsx_log(this, log_level_t::error,
                 "system named \"{}\" couldn't start: \"{}\"",
                 system->name,
                 e.what()
-            ));
+            );
         }
 
         return false;
@@ -521,43 +1835,65 @@ namespace gsx::ecs
 
     bool world_t::try_trigger_system(
         std::shared_ptr<base_system_t>& system,
-        const std::shared_ptr<misc::worker_t>& worker,
         const iteration_t& iter,
-        const event_t& event
+        event_type_t type,
+        std::span<const event_t> events
     )
     {
-        if (worker)
+        gsx_log(this, log_level_t::verbose,
+            "triggering system named \"{}\" using {} event(s) of type {} {}",
+            system->name,
+            events.size(),
+            type,
+            current_thread_name()
+        );
+
+        try
         {
-            gsx_log(this, log_level_t::verbose, std::format(
-                "triggering system named \"{}\" using event of type {} on "
-                "worker thread #{}",
-                system->name,
-                event.type,
-                worker->id
-            ));
+            system_scope_t scope(*this);
+            system->on_trigger_batch(*this, iter, events);
+            return true;
         }
-        else
+        catch (const std::exception& e)
         {
-            gsx_log(this, log_level_t::verbose, std::format(
-                "triggering system named \"{}\" using event of type {} on the "
-                "world runner thread",
+            gsx_log(this, log_level_t::error,
+                "system named \"{}\" couldn't be triggered: \"{}\"",
                 system->name,
-                event.type
-            ));
+                e.what()
+            );
         }
 
+        return false;
+    }
+
+    bool world_t::try_deliver_events(
+        std::shared_ptr<base_system_t>& system,
+        const iteration_t& iter,
+        type_id_t type,
+        base_event_channel_t& channel,
+        void* handler
+    )
+    {
+        gsx_log(this, log_level_t::verbose,
+            "delivering typed events with type ID {} to system named \"{}\" {}",
+            type,
+            system->name,
+            current_thread_name()
+        );
+
         try
         {
-            system->on_trigger(*this, iter, event);
+            system_scope_t scope(*this);
+            channel.deliver(handler, *this, iter);
             return true;
         }
         catch (const std::exception& e)
         {
-            gsx_log(this, log_level_t::error, std::format(
-                "system named \"{}\" couldn't be triggered: \"{}\"",
+            gsx_log(this, log_level_t::error,
+                "system named \"{}\" couldn't receive typed events: \"{}\"",
                 system->name,
                 e.what()
-            ));
+            );
         }
 
         return false;
@@ -565,43 +1901,29 @@ namespace gsx::ecs
 
     bool world_t::try_update_system(
         std::shared_ptr<base_system_t>& system,
-        const system_group_t& group,
-        const std::shared_ptr<misc::worker_t>& worker,
         const iteration_t& iter
     )
     {
-        if (worker)
-        {
-            gsx_log(this, log_level_t::verbose, std::format(
-                "updating system named \"{}\" at order {} on worker "
-                "thread #{}",
-                system->name,
-                group.update_order,
-                worker->id
-            ));
-        }
-        else
-        {
-            gsx_log(this, log_level_t::verbose, std::format(
-                "updating system named \"{}\" at order {} on the world runner "
-                "thread",
-                system->name,
-                group.update_order
-            ));
-        }
+        gsx_log(this, log_level_t::verbose,
+            "updating system named \"{}\" at order {} {}",
+            system->name,
+            system->exec_scheme.update_order,
+            current_thread_name()
+        );
 
         try
         {
+            system_scope_t scope(*this);
             system->on_update(*this, iter);
             return true;
         }
         catch (const std::exception& e)
         {
-            gsx_log(this, log_level_t::error, std::format(
+            gsx_log(this, log_level_t::error,
                 "system named \"{}\" couldn't update: \"{}\"",
                 system->name,
                 e.what()
-            ));
+            );
         }
 
         return false;
@@ -609,38 +1931,50 @@ namespace gsx::ecs
 
     void world_t::try_stop_system(
         std::shared_ptr<base_system_t>& system,
-        const std::shared_ptr<misc::worker_t>& worker,
         const iteration_t& iter
     )
     {
-        if (worker)
-        {
-            gsx_log(this, log_level_t::info, std::format(
-                "stopping system named \"{}\" on worker thread #{}",
-                system->name,
-                worker->id
-            ));
-        }
-        else
-        {
-            gsx_log(this, log_level_t::info, std::format(
-                "stopping system named \"{}\" on the world runner thread",
-                system->name
-            ));
-        }
+        gsx_log(this, log_level_t::info,
+            "stopping system named \"{}\" {}",
+            system->name,
+            current_thread_name()
+        );
 
         try
         {
+            system_scope_t scope(*this);
             system->on_stop(*this, iter);
         }
         catch (const std::exception& e)
         {
-            gsx_log(this, log_level_t::error, std::format(
+            gsx_log(this, log_level_t::error,
                 "system named \"{}\" couldn't stop: \"{}\"",
                 system->name,
                 e.what()
-            ));
+            );
         }
     }
 
+    void world_t::log_enqueue_event(event_type_t type)
+    {
+        gsx_log(this, log_level_t::verbose,
+            "enqueueing an event of type {}",
+            type
+        );
+    }
+
+    std::string world_t::current_thread_name() const
+    {
+        isize index = thread_pool ? thread_pool->current_worker_index() : -1;
+        if (index >= 0)
+            return std::format("on worker thread #{}", index);
+        return "on the world runner thread";
+    }
+
+    usize world_t::current_trace_thread() const
+    {
+        isize index = thread_pool ? thread_pool->current_worker_index() : -1;
+        return (usize)(index + 1);
+    }
+
 }
@@ -1,16 +1,33 @@
 #pragma once
 
 #include <string>
-#include <deque>
+#include <string_view>
 #include <vector>
-#include <unordered_map>
+#include <span>
 #include <memory>
+#include <functional>
+#include <unordered_map>
 #include <mutex>
+#include <shared_mutex>
+#include <atomic>
+#include <utility>
+#include <type_traits>
+#include <stdexcept>
 #include <cstdint>
 
 #include "log.h"
 #include "event.h"
+#include "channel.h"
+#include "entity.h"
+#include "registry.h"
+#include "resource.h"
+#include "snapshot.h"
+#include "command_buffer.h"
+#include "profiler.h"
+#include "trace.h"
+#include "replay.h"
 #include "../internal_common/all.h"
+#include "../internal_math/prng.h"
 #include "../internal_misc/all.h"
 
 namespace gsx::ecs
@@ -28,34 +45,138 @@ namespace gsx::ecs
         // seconds elapsed since the start
         f64 time = 0;
 
-        // seconds elapsed since the last iteration
+        // seconds elapsed since the last iteration. when a fixed-step system
+        // is updated, this is the fixed timestep instead.
         f64 dt = 0;
+
+        // number of fixed steps simulated before the current one (see
+        // world_t::set_fixed_timestep()). when a fixed-step system is
+        // updated, time is step * dt.
+        u64 step = 0;
+
+        // how far the time is between the last fixed step and the next one,
+        // from 0 to 1. systems that are updated once per iteration, like
+        // rendering, can use this to interpolate between the last two states
+        // simulated by the fixed-step systems.
+        // * this is always 0 without a fixed timestep.
+        f64 alpha = 0;
+
+        // the version of the registry (see registry_t::get_version()) when
+        // the system being updated was last updated, or 0 if it wasn't
+        // updated before in this run. the system can use this to only look
+        // at the components that changed since then (see
+        // view_t::changed_since()).
+        // * the changes made by the group of systems that the system was last
+        //   updated with, including its own, are seen again, since they may
+        //   have been made after the system looked.
+        // * this is always 0 when a system is triggered.
+        u64 last_version = 0;
     };
 
-    // a world for holding and managing a collection of systems
+    // a world for holding and managing a collection of systems, along with
+    // the entities and components that those systems work on.
     class world_t
     {
     public:
         const std::string name;
         const log_level_t max_log_level;
 
+        // * worlds can share a thread pool, which avoids starting a set of
+        //   worker threads per world when running many worlds. if thread_pool
+        //   is null, the world creates its own pool on its first run.
         world_t(
             const std::string& name,
             log_level_t max_log_level,
-            std::shared_ptr<base_logger_t> logger
+            std::shared_ptr<base_logger_t> logger,
+            std::shared_ptr<misc::thread_pool_t> thread_pool = nullptr
         );
         no_copy_construct_no_assignment(world_t);
         ~world_t();
 
+        void log(log_level_t log_level, const char* message);
         void log(log_level_t log_level, const std::string& message);
+
+        // log a message that's only formatted if and when the logger writes
+        // it. see log_message_t.
+        template<typename... Args>
+            requires (sizeof...(Args) > 0)
+        void log(
+            log_level_t log_level,
+            std::format_string<Args...> fmt,
+            Args&&... args
+        )
+        {
+            gsx_log(this, log_level, fmt, std::forward<Args>(args)...);
+        }
+
+        // enqueue an event to trigger the systems with at the start of the
+        // next iteration. this can be called from any thread, and it doesn't
+        // block other threads enqueueing events.
+        // * in a deterministic run, this throws an exception when called
+        //   from a range of parallel_for() (see set_deterministic()).
         void enqueue_event(const event_t& event);
 
+        // construct an event in place in the queue, given its type and the
+        // rest of the arguments of an event_t constructor, like
+        // emplace_event(type, std::in_place_type<T>, args...).
+        template<typename... Args>
+        void emplace_event(event_type_t type, Args&&... args)
+        {
+            check_event_order();
+            if (is_external_input())
+            {
+                enqueue_event(event_t(type, std::forward<Args>(args)...));
+                return;
+            }
+
+            log_enqueue_event(type);
+            events.emplace(type, std::forward<Args>(args)...);
+        }
+
+        // emit an event of type T constructed from the given arguments. it
+        // will be delivered at the start of the next iteration to every
+        // system subscribed to T (see base_system_t::subscribe()), along with
+        // the other events of the same type, without any type erasure or
+        // per-event allocation. this can be called from any thread.
+        // * in a deterministic run, this throws an exception when called
+        //   from a range of parallel_for() (see set_deterministic()).
+        template<typename T, typename... Args>
+        void emit(Args&&... args)
+        {
+            check_event_order();
+            if (is_external_input())
+            {
+                if constexpr (std::is_copy_constructible_v<T>)
+                {
+                    add_input(
+                        [event = T(std::forward<Args>(args)...)](
+                            world_t& world
+                            )
+                        {
+                            world.get_or_create_channel<T>().emit(event);
+                        }
+                    );
+                    return;
+                }
+                else
+                {
+                    throw std::runtime_error(
+                        "typed events that can't be copied can't be recorded"
+                    );
+                }
+            }
+
+            get_or_create_channel<T>().emit(std::forward<Args>(args)...);
+        }
+
         // get the first system in the list with a given name. if no such
         // system exists, nullptr will be returned.
         std::shared_ptr<base_system_t> get_system_named(
             const std::string& name
         );
 
+        // * while the world is running, the list must only be changed through
+        //   add_system() and the remove functions.
         constexpr const std::vector<std::shared_ptr<base_system_t>>&
             get_systems() const
         {
@@ -67,15 +188,468 @@ namespace gsx::ecs
             return systems;
         }
 
+        // add a system to the end of the list, or remove systems from it.
+        // * these can be called from any thread, even while the world is
+        //   running. the changes made while it's running are applied in
+        //   order at the start of the next iteration (see run()).
         void add_system(const std::shared_ptr<base_system_t>& system);
         void remove_first_system_named(const std::string& name);
         void remove_all_systems_named(const std::string& name);
         void remove_all_systems();
 
+        // make the next run prepare the schedule again (see run()). this is
+        // done automatically when adding or removing systems, but it must be
+        // called after changing the list returned by get_systems() directly,
+        // or after changing the triggers, subscriptions or declared accesses
+        // of systems that are in the world.
+        void invalidate_schedule();
+
+        // create an entity without any components. see registry_t.
+        // * like the rest of the functions that change entities and their
+        //   components, this must not be called while other threads are
+        //   accessing the registry, like from systems that are updated in
+        //   parallel. use get_commands() in systems instead.
+        entity_t create_entity();
+
+        // destroy an entity along with all of its components
+        void destroy_entity(entity_t entity);
+
+        template<typename T, typename... Args>
+        T& add_component(entity_t entity, Args&&... args)
+        {
+            return registry.add<T>(entity, std::forward<Args>(args)...);
+        }
+
+        template<typename T>
+        void remove_component(entity_t entity)
+        {
+            registry.remove<T>(entity);
+        }
+
+        template<typename T>
+        bool has_component(entity_t entity) const
+        {
+            return registry.has<T>(entity);
+        }
+
+        // * getting mutable access to a component counts as writing to it,
+        //   for change detection (see registry_t::get_version()) and for the
+        //   declared access of systems (see base_system_t::declare_write()).
+        //   systems that only read a component should use the const
+        //   overloads, through a const world_t&.
+        template<typename T>
+        T* try_get_component(entity_t entity)
+        {
+            return registry.try_get<T>(entity);
+        }
+
+        template<typename T>
+        const T* try_get_component(entity_t entity) const
+        {
+            return registry.try_get<T>(entity);
+        }
+
+        template<typename T>
+        T& get_component(entity_t entity)
+        {
+            return registry.get<T>(entity);
+        }
+
+        template<typename T>
+        const T& get_component(entity_t entity) const
+        {
+            return registry.get<T>(entity);
+        }
+
+        // make a view over every entity that has all of the component types
+        // Ts. see view_t.
+        template<typename... Ts>
+        view_t<Ts...> view()
+        {
+            return registry.view<Ts...>();
+        }
+
+        // * a view of a const world only gives read-only access, so every
+        //   component type must be const.
+        template<typename... Ts>
+        view_t<Ts...> view() const
+        {
+            return registry.view<Ts...>();
+        }
+
+        // add a resource of type T, constructed from the given arguments, or
+        // replace the existing one. a resource is the single instance of a
+        // type that's shared by the systems of the world, like settings or a
+        // spatial index, which systems look up with resource<T>() instead of
+        // holding references to it.
+        // * systems declare their access to resources like to components,
+        //   with base_system_t::declare_read<T>() and declare_write<T>(), so
+        //   systems that only read a resource can be updated in parallel.
+        // * replacing a resource assigns to the existing instance, so
+        //   references to it stay valid.
+        // * resources can't be added, replaced or removed while the world is
+        //   running, which is what lets resource<T>() look them up without
+        //   locking. this throws an exception if the world is running, and
+        //   run() waits until the resource is added. systems change the
+        //   value of a resource through resource<T>() instead.
+        template<typename T, typename... Args>
+        T& add_resource(Args&&... args)
+        {
+            const type_id_t id = type_id_of<T>();
+            auto lock_systems = lock_for_resource_change("add");
+            std::scoped_lock lock(mutex_resources);
+            if (id >= resources.size())
+            {
+                resources.resize(id + 1);
+            }
+            if (resources[id])
+            {
+                T& value = static_cast<resource_t<T>&>(*resources[id]).value;
+                value = T(std::forward<Args>(args)...);
+                return value;
+            }
+            resources[id] = std::make_unique<resource_t<T>>(
+                std::forward<Args>(args)...
+            );
+            return static_cast<resource_t<T>&>(*resources[id]).value;
+        }
+
+        // * like add_resource(), this throws an exception if the world is
+        //   running.
+        template<typename T>
+        void remove_resource()
+        {
+            const type_id_t id = type_id_of<T>();
+            auto lock_systems = lock_for_resource_change("remove");
+            std::scoped_lock lock(mutex_resources);
+            if (id < resources.size())
+            {
+                resources[id].reset();
+            }
+        }
+
+        // get the resource of type T, or nullptr if the world doesn't have
+        // one. this can be called from any thread while the world is
+        // running, or while no other thread is adding or removing resources.
+        template<typename T>
+        T* try_resource()
+        {
+            const type_id_t id = type_id_of<T>();
+            if (id >= resources.size() || !resources[id])
+                return nullptr;
+            return &static_cast<resource_t<T>&>(*resources[id]).value;
+        }
+
+        template<typename T>
+        const T* try_resource() const
+        {
+            const type_id_t id = type_id_of<T>();
+            if (id >= resources.size() || !resources[id])
+                return nullptr;
+            return &static_cast<const resource_t<T>&>(*resources[id]).value;
+        }
+
+        // get the resource of type T, and throw an exception if the world
+        // doesn't have one.
+        template<typename T>
+        T& resource()
+        {
+            T* ptr = try_resource<T>();
+            if (!ptr)
+                throw std::runtime_error(
+                    "the world doesn't have the requested resource"
+                );
+            return *ptr;
+        }
+
+        template<typename T>
+        const T& resource() const
+        {
+            const T* ptr = try_resource<T>();
+            if (!ptr)
+                throw std::runtime_error(
+                    "the world doesn't have the requested resource"
+                );
+            return *ptr;
+        }
+
+        template<typename T>
+        bool has_resource() const
+        {
+            return try_resource<T>() != nullptr;
+        }
+
+        // copy the entities and components, the resources and the pending
+        // events of the world into a snapshot, replacing what it had before,
+        // to restore them later with restore_snapshot(), like to checkpoint
+        // a long simulation between runs or to rewind it for debugging. see
+        // world_snapshot_t.
+        // * this throws an exception while the world is running, and run()
+        //   waits until the snapshot is saved.
+        void save_snapshot(world_snapshot_t& out_snapshot);
+
+        // replace the entities and components, the resources and the pending
+        // events of the world with the ones in a snapshot. the snapshot can
+        // be restored any number of times, and into any world of the same
+        // process, like to fork several runs from the same state.
+        // * resources that aren't in the snapshot are removed.
+        // * events enqueued or emitted since the snapshot was saved, of
+        //   every type, are discarded.
+        // * this throws an exception while the world is running, and run()
+        //   waits until the snapshot is restored.
+        void restore_snapshot(const world_snapshot_t& snapshot);
+
+        // the command buffer of the calling thread, which defers structural
+        // changes (creating and destroying entities, adding, removing and
+        // setting components) until every system in the current group has
+        // finished. the changes are made at the end of every round of
+        // triggers and of every update of the systems in fixed steps or once
+        // per iteration, in the same order no matter which threads the
+        // systems ran on. see command_buffer_t.
+        // * every thread gets a buffer of its own, so recording doesn't
+        //   lock except the first time a thread records for the world.
+        // * changes recorded outside of a run, or in on_start(), are made
+        //   before the next run's first group.
+        // * while the world is running, only system code and the ranges of
+        //   parallel_for() may record, since the buffers are played back
+        //   without locking. debug builds throw an exception otherwise.
+        command_buffer_t& get_commands();
+
+        constexpr const registry_t& get_registry() const
+        {
+            return registry;
+        }
+
+        constexpr registry_t& get_registry()
+        {
+            return registry;
+        }
+
+        // invoke fn(range_begin, range_end) over contiguous ranges of
+        // [begin, end) in parallel on the world's thread pool, so that systems
+        // can parallelize their own loops without spawning more threads. see
+        // misc::thread_pool_t::parallel_for().
+        // * before the world's first run, this runs serially on the calling
+        //   thread.
+        // * a loop started from a range of another loop of the same world
+        //   runs serially in that range, so that its commands are ordered
+        //   like the rest of the range's.
+        // * commands recorded by the ranges are played back after the ones
+        //   the caller recorded before the loop, and before the ones it
+        //   records after it.
+        template<typename F>
+        void parallel_for(usize begin, usize end, usize grain, F&& fn)
+        {
+            if (!thread_pool || is_in_parallel_range())
+            {
+                if (begin < end)
+                    fn(begin, end);
+                return;
+            }
+            command_buffer_t& commands = get_commands();
+            const command_buffer_t::key_t key = commands.get_key();
+            thread_pool->parallel_for(
+                begin,
+                end,
+                grain,
+                [this, &fn, key](usize range_begin, usize range_end)
+                {
+                    system_scope_t scope(
+                        *this,
+                        command_buffer_t::key_t{
+                            key.system,
+                            key.phase + 1,
+                            (u64)range_begin + 1
+                        }
+                    );
+                    fn(range_begin, range_end);
+                }
+            );
+            commands.set_key(
+                command_buffer_t::key_t{ key.system, key.phase + 2, key.range }
+            );
+        }
+
+        // reduce [begin, end) in parallel on the world's thread pool, under
+        // the same rules as parallel_for(). see
+        // misc::thread_pool_t::parallel_reduce().
+        // * the result is the same when this runs serially.
+        template<typename T, typename F, typename R>
+        T parallel_reduce(
+            usize begin,
+            usize end,
+            usize grain,
+            T identity,
+            F&& fn,
+            R&& reduce
+        )
+        {
+            if (!thread_pool || is_in_parallel_range())
+            {
+                return misc::thread_pool_t::serial_reduce(
+                    begin,
+                    end,
+                    grain,
+                    std::move(identity),
+                    std::forward<F>(fn),
+                    std::forward<R>(reduce)
+                );
+            }
+            command_buffer_t& commands = get_commands();
+            const command_buffer_t::key_t key = commands.get_key();
+            T result = thread_pool->parallel_reduce(
+                begin,
+                end,
+                grain,
+                std::move(identity),
+                [this, &fn, key](usize range_begin, usize range_end)
+                {
+                    system_scope_t scope(
+                        *this,
+                        command_buffer_t::key_t{
+                            key.system,
+                            key.phase + 1,
+                            (u64)range_begin + 1
+                        }
+                    );
+                    return fn(range_begin, range_end);
+                },
+                std::forward<R>(reduce)
+            );
+            commands.set_key(
+                command_buffer_t::key_t{ key.system, key.phase + 2, key.range }
+            );
+            return result;
+        }
+
+        // the time spent by every system in each iteration of the current or
+        // most recent run. see profiler_t.
+        constexpr const profiler_t& get_profiler() const
+        {
+            return profiler;
+        }
+
+        constexpr profiler_t& get_profiler()
+        {
+            return profiler;
+        }
+
+        // traces the runs of the world to a file when enabled. see tracer_t.
+        constexpr const tracer_t& get_tracer() const
+        {
+            return tracer;
+        }
+
+        constexpr tracer_t& get_tracer()
+        {
+            return tracer;
+        }
+
+        // update the systems with execution_scheme_t::fixed_step enabled in
+        // fixed steps of a given number of seconds. if an iteration takes too
+        // long, at most max_substeps steps are simulated in it and the rest
+        // of the time is dropped, so that the simulation can't fall further
+        // and further behind. use a step of 0 to disable the fixed timestep.
+        // * this takes effect in the next run.
+        void set_fixed_timestep(f64 step, u32 max_substeps = 8);
+
+        constexpr f64 get_fixed_timestep() const
+        {
+            return fixed_timestep;
+        }
+
+        constexpr u32 get_max_substeps() const
+        {
+            return max_substeps;
+        }
+
+        // set the seed that make_prng() derives the random number streams of
+        // the systems from. the seed is 0 by default.
+        // * this must not be called while the world is running.
+        void set_seed(u64 seed);
+
+        constexpr u64 get_seed() const
+        {
+            return seed;
+        }
+
+        // make a random number generator for a system in an iteration,
+        // seeded from the world's seed, the name of the system, the
+        // iteration number and the fixed step number. a system that draws
+        // its random numbers from here gets the same numbers in every run
+        // with the same seed, no matter which thread it runs on.
+        math::prng_t make_prng(
+            const base_system_t& system,
+            const iteration_t& iter
+        ) const;
+
+        // update the systems one at a time on the thread running the world,
+        // in a fixed order (by update order, then in the order in which they
+        // were added), instead of dispatching them to the worker threads as
+        // their dependencies finish. loops parallelized with parallel_for()
+        // still run on the worker threads.
+        // * the events enqueued or emitted by the ranges of a parallel_for()
+        //   would be delivered in the order the worker threads got to them,
+        //   so enqueue_event(), emplace_event() and emit() throw an exception
+        //   when called from a range in a deterministic run. ranges can
+        //   record what happened instead, and the system can send the
+        //   events after the loop.
+        // * this takes effect in the next run.
+        void set_deterministic(bool deterministic);
+
+        constexpr bool is_deterministic() const
+        {
+            return deterministic;
+        }
+
+        // record the next runs to a recording, or replay the run in a
+        // recording. a recorded or replayed run is always deterministic
+        // (see set_deterministic()).
+        // * while recording, events enqueued or emitted from outside the
+        //   world's systems (like by another thread) are delivered at the
+        //   start of the next iteration and recorded along with the time of
+        //   every iteration.
+        // * while replaying, the recorded events and times are used instead
+        //   of the live ones, and events from outside the world are ignored.
+        //   the run stops at the end of the recording, and the world's seed
+        //   is set to the recorded one.
+        // * typed events must be copyable to be recorded.
+        // * this must not be called while the world is running.
+        void set_replay(
+            replay_mode_t mode,
+            std::shared_ptr<world_recording_t> recording = nullptr
+        );
+
+        replay_mode_t get_replay_mode() const
+        {
+            return replay_mode;
+        }
+
+        constexpr const std::shared_ptr<world_recording_t>&
+            get_recording() const
+        {
+            return recording;
+        }
+
+        // how precisely the iterations of the current or most recent run met
+        // the maximum update rate. this can be called from any thread.
+        misc::frame_pacing_stats_t get_frame_pacing_stats() const
+        {
+            return frame_pacer.get_stats();
+        }
+
         // start the main loop with a given maximum update rate. this will call
         // the abstract functions of the systems present in the world.
-        // * avoid adding or removing systems while the world is running, as it
-        //   will not affect the current run.
+        // * the system graphs and the event subscribers are prepared on the
+        //   first run and reused by the following runs until the schedule is
+        //   invalidated (see invalidate_schedule()), and the worker threads
+        //   are kept as well, so many short runs are cheap to start.
+        // * systems can be added and removed while the world is running. the
+        //   changes are applied together at the start of the next iteration,
+        //   where the removed systems are stopped, the added systems are
+        //   started, and the schedule is updated for them, without stopping
+        //   or restarting the rest of the systems. the run stops if an added
+        //   system fails to start.
         // * only a single thread can be running the world at a time.
         // * use a max_update_rate of 0 for uncapped update rate.
         // * use a max_run_time of 0 for uncapped run time.
@@ -87,94 +661,437 @@ namespace gsx::ecs
         void stop(bool wait);
 
     private:
-        // a group of systems with identical update order values, all to be
-        // updated in parallel (except ones with run_on_world_thread=true).
+        // a system in the update graph. each node depends on the nodes of the
+        // systems with lower update orders that it conflicts with, and it's
+        // updated as soon as all of them are finished, without waiting for
+        // the rest of the systems.
         // here's how the systems could be updated in a hypothetical world:
-        // 1. update the movement system, the jump system, and the physics
-        //    system, all in parallel.
-        // 2. after step 1 is finished, update the collision system.
-        // 3. update the audio system and the render system in parallel.
-        // think of each step as a system group. notice how the system groups
-        // are run in serial, but the systems inside each group are updated
-        // together in parallel.
-        struct system_group_t
-        {
-            i32 update_order;
-            std::vector<std::shared_ptr<base_system_t>> systems;
+        // 1. the movement system and the jump system write to the transform
+        //    components, so they're updated first, in parallel.
+        // 2. the collision system reads the transforms, so it's updated as
+        //    soon as both systems in step 1 are finished.
+        // 3. the audio system only reads the sound components, so it's
+        //    updated in parallel with all of the above, even though it has a
+        //    higher update order.
+        struct system_node_t
+        {
+            std::shared_ptr<base_system_t> system;
+
+            // indices of the nodes that depend on this one
+            std::vector<usize> dependents;
+
+            // number of nodes that this one depends on
+            usize n_dependencies = 0;
+
+            // where to record the time spent in the system
+            profiler_t::system_profile_t* profile = nullptr;
+
+            // the tick counter value at which the system is updated (modulo
+            // execution_scheme_t::tick_divisor)
+            u64 tick_offset = 0;
+
+            // seconds at which the system is due to be updated next, with
+            // execution_scheme_t::tick_rate
+            f64 next_tick_time = 0;
+
+            // seconds at which the system was last updated
+            f64 last_tick_time = 0;
+
+            // see iteration_t::last_version
+            u64 last_version = 0;
         };
 
-        // mapping from a system pointer to a worker thread used to invoke the
-        // abtract functions of that system (start, update, trigger, stop). if
-        // the worker is nullptr, then the system must run on the same thread
-        // that is running the world.
-        using worker_map_t =
-            std::unordered_map<base_system_t*, std::shared_ptr<misc::worker_t>>;
+        // a system subscribed to a typed event channel
+        struct channel_subscriber_t
+        {
+            // index of the system in the copied system list
+            usize system_index;
+
+            // see base_system_t::subscription_t
+            void* handler;
+        };
+
+        // the systems to trigger for each event type, so that processing an
+        // event only touches the systems that are interested in it. this is
+        // prepared at the start of every run from the triggers and the
+        // subscriptions of the systems.
+        struct event_subscribers_t
+        {
+            // indices of the systems in the copied system list for each
+            // event type of untyped events (event_t)
+            std::unordered_map<event_type_t, std::vector<usize>> by_event_type;
+
+            // subscribers of each typed event channel, indexed by type ID
+            std::vector<std::vector<channel_subscriber_t>> by_type_id;
+        };
 
         std::shared_ptr<base_logger_t> logger;
+
+        // the name that log entries refer to. see intern_log_name().
+        const std::string_view log_name;
+
         std::mutex mutex_run;
-        std::mutex mutex_events;
-        std::deque<event_t> events;
+        misc::mpsc_queue_t<event_t> events;
+
+        // typed event channels indexed by type ID. entries are null for types
+        // that were never emitted.
+        std::shared_mutex mutex_channels;
+        std::vector<std::unique_ptr<base_event_channel_t>> channels;
+
+        // resources indexed by type ID. entries are null for types that
+        // aren't resources of the world.
+        // * the mutex only serializes adding and removing resources, and
+        //   saving and restoring them, not looking them up. adding and
+        //   removing also hold mutex_systems, so that the world can't start
+        //   running meanwhile.
+        std::mutex mutex_resources;
+        std::vector<std::unique_ptr<base_resource_t>> resources;
+
+        // a change to the system list
+        struct system_change_t
+        {
+            enum class kind_t : u8
+            {
+                add,
+                remove_first_named,
+                remove_all_named,
+                remove_all
+            };
+
+            kind_t kind;
+
+            // the system to add
+            std::shared_ptr<base_system_t> system;
+
+            // the name of the systems to remove
+            std::string name;
+        };
+
+        // guards the system list, the pending changes and is_running
+        std::mutex mutex_systems;
         std::vector<std::shared_ptr<base_system_t>> systems;
+
+        // changes made while the world is running, which are applied at the
+        // start of the next iteration
+        std::vector<system_change_t> system_changes;
+        bool is_running = false;
+
+        registry_t registry;
+        profiler_t profiler;
+        tracer_t tracer;
+        misc::frame_pacer_t frame_pacer;
         bool should_stop = false;
 
+        // see set_seed(), set_deterministic() and set_replay()
+        u64 seed = 0;
+        bool deterministic = false;
+        std::atomic<replay_mode_t> replay_mode = replay_mode_t::none;
+        std::shared_ptr<world_recording_t> recording;
+
+        // whether the current run updates the systems one at a time
+        bool is_run_deterministic = false;
+
+        // inputs from outside the world while it's recording, which are
+        // recorded and given to the world at the start of the next iteration
+        misc::mpsc_queue_t<recorded_input_t> inputs;
+
+        // marks the calling thread as running a system of a world, so that
+        // events enqueued from it aren't mistaken for input from outside
+        class system_scope_t
+        {
+        public:
+            system_scope_t(const world_t& world);
+
+            // also tag the commands recorded by the calling thread with a
+            // key (see command_buffer_t) until the scope ends. the previous
+            // key is restored afterwards, since a thread that waits for a
+            // parallel_for() can run the jobs of other systems meanwhile.
+            system_scope_t(world_t& world, command_buffer_t::key_t key);
+
+            no_copy_construct_no_assignment(system_scope_t);
+            ~system_scope_t();
+
+        private:
+            const world_t* prev_world;
+            const world_t* prev_range_world;
+            command_buffer_t* commands = nullptr;
+            command_buffer_t::key_t prev_key;
+
+        };
+
+        // identifies the world in the threads' command buffer caches, since
+        // another world may be created at the same address
+        const u64 id;
+
+        // the command buffers of every thread that recorded commands for the
+        // world, indexed by their indices
+        std::mutex mutex_commands;
+        std::vector<std::unique_ptr<command_buffer_t>> command_buffers;
+
+        // set while run() may play back the command buffers, when only the
+        // systems may record. see get_commands().
+        std::atomic<bool> is_playback_active = false;
+
+        // marks the world as running for the lifetime of a run() call, so
+        // that the run is wrapped up even if it throws. see begin_running()
+        // and end_running().
+        class run_scope_t
+        {
+        public:
+            run_scope_t(world_t& world);
+            no_copy_construct_no_assignment(run_scope_t);
+            ~run_scope_t();
+
+        private:
+            world_t& world;
+
+        };
+
+        // mark the world as running, so that changes to the system list are
+        // queued and only the systems may record commands
+        void begin_running();
+
+        // close the trace, mark the world as not running and apply the
+        // system changes queued while it was running
+        void end_running();
+
+        // make the changes recorded in the command buffers.
+        // * this function is called internally by run() while no system is
+        //   running.
+        void play_back_commands();
+
+        // lock mutex_run while a snapshot is saved or restored, so that run()
+        // waits for it, or throw an exception if the world is running
+        std::unique_lock<std::mutex> lock_for_snapshot(const char* action);
+
+        // lock mutex_systems while a resource is added or removed, so that
+        // run() waits for it, or throw an exception if the world is running
+        std::unique_lock<std::mutex> lock_for_resource_change(
+            const char* action
+        );
+
+        // whether an event enqueued now is input from outside the world that
+        // must be recorded or ignored
+        bool is_external_input() const;
+
+        // whether the calling thread is running a range of a parallel_for()
+        // or parallel_reduce() of the world
+        bool is_in_parallel_range() const;
+
+        // throw an exception if an event enqueued or emitted now would make
+        // a deterministic run depend on the timing of the worker threads
+        void check_event_order() const
+        {
+            if (is_in_parallel_range() && is_run_deterministic)
+                throw std::runtime_error(
+                    "events can't be sent from the ranges of parallel_for() "
+                    "in a deterministic run"
+                );
+        }
+
+        // record an input from outside the world, or ignore it if replaying
+        void add_input(recorded_input_t input);
+
+        // give the recorded inputs to the world at the start of an iteration
+        // and set its time, or record them along with the time.
+        // * this function is called internally by run().
+        void record_or_replay_inputs(iteration_t& iter);
+
+        // see set_fixed_timestep()
+        f64 fixed_timestep = 0;
+        u32 max_substeps = 8;
+
+        // worker threads used for updating systems in parallel. this is
+        // created on the first run (unless it was given to the constructor)
+        // and reused by the following runs.
+        std::shared_ptr<misc::thread_pool_t> thread_pool;
+
+        // everything that run() prepares from the system list
+        struct schedule_t
+        {
+            // a copy of the system list, which the other members index
+            std::vector<std::shared_ptr<base_system_t>> systems;
+
+            // the profiles of the systems
+            std::vector<profiler_t::system_profile_t*> profiles;
+
+            // graphs of the systems updated in fixed steps and of the rest
+            // of the systems
+            std::vector<system_node_t> fixed_system_nodes;
+            std::vector<system_node_t> system_nodes;
+
+            event_subscribers_t event_subscribers;
+
+            // the fixed timestep that the systems were split by
+            f64 fixed_timestep = 0;
+        };
+
+        // the schedule of the previous run, which is prepared again when
+        // it's stale
+        std::unique_ptr<schedule_t> schedule;
+        std::atomic<bool> is_schedule_stale = true;
+
+        // * this function is called internally by run().
+        void prepare_schedule(f64 step);
+
+        // make the graphs and the event subscribers of a schedule from its
+        // copied system list and profiles.
+        // * this function is called internally by run().
+        void build_schedule(schedule_t& schedule);
+
+        // apply a change to the system list while holding mutex_systems, or
+        // queue it if the world is running.
+        void change_systems(system_change_t change);
+
+        // apply a change to the system list. mutex_systems must be held.
+        void apply_system_change(const system_change_t& change);
+
+        // apply the changes queued since the last iteration, stop the
+        // removed systems, start the added ones and update the schedule.
         // * this function is called internally by run().
-        void prepare_system_groups_and_workers(
+        void apply_system_changes(
+            const iteration_t& iter,
+            bool& out_did_start_all
+        );
+
+        // make a graph of some of the systems, given their indices in the
+        // copied system list.
+        // * this function is called internally by run().
+        void prepare_system_graph(
+            std::vector<std::shared_ptr<base_system_t>>& systems_copy,
+            const std::vector<profiler_t::system_profile_t*>& profiles,
+            const std::vector<usize>& indices,
+            std::vector<system_node_t>& out_system_nodes
+        );
+
+        void prepare_event_subscribers(
             std::vector<std::shared_ptr<base_system_t>>& systems_copy,
-            std::vector<system_group_t>& out_system_groups,
-            worker_map_t& out_worker_map
+            event_subscribers_t& out_subscribers
         );
 
         void start_systems(
             std::vector<std::shared_ptr<base_system_t>>& systems_copy,
-            worker_map_t& worker_map,
             bool& out_did_start_all
         );
 
         void process_events(
             std::vector<std::shared_ptr<base_system_t>>& systems_copy,
-            worker_map_t& worker_map,
+            const std::vector<profiler_t::system_profile_t*>& profiles,
+            const event_subscribers_t& subscribers,
             const iteration_t& iter,
             bool& out_did_process_all
         );
 
+        // update the systems in a graph that are due to be updated. tick is
+        // what the tick divisors of the systems count, the iteration number
+        // or the fixed step number.
         void update_systems(
-            std::vector<system_group_t>& system_groups,
-            worker_map_t& worker_map,
+            std::vector<system_node_t>& system_nodes,
             const iteration_t& iter,
+            u64 tick,
             bool& out_did_update_all
         );
 
+        // prepare the tick state of the systems for a new run, or for a
+        // schedule updated at a given time during a run
+        static void reset_ticks(
+            std::vector<system_node_t>& system_nodes,
+            f64 time = 0
+        );
+
+        // whether a system is due to be updated, and the iteration to update
+        // it with if so
+        static bool is_tick_due(
+            system_node_t& node,
+            const iteration_t& iter,
+            u64 tick,
+            iteration_t& out_iter
+        );
+
+        // invoke fn(node_index) for every node in a graph, each as soon as
+        // its dependencies are finished. fn must return false if it failed.
+        void run_system_graph(
+            std::vector<system_node_t>& system_nodes,
+            const std::function<bool(usize)>& fn,
+            bool& out_did_run_all
+        );
+
         void stop_systems(
             std::vector<std::shared_ptr<base_system_t>>& systems_copy,
-            worker_map_t& worker_map,
             const iteration_t& iter
         );
 
-        bool try_start_system(
+        bool try_start_system(std::shared_ptr<base_system_t>& system);
+
+        bool try_trigger_system(
             std::shared_ptr<base_system_t>& system,
-            const std::shared_ptr<misc::worker_t>& worker
+            const iteration_t& iter,
+            event_type_t type,
+            std::span<const event_t> events
         );
 
-        bool try_trigger_system(
+        bool try_deliver_events(
             std::shared_ptr<base_system_t>& system,
-            const std::shared_ptr<misc::worker_t>& worker,
             const iteration_t& iter,
-            const event_t& event
+            type_id_t type,
+            base_event_channel_t& channel,
+            void* handler
         );
 
         bool try_update_system(
             std::shared_ptr<base_system_t>& system,
-            const system_group_t& group,
-            const std::shared_ptr<misc::worker_t>& worker,
             const iteration_t& iter
         );
 
         void try_stop_system(
             std::shared_ptr<base_system_t>& system,
-            const std::shared_ptr<misc::worker_t>& worker,
             const iteration_t& iter
         );
 
+        void log_enqueue_event(event_type_t type);
+
+        // the channels of the world that the calling thread has used,
+        // indexed by type ID, with nulls for the types it hasn't used.
+        // * channels are never removed once created, so emitting only locks
+        //   mutex_channels the first time a thread emits a type.
+        std::vector<base_event_channel_t*>& get_channel_cache();
+
+        template<typename T>
+        event_channel_t<T>& get_or_create_channel()
+        {
+            const type_id_t id = type_id_of<T>();
+            std::vector<base_event_channel_t*>& cache = get_channel_cache();
+            if (id < cache.size() && cache[id])
+                return static_cast<event_channel_t<T>&>(*cache[id]);
+
+            base_event_channel_t* channel;
+            {
+                std::unique_lock lock(mutex_channels);
+                if (id >= channels.size())
+                {
+                    channels.resize(id + 1);
+                }
+                if (!channels[id])
+                {
+                    channels[id] = std::make_unique<event_channel_t<T>>();
+                }
+                channel = channels[id].get();
+            }
+
+            if (id >= cache.size())
+            {
+                cache.resize(id + 1, nullptr);
+            }
+            cache[id] = channel;
+            return static_cast<event_channel_t<T>&>(*channel);
+        }
+
+        // describe the calling thread for logging, like "on worker thread #2"
+        std::string current_thread_name() const;
+
+        // the thread index of the calling thread in traces (see tracer_t)
+        usize current_trace_thread() const;
+
     };
 
 }
@@ -215,6 +215,17 @@ namespace gsx::math
             return (x << k) | (x >> (32u - k));
         }
 
+        // the state must not be all zeros, or the generator only returns 0
+        void set_state(u32 s0, u32 s1)
+        {
+            state[0] = s0;
+            state[1] = s1;
+            if (s0 == 0 && s1 == 0)
+            {
+                state[0] = 1;
+            }
+        }
+
         template<typename A>
             requires (sizeof(A) > 0 && sizeof(A) % sizeof(u32) == 0)
         void init(const A& seed)
@@ -241,6 +252,7 @@ namespace gsx::math
                 hash1 = (hash1 * prime5) ^ (new_val * prime6);
             }
 
+            set_state(hash0, hash1);
             next<u32>();
         }
 
@@ -269,9 +281,9 @@ namespace gsx::math
                 {
                     const u32 new_val =
                         prime0
-                        + (i == 0)
-                        ? reinterpret_cast<const u32*>(&seed0)[j]
-                        : reinterpret_cast<const u32*>(&seed1)[j];
+                        + ((i == 0)
+                            ? reinterpret_cast<const u32*>(&seed0)[j]
+                            : reinterpret_cast<const u32*>(&seed1)[j]);
 
                     hash0 += prime1;
                     hash1 += prime2;
@@ -281,6 +293,7 @@ namespace gsx::math
                 }
             }
 
+            set_state(hash0, hash1);
             next<u32>();
         }
 
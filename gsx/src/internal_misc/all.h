@@ -2,4 +2,7 @@
 
 #include "fixed_vector.h"
 #include "worker.h"
+#include "thread_pool.h"
+#include "mpsc_queue.h"
+#include "frame_pacer.h"
 #include "utils.h"
@@ -0,0 +1,96 @@
+#include "frame_pacer.h"
+
+#include <thread>
+#include <algorithm>
+
+#include "utils.h"
+
+namespace gsx::misc
+{
+
+    static std::chrono::steady_clock::duration to_duration(f64 seconds)
+    {
+        return std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<f64>(seconds)
+        );
+    }
+
+    frame_pacer_t::frame_pacer_t(f64 period, f64 spin_time)
+        : period(period), spin_time(spin_time)
+    {
+        reset(period);
+    }
+
+    void frame_pacer_t::reset(f64 period)
+    {
+        this->period = period;
+        deadline = std::chrono::steady_clock::now() + to_duration(period);
+
+        std::scoped_lock lock(mutex_stats);
+        stats = frame_pacing_stats_t();
+        total_jitter = 0;
+    }
+
+    f64 frame_pacer_t::wait()
+    {
+        if (period <= 0)
+            return 0;
+
+        auto time_start = std::chrono::steady_clock::now();
+        bool missed = time_start >= deadline;
+
+        if (!missed)
+        {
+            // sleep through most of the time left, then spin until the
+            // deadline
+            auto wake_time = deadline - to_duration(spin_time);
+            if (time_start < wake_time)
+            {
+                std::this_thread::sleep_until(wake_time);
+            }
+            while (std::chrono::steady_clock::now() < deadline)
+            {
+                std::this_thread::yield();
+            }
+        }
+
+        auto time_end = std::chrono::steady_clock::now();
+        f64 jitter = missed
+            ? 0
+            : elapsed_sec<f64>(deadline, time_end);
+
+        // the next deadline is one period after this one, unless this frame
+        // is so late that it would already be missed
+        deadline += to_duration(period);
+        if (deadline <= time_end)
+        {
+            deadline = time_end + to_duration(period);
+        }
+
+        {
+            std::scoped_lock lock(mutex_stats);
+            stats.n_frames++;
+            if (missed)
+            {
+                stats.n_missed++;
+            }
+            else
+            {
+                total_jitter += jitter;
+                stats.max_jitter = std::max(stats.max_jitter, jitter);
+            }
+
+            u64 n_met = stats.n_frames - stats.n_missed;
+            stats.mean_jitter = (n_met > 0) ? total_jitter / (f64)n_met : 0;
+        }
+
+        return elapsed_sec<f64>(time_start, time_end);
+    }
+
+    frame_pacing_stats_t frame_pacer_t::get_stats() const
+    {
+        std::scoped_lock lock(mutex_stats);
+        return stats;
+    }
+
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <chrono>
+#include <mutex>
+#include <cstdint>
+
+#include "../internal_common/all.h"
+
+namespace gsx::misc
+{
+
+    // how precisely a frame_pacer_t met its deadlines
+    struct frame_pacing_stats_t
+    {
+        // number of frames that were paced
+        u64 n_frames = 0;
+
+        // number of frames that were already late when wait() was called
+        u64 n_missed = 0;
+
+        // seconds by which the frames that weren't missed overshot their
+        // deadlines
+        f64 mean_jitter = 0;
+        f64 max_jitter = 0;
+    };
+
+    // paces a loop to a fixed period (like a maximum update rate) using
+    // absolute deadlines on std::chrono::steady_clock. unlike sleeping for
+    // the time left in every frame, the deadlines don't drift, since each one
+    // is exactly one period after the previous one regardless of when the
+    // previous frame actually ended.
+    // * to avoid the overshoot of the OS scheduler, the pacer sleeps until
+    //   shortly before a deadline and spins for the rest of the time.
+    // * if a frame misses its deadline by more than a whole period, the
+    //   following deadlines are moved instead of rushing through several
+    //   frames to catch up.
+    class frame_pacer_t
+    {
+    public:
+        // period and spin_time are in seconds. a period of 0 doesn't wait at
+        // all.
+        frame_pacer_t(f64 period = 0, f64 spin_time = .002);
+        no_copy_construct_no_assignment(frame_pacer_t);
+
+        constexpr f64 get_period() const
+        {
+            return period;
+        }
+
+        constexpr f64 get_spin_time() const
+        {
+            return spin_time;
+        }
+
+        // start pacing from now, with a new period, and reset the statistics
+        void reset(f64 period);
+
+        // wait until the end of the current frame and start the next one.
+        // returns the number of seconds spent waiting.
+        f64 wait();
+
+        // this can be called from any thread
+        frame_pacing_stats_t get_stats() const;
+
+    private:
+        f64 period;
+        const f64 spin_time;
+        std::chrono::steady_clock::time_point deadline;
+
+        mutable std::mutex mutex_stats;
+        frame_pacing_stats_t stats;
+
+        // sum of the jitters of the frames that weren't missed
+        f64 total_jitter = 0;
+
+    };
+
+}
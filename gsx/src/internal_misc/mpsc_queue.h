@@ -0,0 +1,133 @@
+#pragma once
+
+#include <atomic>
+#include <optional>
+#include <utility>
+#include <cstdint>
+
+#include "../internal_common/all.h"
+
+namespace gsx::misc
+{
+
+    // an unbounded multi-producer single-consumer queue. pushing never takes
+    // a lock (it's a single atomic exchange), so producers on different
+    // threads don't block each other. only one thread may pop, drain or
+    // visit the elements at a time.
+    // * an element pushed concurrently with a drain may be left for the next
+    //   drain, since it only becomes visible once its push is finished.
+    template<typename T>
+    class mpsc_queue_t
+    {
+    public:
+        mpsc_queue_t()
+            : head(new node_t), tail(head.load())
+        {}
+
+        no_copy_construct_no_assignment(mpsc_queue_t);
+
+        ~mpsc_queue_t()
+        {
+            while (tail)
+            {
+                node_t* next = tail->next.load();
+                delete tail;
+                tail = next;
+            }
+        }
+
+        void push(const T& value)
+        {
+            emplace(value);
+        }
+
+        void push(T&& value)
+        {
+            emplace(std::move(value));
+        }
+
+        // construct an element in place at the end of the queue
+        template<typename... Args>
+        void emplace(Args&&... args)
+        {
+            node_t* node = new node_t;
+            node->value.emplace(std::forward<Args>(args)...);
+            link(node);
+        }
+
+        // take the element at the front of the queue, if there is one
+        std::optional<T> pop()
+        {
+            node_t* next = tail->next.load(std::memory_order_acquire);
+            if (!next)
+                return std::nullopt;
+
+            // the next node becomes the new (empty) front node
+            std::optional<T> value = std::move(next->value);
+            next->value.reset();
+            delete tail;
+            tail = next;
+            return value;
+        }
+
+        // invoke fn(T&) for every element in the queue, in the order in which
+        // they were pushed, and remove them. elements pushed from inside fn
+        // are drained too. returns the number of drained elements.
+        template<typename F>
+        usize drain(F&& fn)
+        {
+            usize count = 0;
+            while (auto value = pop())
+            {
+                fn(*value);
+                count++;
+            }
+            return count;
+        }
+
+        // invoke fn(const T&) for every element in the queue, in the order in
+        // which they were pushed, without removing them. like pop() and
+        // drain(), this may only be called by the consumer. returns the
+        // number of visited elements.
+        template<typename F>
+        usize for_each(F&& fn) const
+        {
+            usize count = 0;
+            node_t* node = tail->next.load(std::memory_order_acquire);
+            while (node)
+            {
+                fn(std::as_const(*node->value));
+                count++;
+                node = node->next.load(std::memory_order_acquire);
+            }
+            return count;
+        }
+
+        // whether the queue looks empty to the consumer
+        bool empty() const
+        {
+            return tail->next.load(std::memory_order_acquire) == nullptr;
+        }
+
+    private:
+        struct node_t
+        {
+            std::atomic<node_t*> next = nullptr;
+            std::optional<T> value;
+        };
+
+        // the most recently pushed node, swapped by the producers
+        std::atomic<node_t*> head;
+
+        // the node before the front element, only touched by the consumer
+        node_t* tail;
+
+        void link(node_t* node)
+        {
+            node_t* prev = head.exchange(node, std::memory_order_acq_rel);
+            prev->next.store(node, std::memory_order_release);
+        }
+
+    };
+
+}
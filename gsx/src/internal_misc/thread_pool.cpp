@@ -0,0 +1,232 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <optional>
+
+namespace gsx::misc
+{
+
+    // pool and index of the worker running on the current thread
+    static thread_local const thread_pool_t* tl_pool = nullptr;
+    static thread_local isize tl_index = -1;
+
+    thread_pool_t::thread_pool_t(usize n_threads)
+    {
+        if (n_threads == 0)
+            n_threads = std::max(1u, std::thread::hardware_concurrency());
+
+        for (usize i = 0; i < n_threads; i++)
+        {
+            workers.push_back(std::make_unique<worker_t>());
+        }
+
+        // start the threads after every queue exists, since workers steal
+        // from each other.
+        for (usize i = 0; i < n_threads; i++)
+        {
+            workers[i]->thread = std::jthread(
+                [this, i]()
+                {
+                    loop(i);
+                }
+            );
+        }
+    }
+
+    thread_pool_t::~thread_pool_t()
+    {
+        stopping.store(true, std::memory_order_release);
+        epoch.fetch_add(1, std::memory_order_release);
+        epoch.notify_all();
+
+        for (auto& worker : workers)
+        {
+            worker->thread.join();
+        }
+    }
+
+    void thread_pool_t::enqueue(std::function<void()> job, job_group_t* group)
+    {
+        if (group)
+        {
+            group->n_pending.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        usize index = (tl_pool == this)
+            ? (usize)tl_index
+            : next_queue.fetch_add(1, std::memory_order_relaxed)
+            % workers.size();
+
+        {
+            std::scoped_lock lock(workers[index]->mutex);
+            workers[index]->jobs.push_back(job_t{ std::move(job), group });
+        }
+
+        epoch.fetch_add(1, std::memory_order_release);
+        epoch.notify_one();
+    }
+
+    void thread_pool_t::wait(job_group_t& group)
+    {
+        isize index = (tl_pool == this) ? tl_index : -1;
+        while (true)
+        {
+            // load this before checking the group so that a group finishing
+            // in between is not missed.
+            u32 seen = completions.load();
+            if (group.n_pending.load() == 0)
+                break;
+
+            if (try_run_one(index, (index >= 0) ? nullptr : &group))
+                continue;
+
+            // nothing to help with, so the remaining jobs are running on other
+            // threads. sleep until a group finishes.
+            completions.wait(seen);
+        }
+    }
+
+    bool thread_pool_t::run_pending_job()
+    {
+        return try_run_one(current_worker_index());
+    }
+
+    bool thread_pool_t::run_pending_job(const job_group_t& group)
+    {
+        return try_run_one(current_worker_index(), &group);
+    }
+
+    isize thread_pool_t::current_worker_index() const
+    {
+        return (tl_pool == this) ? tl_index : -1;
+    }
+
+    usize thread_pool_t::range_count(usize begin, usize end, usize grain) const
+    {
+        if (begin >= end)
+            return 0;
+
+        usize n = end - begin;
+        grain = std::max<usize>(1, grain);
+        usize max_ranges = (n + grain - 1) / grain;
+
+        // the calling thread processes ranges too
+        usize n_threads = workers.size() + 1;
+
+        return std::min(max_ranges, 4 * n_threads);
+    }
+
+    usize thread_pool_t::reduce_range_count(
+        usize begin,
+        usize end,
+        usize grain
+    )
+    {
+        if (begin >= end)
+            return 0;
+
+        usize n = end - begin;
+        grain = std::max<usize>(1, grain);
+        usize max_ranges = (n + grain - 1) / grain;
+
+        // enough ranges to keep the workers of a large machine busy
+        return std::min<usize>(max_ranges, 256);
+    }
+
+    std::pair<usize, usize> thread_pool_t::range_bounds(
+        usize begin,
+        usize end,
+        usize n_ranges,
+        usize index
+    )
+    {
+        usize n = end - begin;
+        return {
+            begin + n * index / n_ranges,
+            begin + n * (index + 1) / n_ranges
+        };
+    }
+
+    void thread_pool_t::loop(usize index)
+    {
+        tl_pool = this;
+        tl_index = (isize)index;
+
+        while (true)
+        {
+            u32 seen = epoch.load(std::memory_order_acquire);
+
+            if (try_run_one((isize)index))
+                continue;
+
+            // only stop once there's nothing left to do
+            if (stopping.load(std::memory_order_acquire))
+                break;
+
+            // sleep until a new job is enqueued. if one was enqueued after
+            // loading the epoch, this returns immediately.
+            epoch.wait(seen, std::memory_order_acquire);
+        }
+    }
+
+    bool thread_pool_t::try_run_one(isize index, const job_group_t* group)
+    {
+        std::optional<job_t> job;
+
+        // own queue first, newest job first
+        if (index >= 0)
+        {
+            worker_t& worker = *workers[index];
+            std::scoped_lock lock(worker.mutex);
+            for (usize i = worker.jobs.size(); i > 0; i--)
+            {
+                if (group && worker.jobs[i - 1].group != group)
+                    continue;
+
+                job = std::move(worker.jobs[i - 1]);
+                worker.jobs.erase(worker.jobs.begin() + (i - 1));
+                break;
+            }
+        }
+
+        // steal the oldest job from another queue
+        if (!job)
+        {
+            usize start = (index >= 0) ? (usize)index + 1 : 0;
+            for (usize i = 0; i < workers.size() && !job; i++)
+            {
+                worker_t& victim = *workers[(start + i) % workers.size()];
+                std::scoped_lock lock(victim.mutex);
+                for (usize j = 0; j < victim.jobs.size(); j++)
+                {
+                    if (group && victim.jobs[j].group != group)
+                        continue;
+
+                    job = std::move(victim.jobs[j]);
+                    victim.jobs.erase(victim.jobs.begin() + j);
+                    break;
+                }
+            }
+        }
+
+        if (!job)
+            return false;
+
+        run(*job);
+        return true;
+    }
+
+    void thread_pool_t::run(job_t& job)
+    {
+        job.fn();
+
+        // the group may be destroyed as soon as its last job is finished, so
+        // it must not be touched after the decrement.
+        if (job.group && job.group->n_pending.fetch_sub(1) == 1)
+        {
+            completions.fetch_add(1);
+            completions.notify_all();
+        }
+    }
+
+}
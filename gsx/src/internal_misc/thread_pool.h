@@ -0,0 +1,286 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <exception>
+#include <utility>
+#include <cstdint>
+
+#include "../internal_common/all.h"
+
+namespace gsx::misc
+{
+
+    // tracks the completion of a set of jobs enqueued in a thread_pool_t
+    class job_group_t
+    {
+    public:
+        job_group_t() = default;
+        no_copy_construct_no_assignment(job_group_t);
+
+        // number of jobs that are enqueued or running
+        usize pending() const
+        {
+            return n_pending.load(std::memory_order_acquire);
+        }
+
+    private:
+        std::atomic<usize> n_pending = 0;
+
+        friend class thread_pool_t;
+
+    };
+
+    // a fixed set of worker threads that process jobs. every worker has its
+    // own job queue: it takes jobs from the back of its own queue, and when
+    // that's empty, it steals jobs from the front of the other queues. idle
+    // workers sleep until new jobs are enqueued.
+    // * jobs must not throw exceptions.
+    class thread_pool_t
+    {
+    public:
+        // spawn a given number of worker threads. use 0 to spawn one worker
+        // per hardware thread.
+        thread_pool_t(usize n_threads = 0);
+        no_copy_construct_no_assignment(thread_pool_t);
+
+        // stop the workers after every enqueued job is processed
+        ~thread_pool_t();
+
+        // number of worker threads
+        usize size() const
+        {
+            return workers.size();
+        }
+
+        // enqueue a job. if called from a worker thread of this pool, the job
+        // goes to that worker's own queue, otherwise the queues are chosen in
+        // a round-robin fashion.
+        // * group may be nullptr.
+        void enqueue(std::function<void()> job, job_group_t* group = nullptr);
+
+        // wait until every job in a group is finished. the calling thread
+        // helps process jobs in the meantime, so this can be called from
+        // inside a job.
+        // * threads that aren't workers of this pool only help with the jobs
+        //   of the group, so that they don't run the jobs of unrelated users
+        //   of the pool (like other worlds sharing it), which may expect
+        //   every thread outside the pool to be their own.
+        void wait(job_group_t& group);
+
+        // run a single enqueued job on the calling thread, if there is one.
+        // returns false if there were no jobs to run.
+        bool run_pending_job();
+
+        // run a single enqueued job of a group on the calling thread, if
+        // there is one. returns false if there were no such jobs to run.
+        bool run_pending_job(const job_group_t& group);
+
+        // split [begin, end) into contiguous ranges of at least grain indices
+        // and invoke fn(range_begin, range_end) for every range in parallel.
+        // the calling thread processes the first range and helps with the
+        // rest, then returns once every range is finished.
+        // * if fn throws an exception, the other ranges still run, and the
+        //   exception of the first range that threw is rethrown on the
+        //   calling thread once every range is finished.
+        template<typename F>
+        void parallel_for(usize begin, usize end, usize grain, F&& fn)
+        {
+            for_each_range(
+                begin,
+                end,
+                range_count(begin, end, grain),
+                [&fn](usize index, usize range_begin, usize range_end)
+                {
+                    fn(range_begin, range_end);
+                }
+            );
+        }
+
+        // split [begin, end) into contiguous ranges of at least grain indices
+        // and compute fn(range_begin, range_end) -> T for every range in
+        // parallel, then combine the partial results with reduce(T, T) -> T
+        // in the order of the ranges, starting with identity. the ranges
+        // only depend on the arguments, not on the number of workers, so the
+        // result is the same in every call and on every machine even if
+        // reduce is not associative (like float addition).
+        // * exceptions thrown by fn are rethrown like in parallel_for(), and
+        //   reduce is only invoked if fn didn't throw.
+        template<typename T, typename F, typename R>
+        T parallel_reduce(
+            usize begin,
+            usize end,
+            usize grain,
+            T identity,
+            F&& fn,
+            R&& reduce
+        )
+        {
+            const usize n_ranges = reduce_range_count(begin, end, grain);
+            std::vector<T> partials(n_ranges, identity);
+            for_each_range(
+                begin,
+                end,
+                n_ranges,
+                [&fn, &partials](
+                    usize index,
+                    usize range_begin,
+                    usize range_end
+                    )
+                {
+                    partials[index] = fn(range_begin, range_end);
+                }
+            );
+
+            T result = std::move(identity);
+            for (auto& partial : partials)
+            {
+                result = reduce(std::move(result), std::move(partial));
+            }
+            return result;
+        }
+
+        // compute the same result as parallel_reduce() on the calling
+        // thread, for callers that can't use a pool
+        template<typename T, typename F, typename R>
+        static T serial_reduce(
+            usize begin,
+            usize end,
+            usize grain,
+            T identity,
+            F&& fn,
+            R&& reduce
+        )
+        {
+            const usize n_ranges = reduce_range_count(begin, end, grain);
+            T result = std::move(identity);
+            for (usize i = 0; i < n_ranges; i++)
+            {
+                auto [range_begin, range_end] =
+                    range_bounds(begin, end, n_ranges, i);
+                result = reduce(std::move(result), fn(range_begin, range_end));
+            }
+            return result;
+        }
+
+        // index of the calling worker thread in this pool, or -1 if the
+        // calling thread doesn't belong to this pool.
+        isize current_worker_index() const;
+
+    private:
+        struct job_t
+        {
+            std::function<void()> fn;
+            job_group_t* group;
+        };
+
+        struct worker_t
+        {
+            std::mutex mutex;
+            std::deque<job_t> jobs;
+            std::jthread thread;
+        };
+
+        std::vector<std::unique_ptr<worker_t>> workers;
+
+        // incremented whenever a job is enqueued, so that sleeping workers
+        // can wait for it to change.
+        std::atomic<u32> epoch = 0;
+
+        // incremented whenever a job group is finished, so that threads in
+        // wait() can sleep until it changes.
+        std::atomic<u32> completions = 0;
+
+        std::atomic<usize> next_queue = 0;
+        std::atomic<bool> stopping = false;
+
+        void loop(usize index);
+
+        // take a job from the queue of a given worker (or from any queue if
+        // index is -1) or steal one from the other workers, and run it. if
+        // group isn't nullptr, only the jobs of that group are taken.
+        // returns false if there were no jobs to run.
+        bool try_run_one(isize index, const job_group_t* group = nullptr);
+
+        void run(job_t& job);
+
+        // number of ranges that [begin, end) is split into by parallel_for().
+        // there are a few ranges per thread so that busy workers can be
+        // balanced by stealing.
+        usize range_count(usize begin, usize end, usize grain) const;
+
+        // number of ranges that [begin, end) is split into by
+        // parallel_reduce(), which doesn't depend on the number of workers
+        static usize reduce_range_count(usize begin, usize end, usize grain);
+
+        // bounds of the range at a given index
+        static std::pair<usize, usize> range_bounds(
+            usize begin,
+            usize end,
+            usize n_ranges,
+            usize index
+        );
+
+        // split [begin, end) into n_ranges ranges, invoke
+        // fn(index, range_begin, range_end) for every range in parallel and
+        // wait for all of them
+        template<typename F>
+        void for_each_range(usize begin, usize end, usize n_ranges, F&& fn)
+        {
+            if (n_ranges == 0)
+                return;
+
+            // the jobs refer to this frame, so exceptions are caught and only
+            // rethrown once every range is finished
+            std::mutex mutex_error;
+            std::exception_ptr error;
+            usize error_index = n_ranges;
+            auto run_range = [&](usize i, usize range_begin, usize range_end)
+            {
+                try
+                {
+                    fn(i, range_begin, range_end);
+                }
+                catch (...)
+                {
+                    std::scoped_lock lock(mutex_error);
+                    if (i < error_index)
+                    {
+                        error = std::current_exception();
+                        error_index = i;
+                    }
+                }
+            };
+
+            job_group_t group;
+            for (usize i = 1; i < n_ranges; i++)
+            {
+                auto [range_begin, range_end] =
+                    range_bounds(begin, end, n_ranges, i);
+                enqueue(
+                    [&run_range, i, range_begin, range_end]()
+                    {
+                        run_range(i, range_begin, range_end);
+                    },
+                    &group
+                );
+            }
+
+            auto [range_begin, range_end] =
+                range_bounds(begin, end, n_ranges, 0);
+            run_range(0, range_begin, range_end);
+
+            wait(group);
+
+            if (error)
+                std::rethrow_exception(error);
+        }
+
+    };
+
+}
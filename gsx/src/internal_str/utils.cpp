@@ -299,11 +299,15 @@ namespace gsx::str
 
     std::string from_time()
     {
-        time_t rawtime;
+        return from_time(std::chrono::system_clock::now());
+    }
+
+    std::string from_time(std::chrono::system_clock::time_point time)
+    {
+        time_t rawtime = std::chrono::system_clock::to_time_t(time);
         struct tm timeinfo;
         char buffer[128];
 
-        time(&rawtime);
         localtime_s(&timeinfo, &rawtime);
         strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", &timeinfo);
 
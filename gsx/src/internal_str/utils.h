@@ -5,6 +5,7 @@
 #include <format>
 #include <vector>
 #include <type_traits>
+#include <chrono>
 #include <cstdint>
 
 #include "../internal_common/all.h"
@@ -102,6 +103,7 @@ namespace gsx::str
 
     // example: "2023-07-30 15:38:09"
     std::string from_time();
+    std::string from_time(std::chrono::system_clock::time_point time);
 
     template<typename T>
     std::string from_number(T v)
@@ -0,0 +1,53 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <filesystem>
+
+#include "gsx/gsx.h"
+
+// converts a binary log written by gsx::ecs::binary_logger_t to CSV
+// usage: log_decoder <input> [output.csv]
+int main(int argc, char** argv)
+{
+    if (argc < 2 || argc > 3)
+    {
+        std::cerr << "usage: log_decoder <input> [output.csv]\n";
+        return -1;
+    }
+
+    std::string input = argv[1];
+    std::string output = (argc == 3)
+        ? argv[2]
+        : std::filesystem::path(input).replace_extension(".csv").string();
+
+    // the output is truncated when it's opened, so it can't be the input,
+    // like when the input already ends in .csv
+    std::error_code error;
+    if (std::filesystem::equivalent(input, output, error))
+    {
+        std::cerr << "the output must not be the same file as the input\n";
+        return -1;
+    }
+
+    try
+    {
+        ecs::binary_log_reader_t reader(input);
+
+        std::ofstream stream(output, std::ofstream::out | std::ofstream::trunc);
+        if (!stream.is_open())
+        {
+            std::cerr << "couldn't create \"" << output << "\"\n";
+            return -1;
+        }
+
+        usize count = reader.write_csv(stream);
+        std::cout << "wrote " << count << " entries to \"" << output
+            << "\"\n";
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << '\n';
+        return -1;
+    }
+    return 0;
+}
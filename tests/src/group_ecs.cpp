@@ -0,0 +1,3143 @@
+#include "group_ecs.h"
+
+#include <string>
+#include <span>
+#include <sstream>
+#include <fstream>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <any>
+#include <optional>
+#include <cmath>
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <tuple>
+
+#include "gsx/gsx.h"
+
+#include "test.h"
+
+using namespace ecs;
+
+struct position_t
+{
+    f32 x = 0;
+    f32 y = 0;
+};
+
+struct velocity_t
+{
+    f32 x = 0;
+    f32 y = 0;
+};
+
+struct name_t
+{
+    std::string value;
+};
+
+// aligned beyond the columns of the archetypes and the snapshots
+struct alignas(128) wide_t
+{
+    f32 value = 0;
+};
+
+static void test_registry()
+{
+    registry_t registry;
+
+    std::vector<entity_t> entities;
+    for (usize i = 0; i < 1000; i++)
+    {
+        entity_t e = registry.create();
+        entities.push_back(e);
+
+        registry.add<position_t>(e, (f32)i, (f32)i * 2.f);
+        if (i % 2 == 0)
+            registry.add<velocity_t>(e, 1.f, -1.f);
+        if (i % 3 == 0)
+            registry.add<name_t>(e, std::to_string(i));
+    }
+    test::assert(registry.size() == 1000, "size()");
+
+    for (usize i = 0; i < entities.size(); i++)
+    {
+        entity_t e = entities[i];
+        test::assert(registry.get<position_t>(e).x == (f32)i, "get()");
+        test::assert(registry.has<velocity_t>(e) == (i % 2 == 0), "has()");
+        if (i % 3 == 0)
+        {
+            test::assert(
+                registry.get<name_t>(e).value == std::to_string(i),
+                "non-trivial component"
+            );
+        }
+        else
+        {
+            test::assert(registry.try_get<name_t>(e) == nullptr, "try_get()");
+        }
+    }
+
+    // remove components and destroy entities, which moves rows around
+    for (usize i = 0; i < entities.size(); i += 4)
+    {
+        registry.remove<position_t>(entities[i]);
+    }
+    for (usize i = 1; i < entities.size(); i += 5)
+    {
+        registry.destroy(entities[i]);
+    }
+
+    for (usize i = 0; i < entities.size(); i++)
+    {
+        entity_t e = entities[i];
+        if (i % 5 == 1)
+        {
+            test::assert(!registry.alive(e), "alive() after destroy()");
+            continue;
+        }
+
+        test::assert(
+            registry.has<position_t>(e) == (i % 4 != 0),
+            "has() after remove()"
+        );
+        if (i % 4 != 0)
+        {
+            test::assert(
+                registry.get<position_t>(e).y == (f32)i * 2.f,
+                "get() after rows were moved"
+            );
+        }
+        if (i % 3 == 0)
+        {
+            test::assert(
+                registry.get<name_t>(e).value == std::to_string(i),
+                "non-trivial component after rows were moved"
+            );
+        }
+    }
+
+    // count the entities with position_t by iterating over the archetypes
+    usize n_positions = 0;
+    for (auto& archetype : registry.get_archetypes())
+    {
+        if (!archetype->has<position_t>())
+            continue;
+
+        for (usize chunk = 0; chunk < archetype->chunk_count(); chunk++)
+        {
+            n_positions += archetype->chunk_size(chunk);
+        }
+    }
+    usize expected = 0;
+    for (usize i = 0; i < entities.size(); i++)
+    {
+        if (i % 4 != 0 && i % 5 != 1)
+            expected++;
+    }
+    test::assert(n_positions == expected, "archetype iteration");
+
+    registry.clear();
+    test::assert(registry.size() == 0, "clear()");
+
+    for (usize i = 0; i < 300; i++)
+    {
+        entity_t e = registry.create();
+        registry.add<position_t>(e);
+        registry.add<wide_t>(e, (f32)i);
+    }
+    registry_snapshot_t snapshot;
+    registry.save(snapshot);
+    registry.clear();
+    registry.restore(snapshot);
+
+    bool is_aligned = registry.size() == 300;
+    usize i_wide = 0;
+    registry.view<const wide_t>().each(
+        [&is_aligned, &i_wide](const wide_t& wide)
+        {
+            is_aligned = is_aligned
+                && reinterpret_cast<uintptr_t>(&wide) % alignof(wide_t) == 0
+                && wide.value == (f32)i_wide++;
+        }
+    );
+    test::assert(is_aligned, "over-aligned components");
+}
+
+static void test_entity_handles()
+{
+    registry_t registry;
+
+    entity_t a = registry.create();
+    registry.add<position_t>(a, 1.f, 2.f);
+    registry.destroy(a);
+
+    entity_t b = registry.create();
+    test::assert(
+        entity_index(b) == entity_index(a)
+        && entity_generation(b) == entity_generation(a) + 1,
+        "slots are recycled with the next generation"
+    );
+    test::assert(
+        !registry.alive(a) && registry.alive(b)
+        && !registry.has<position_t>(b),
+        "stale handles don't refer to the new entity"
+    );
+
+    bool did_throw = false;
+    try
+    {
+        registry.add<position_t>(a, 0.f, 0.f);
+    }
+    catch (const std::exception&)
+    {
+        did_throw = true;
+    }
+    test::assert(did_throw, "stale handles are rejected");
+
+    // a long run of short-lived entities doesn't grow the registry
+    for (usize i = 0; i < 10000; i++)
+    {
+        entity_t e = registry.create();
+        registry.add<velocity_t>(e, 1.f, 1.f);
+        registry.destroy(e);
+    }
+    test::assert(registry.capacity() == 2, "capacity()");
+
+    std::vector<entity_t> entities;
+    for (usize i = 0; i < 10; i++)
+    {
+        entities.push_back(registry.create());
+    }
+    registry.clear();
+    bool all_dead = true;
+    for (auto e : entities)
+    {
+        all_dead = all_dead && !registry.alive(e);
+    }
+    test::assert(
+        all_dead && registry.capacity() == 11
+        && entity_index(registry.create()) == 0,
+        "clear() recycles every slot"
+    );
+    test::assert(null_entity != make_entity(0, 0), "null_entity");
+}
+
+static void test_view()
+{
+    registry_t registry;
+
+    for (usize i = 0; i < 5000; i++)
+    {
+        entity_t e = registry.create();
+        registry.add<position_t>(e, (f32)i, 0.f);
+        if (i % 2 == 0)
+            registry.add<velocity_t>(e, 1.f, 2.f);
+        if (i % 4 == 0)
+            registry.add<name_t>(e, "moving");
+    }
+
+    auto moving = registry.view<position_t, const velocity_t>();
+    test::assert(moving.size() == 2500, "size()");
+
+    // the spans in a chunk must all have the same length
+    usize n_visited = 0;
+    moving.each_chunk(
+        [&n_visited](
+            std::span<const entity_t> entities,
+            std::span<position_t> positions,
+            std::span<const velocity_t> velocities
+            )
+        {
+            test::assert(
+                entities.size() == positions.size()
+                && entities.size() == velocities.size(),
+                "each_chunk() span lengths"
+            );
+            n_visited += entities.size();
+        }
+    );
+    test::assert(n_visited == 2500, "each_chunk() entity count");
+
+    moving.each(
+        [](position_t& pos, const velocity_t& vel)
+        {
+            pos.y += vel.y;
+        }
+    );
+    registry.view<const position_t>().each(
+        [&registry](entity_t e, const position_t& pos)
+        {
+            test::assert(
+                pos.y == (registry.has<velocity_t>(e) ? 2.f : 0.f),
+                "each() writes"
+            );
+        }
+    );
+
+    auto unnamed = registry.view<const velocity_t>().exclude<name_t>();
+    test::assert(unnamed.size() == 1250, "exclude()");
+}
+
+static usize count_changed_chunks(
+    const registry_t& registry,
+    u64 since,
+    usize& out_first_offset
+)
+{
+    usize n_chunks = 0;
+    out_first_offset = ~(usize)0;
+    registry.view<const position_t>().changed_since(since).each_chunk(
+        [&](
+            usize offset,
+            std::span<const entity_t> entities,
+            std::span<const position_t> positions
+            )
+        {
+            n_chunks++;
+            out_first_offset = std::min(out_first_offset, offset);
+        }
+    );
+    return n_chunks;
+}
+
+// writes to a position in every third iteration
+class position_writer_t : public base_system_t
+{
+public:
+    entity_t entity;
+
+    position_writer_t(const std::string& name, entity_t entity)
+        : base_system_t(name, execution_scheme_t(0)),
+        entity(entity)
+    {
+        declare_write<position_t>();
+    }
+
+    virtual void on_update(world_t& world, const iteration_t& iter) override
+    {
+        if (iter.i % 3 == 0)
+        {
+            world.get_component<position_t>(entity).x += 1;
+        }
+    }
+
+};
+
+// counts the chunks of positions that changed since its last update
+class position_watcher_t : public base_system_t
+{
+public:
+    std::vector<usize> n_changed;
+
+    position_watcher_t(const std::string& name)
+        : base_system_t(name, execution_scheme_t(1))
+    {
+        declare_read<position_t>();
+    }
+
+    virtual void on_update(world_t& world, const iteration_t& iter) override
+    {
+        usize first_offset;
+        n_changed.push_back(count_changed_chunks(
+            world.get_registry(),
+            iter.last_version,
+            first_offset
+        ));
+        if (iter.i == 8)
+        {
+            world.stop(false);
+        }
+    }
+
+};
+
+static void test_change_detection()
+{
+    registry_t registry;
+
+    std::vector<entity_t> entities;
+    for (usize i = 0; i < 5000; i++)
+    {
+        entity_t e = registry.create();
+        registry.add<position_t>(e, (f32)i, 0.f);
+        entities.push_back(e);
+    }
+    const archetype_t& archetype = *registry.get_archetypes().back();
+    usize n_chunks = archetype.chunk_count();
+    test::assert(n_chunks > 2, "the entities span several chunks");
+
+    usize first_offset;
+    test::assert(
+        count_changed_chunks(registry, 0, first_offset) == n_chunks,
+        "every chunk is newer than version 0"
+    );
+
+    u64 version = registry.next_version();
+    test::assert(
+        count_changed_chunks(registry, version, first_offset) == 0,
+        "nothing changed since the new version"
+    );
+
+    // reading doesn't count as a change
+    const registry_t& const_registry = registry;
+    const_registry.get<position_t>(entities[0]);
+    registry.view<const position_t>().each([](const position_t&) {});
+    test::assert(
+        count_changed_chunks(registry, version, first_offset) == 0,
+        "reads"
+    );
+
+    // a write to an entity in the second chunk
+    usize capacity = archetype.chunk_capacity();
+    registry.get<position_t>(entities[capacity + 1]).y = 1;
+    test::assert(
+        count_changed_chunks(registry, version, first_offset) == 1
+        && first_offset == capacity,
+        "a write changes a single chunk, with its offset"
+    );
+
+    // moving an entity out changes the chunk it leaves and the one it joins
+    version = registry.next_version();
+    registry.add<velocity_t>(entities[0]);
+    test::assert(
+        count_changed_chunks(registry, version, first_offset) == 2
+        && first_offset == 0,
+        "structural changes"
+    );
+
+    // only the chunks of the filtered component types count
+    version = registry.next_version();
+    registry.get<velocity_t>(entities[0]).x = 1;
+    usize n_velocity_changes = 0;
+    registry.view<const position_t>().changed_since<velocity_t>(version)
+        .each_chunk(
+            [&n_velocity_changes](
+                std::span<const entity_t> entities,
+                std::span<const position_t> positions
+                )
+            {
+                n_velocity_changes += entities.size();
+            }
+        );
+    test::assert(
+        n_velocity_changes == 1
+        && count_changed_chunks(registry, version, first_offset) == 0,
+        "changed_since<Us...>()"
+    );
+
+    // mutable views change every chunk they give out
+    registry.view<position_t>().each([](position_t&) {});
+    test::assert(
+        count_changed_chunks(registry, version, first_offset) == n_chunks + 1,
+        "mutable views"
+    );
+
+    // a system sees the changes made since its last update, and again the
+    // ones made in the same group as its last update
+    std::ostringstream log_stream;
+    world_t world(
+        "test",
+        log_level_t::error,
+        std::make_shared<ostream_logger_t>(log_stream)
+    );
+    entity_t watched = 0;
+    registry_t& world_registry = world.get_registry();
+    for (usize i = 0; i < 5000; i++)
+    {
+        entity_t e = world_registry.create();
+        world_registry.add<position_t>(e);
+        if (i == 0)
+        {
+            watched = e;
+        }
+    }
+    auto watcher = std::make_shared<position_watcher_t>("watcher");
+    world.add_system(std::make_shared<position_writer_t>("writer", watched));
+    world.add_system(watcher);
+    world.run();
+
+    usize n_world_chunks =
+        count_changed_chunks(world_registry, 0, first_offset);
+    test::assert(
+        watcher->n_changed == std::vector<usize>{
+            n_world_chunks, 1, 0, 1, 1, 0, 1, 1, 0
+        },
+        "iteration_t::last_version"
+    );
+
+    // reading through a const world doesn't count as a change, while
+    // getting mutable access does
+    version = world_registry.next_version();
+    const world_t& const_world = world;
+    const_world.get_component<position_t>(watched);
+    const_world.try_get_component<position_t>(watched);
+    test::assert(
+        count_changed_chunks(world_registry, version, first_offset) == 0,
+        "const get_component()"
+    );
+    world.get_component<position_t>(watched);
+    test::assert(
+        count_changed_chunks(world_registry, version, first_offset) == 1,
+        "mutable get_component()"
+    );
+}
+
+class counter_system_t : public base_system_t
+{
+public:
+    std::atomic<u64>& n_updates;
+    u64 max_iterations;
+
+    counter_system_t(
+        const std::string& name,
+        const execution_scheme_t& exec_scheme,
+        std::atomic<u64>& n_updates,
+        u64 max_iterations = 0
+    )
+        : base_system_t(name, exec_scheme),
+        n_updates(n_updates),
+        max_iterations(max_iterations)
+    {}
+
+    virtual void on_update(world_t& world, const iteration_t& iter) override
+    {
+        n_updates++;
+        if (max_iterations > 0 && iter.i + 1 >= max_iterations)
+        {
+            world.stop(false);
+        }
+    }
+
+};
+
+static void test_world()
+{
+    std::ostringstream log_stream;
+    world_t world(
+        "test",
+        log_level_t::error,
+        std::make_shared<ostream_logger_t>(log_stream)
+    );
+
+    // several systems per update order so that they run on the pool
+    std::atomic<u64> n_updates = 0;
+    for (i32 order = 0; order < 3; order++)
+    {
+        for (usize i = 0; i < 4; i++)
+        {
+            world.add_system(std::make_shared<counter_system_t>(
+                std::format("counter {} {}", order, i),
+                execution_scheme_t(order),
+                n_updates
+            ));
+        }
+    }
+    world.add_system(std::make_shared<counter_system_t>(
+        "stopper",
+        execution_scheme_t(3, true),
+        n_updates,
+        100
+    ));
+
+    // run twice to make sure the world can be reused
+    world.run();
+    test::assert(n_updates == 100 * 13, "first run");
+    world.run();
+    test::assert(n_updates == 2 * 100 * 13, "second run");
+    test::assert(log_stream.str().empty(), "no errors were logged");
+}
+
+// counts its updates and checks that every system it depends on has already
+// been updated in the same iteration
+class graph_system_t : public base_system_t
+{
+public:
+    std::atomic<u64> n_updates = 0;
+    std::vector<const graph_system_t*> dependencies;
+    std::atomic<bool>& out_failed;
+
+    graph_system_t(
+        const std::string& name,
+        const execution_scheme_t& exec_scheme,
+        std::atomic<bool>& out_failed
+    )
+        : base_system_t(name, exec_scheme),
+        out_failed(out_failed)
+    {}
+
+    virtual void on_update(world_t& world, const iteration_t& iter) override
+    {
+        for (auto dependency : dependencies)
+        {
+            if (dependency->n_updates.load() != iter.i + 1)
+            {
+                out_failed = true;
+            }
+        }
+        n_updates++;
+    }
+
+};
+
+static void test_system_graph()
+{
+    std::atomic<bool> failed = false;
+    std::atomic<u64> n_stopper_updates = 0;
+
+    auto writer = std::make_shared<graph_system_t>(
+        "writer", execution_scheme_t(0), failed
+    );
+    writer->declare_write<position_t>();
+
+    auto reader = std::make_shared<graph_system_t>(
+        "reader", execution_scheme_t(1), failed
+    );
+    reader->declare_read<position_t>();
+    reader->declare_write<velocity_t>();
+    reader->dependencies.push_back(writer.get());
+
+    auto other_reader = std::make_shared<graph_system_t>(
+        "other reader", execution_scheme_t(1, true), failed
+    );
+    other_reader->declare_read<position_t>();
+    other_reader->dependencies.push_back(writer.get());
+
+    auto independent = std::make_shared<graph_system_t>(
+        "independent", execution_scheme_t(2), failed
+    );
+    independent->declare_write<name_t>();
+
+    auto last = std::make_shared<graph_system_t>(
+        "last", execution_scheme_t(3), failed
+    );
+    last->declare_read<velocity_t>();
+    last->dependencies.push_back(reader.get());
+
+    test::assert(writer->conflicts_with(*reader), "write/read conflict");
+    test::assert(
+        !reader->conflicts_with(*other_reader),
+        "read/read doesn't conflict"
+    );
+    test::assert(
+        !independent->conflicts_with(*writer),
+        "disjoint types don't conflict"
+    );
+    test::assert(
+        writer->conflicts_with(counter_system_t(
+            "undeclared", execution_scheme_t(0), n_stopper_updates
+        )),
+        "undeclared access conflicts with everything"
+    );
+
+    std::ostringstream log_stream;
+    world_t world(
+        "test",
+        log_level_t::error,
+        std::make_shared<ostream_logger_t>(log_stream)
+    );
+    for (auto& system : { writer, reader, other_reader, independent, last })
+    {
+        world.add_system(system);
+    }
+    world.add_system(std::make_shared<counter_system_t>(
+        "stopper",
+        execution_scheme_t(4),
+        n_stopper_updates,
+        200
+    ));
+
+    world.run();
+    test::assert(!failed, "dependencies were updated first");
+    test::assert(
+        writer->n_updates == 200 && last->n_updates == 200
+        && independent->n_updates == 200 && n_stopper_updates == 200,
+        "every system was updated in every iteration"
+    );
+    test::assert(log_stream.str().empty(), "no errors were logged");
+}
+
+// sums the payloads of the events it's triggered by, and enqueues a follow-up
+// event for each one from inside on_trigger()
+class event_system_t : public base_system_t
+{
+public:
+    static constexpr event_type_t event_value = 1;
+    static constexpr event_type_t event_follow_up = 2;
+
+    u64 sum = 0;
+    u64 n_follow_ups = 0;
+
+    event_system_t()
+        : base_system_t("events", execution_scheme_t(0))
+    {
+        triggers.insert(event_value);
+        triggers.insert(event_follow_up);
+    }
+
+    virtual void on_trigger(
+        world_t& world,
+        const iteration_t& iter,
+        const event_t& event
+    ) override
+    {
+        if (event.type == event_value)
+        {
+            sum += std::any_cast<u64>(event.data);
+            world.emplace_event(event_follow_up, std::any());
+        }
+        else
+        {
+            n_follow_ups++;
+        }
+    }
+
+    virtual void on_update(world_t& world, const iteration_t& iter) override
+    {
+        world.stop(false);
+    }
+
+};
+
+// counts the batches and events it's triggered with
+class batch_system_t : public base_system_t
+{
+public:
+    usize n_batches = 0;
+    usize n_events = 0;
+    bool in_order = true;
+
+    batch_system_t()
+        : base_system_t("batches", execution_scheme_t(0))
+    {
+        triggers.insert(event_system_t::event_value);
+        declare_read<name_t>();
+    }
+
+    virtual void on_trigger_batch(
+        world_t& world,
+        const iteration_t& iter,
+        std::span<const event_t> events
+    ) override
+    {
+        n_batches++;
+        n_events += events.size();
+
+        // every producer's values must arrive in increasing order
+        for (usize i = 1; i < events.size(); i++)
+        {
+            u64 prev = std::any_cast<u64>(events[i - 1].data);
+            u64 curr = std::any_cast<u64>(events[i].data);
+            if ((prev - 1) / 250 == (curr - 1) / 250 && prev > curr)
+            {
+                in_order = false;
+            }
+        }
+    }
+
+};
+
+static void test_events()
+{
+    std::ostringstream log_stream;
+    world_t world(
+        "test",
+        log_level_t::error,
+        std::make_shared<ostream_logger_t>(log_stream)
+    );
+    auto system = std::make_shared<event_system_t>();
+    world.add_system(system);
+    auto batches = std::make_shared<batch_system_t>();
+    world.add_system(batches);
+
+    // enqueue from several threads at once
+    {
+        std::vector<std::jthread> producers;
+        for (u64 p = 0; p < 4; p++)
+        {
+            producers.emplace_back(
+                [&world, p]()
+                {
+                    for (u64 i = 1; i <= 250; i++)
+                    {
+                        world.emplace_event(
+                            event_system_t::event_value,
+                            std::in_place_type<u64>,
+                            p * 250 + i
+                        );
+                    }
+                }
+            );
+        }
+    }
+
+    world.run();
+    test::assert(system->sum == 500500, "every event was processed");
+    test::assert(
+        system->n_follow_ups == 1000,
+        "events enqueued by triggers were processed"
+    );
+    test::assert(
+        batches->n_batches == 1 && batches->n_events == 1000,
+        "events were batched"
+    );
+    test::assert(batches->in_order, "batches keep the enqueue order");
+    test::assert(log_stream.str().empty(), "no errors were logged");
+}
+
+struct collision_t
+{
+    entity_t a;
+    entity_t b;
+    f32 impulse;
+};
+
+struct hit_t
+{
+    entity_t target;
+};
+
+// receives collisions and emits a hit for each one from inside the handler
+class collision_system_t
+    : public base_system_t,
+    public event_handler_t<collision_t>,
+    public event_handler_t<hit_t>
+{
+public:
+    usize n_collisions = 0;
+    usize n_batches = 0;
+    f32 total_impulse = 0;
+    usize n_hits = 0;
+
+    // the number of collisions received from every emitter, by a
+    std::vector<u32> n_by_emitter;
+    bool is_ordered = true;
+
+    collision_system_t()
+        : base_system_t("collisions", execution_scheme_t(0))
+    {
+        subscribe<collision_t>(this);
+        subscribe<hit_t>(this);
+    }
+
+    virtual void on_event(
+        world_t& world,
+        const iteration_t& iter,
+        std::span<const collision_t> collisions
+    ) override
+    {
+        n_batches++;
+        for (auto& collision : collisions)
+        {
+            n_collisions++;
+            total_impulse += collision.impulse;
+            if (collision.a >= n_by_emitter.size())
+            {
+                n_by_emitter.resize(collision.a + 1, 0);
+            }
+            is_ordered = is_ordered
+                && collision.b == n_by_emitter[collision.a]++;
+            world.emit<hit_t>(collision.b);
+        }
+    }
+
+    virtual void on_event(
+        world_t& world,
+        const iteration_t& iter,
+        std::span<const hit_t> hits
+    ) override
+    {
+        n_hits += hits.size();
+    }
+
+    virtual void on_update(world_t& world, const iteration_t& iter) override
+    {
+        if (iter.i >= 1)
+        {
+            world.stop(false);
+        }
+    }
+
+};
+
+static void test_typed_events()
+{
+    std::ostringstream log_stream;
+    world_t world(
+        "test",
+        log_level_t::error,
+        std::make_shared<ostream_logger_t>(log_stream)
+    );
+    auto system = std::make_shared<collision_system_t>();
+    world.add_system(system);
+
+    {
+        std::vector<std::jthread> producers;
+        for (u32 p = 0; p < 4; p++)
+        {
+            producers.emplace_back(
+                [&world, p]()
+                {
+                    for (u32 i = 0; i < 500; i++)
+                    {
+                        world.emit<collision_t>(p, i, 1.f);
+                    }
+                }
+            );
+        }
+    }
+
+    world.run();
+    test::assert(
+        system->n_collisions == 2000 && system->total_impulse == 2000.f,
+        "every typed event was delivered"
+    );
+    test::assert(system->n_batches == 1, "typed events were batched");
+    test::assert(
+        system->is_ordered,
+        "typed events of a thread keep the order they were emitted in"
+    );
+    test::assert(
+        system->n_hits == 2000,
+        "typed events emitted by handlers were delivered"
+    );
+
+    // the thread emits to a world created where another one was destroyed
+    bool did_deliver = true;
+    std::optional<world_t> other;
+    for (u32 w = 0; w < 2; w++)
+    {
+        other.emplace(
+            "other",
+            log_level_t::error,
+            std::make_shared<ostream_logger_t>(log_stream)
+        );
+        auto other_system = std::make_shared<collision_system_t>();
+        other->add_system(other_system);
+        other->emit<collision_t>(0u, w, 1.f);
+        other->run();
+        did_deliver = did_deliver && other_system->n_collisions == 1;
+    }
+    test::assert(
+        did_deliver,
+        "typed events are delivered to a world that replaced another one"
+    );
+    test::assert(log_stream.str().empty(), "no errors were logged");
+}
+
+// sleeps in every update so that it takes a known minimum time
+class sleeping_system_t : public base_system_t
+{
+public:
+    sleeping_system_t()
+        : base_system_t("sleeper", execution_scheme_t(0))
+    {
+        triggers.insert(7);
+    }
+
+    virtual void on_trigger(
+        world_t& world,
+        const iteration_t& iter,
+        const event_t& event
+    ) override
+    {}
+
+    virtual void on_update(world_t& world, const iteration_t& iter) override
+    {
+        misc::sleep(.001);
+    }
+
+};
+
+static void test_profiler()
+{
+    std::ostringstream log_stream;
+    world_t world(
+        "test",
+        log_level_t::error,
+        std::make_shared<ostream_logger_t>(log_stream)
+    );
+    std::atomic<u64> n_updates = 0;
+    world.add_system(std::make_shared<sleeping_system_t>());
+    world.add_system(std::make_shared<counter_system_t>(
+        "stopper",
+        execution_scheme_t(1),
+        n_updates,
+        300
+    ));
+
+    world.enqueue_event(event_t(7, std::any()));
+    world.run();
+
+    auto update = world.get_profiler().get_stats(
+        "sleeper",
+        profile_phase_t::update
+    );
+    test::assert(
+        update && update->n_samples == profile_ring_t::capacity,
+        "the ring keeps the most recent samples"
+    );
+    if (!update)
+        return;
+    test::assert(
+        update->wall_time.min >= .001
+        && update->wall_time.min <= update->wall_time.mean
+        && update->wall_time.mean <= update->wall_time.max
+        && update->wall_time.p99 <= update->wall_time.max,
+        "wall time statistics"
+    );
+    test::assert(
+        update->cpu_time.mean < update->wall_time.mean,
+        "sleeping doesn't count as CPU time"
+    );
+
+    auto trigger = world.get_profiler().get_stats(
+        "sleeper",
+        profile_phase_t::trigger
+    );
+    test::assert(trigger && trigger->n_samples == 1, "trigger phase");
+    test::assert(
+        world.get_profiler().get_stats().size() == 3,
+        "phases without samples are skipped"
+    );
+
+    world.get_profiler().set_enabled(false);
+    n_updates = 0;
+    world.run();
+    test::assert(
+        !world.get_profiler().get_stats("sleeper", profile_phase_t::update),
+        "nothing is recorded when disabled"
+    );
+}
+
+static void test_trace()
+{
+    const std::string filename = "test_trace.json";
+
+    std::ostringstream log_stream;
+    world_t world(
+        "test \"trace\"",
+        log_level_t::error,
+        std::make_shared<ostream_logger_t>(log_stream)
+    );
+    std::atomic<u64> n_updates = 0;
+    world.add_system(std::make_shared<sleeping_system_t>());
+    world.add_system(std::make_shared<counter_system_t>(
+        "stopper",
+        execution_scheme_t(1),
+        n_updates,
+        10
+    ));
+
+    world.get_tracer().set_output(filename);
+    world.enqueue_event(event_t(7, std::any()));
+    world.run(1000.);
+
+    std::string trace;
+    {
+        std::ifstream trace_file(filename);
+        std::ostringstream stream;
+        stream << trace_file.rdbuf();
+        trace = stream.str();
+    }
+    test::assert(
+        trace.starts_with("[") && trace.ends_with("]\n"),
+        "the trace is a JSON array"
+    );
+
+    // the world thread and one worker per hardware thread
+    usize n_threads = std::max(1u, std::thread::hardware_concurrency());
+
+    auto count = [&trace](const std::string& s)
+    {
+        usize n = 0;
+        for (usize pos = trace.find(s); pos != std::string::npos;
+            pos = trace.find(s, pos + 1))
+        {
+            n++;
+        }
+        return n;
+    };
+    test::assert(
+        count("{\"name\":\"sleeper\",\"cat\":\"update\"") == 10
+        && count("{\"name\":\"stopper\",\"cat\":\"update\"") == 10,
+        "every system update was traced"
+    );
+    test::assert(
+        count("{\"name\":\"sleeper\",\"cat\":\"trigger\"") == 1,
+        "event dispatch was traced"
+    );
+    test::assert(
+        count("\"name\":\"iteration\"") == 10,
+        "every iteration was traced"
+    );
+    test::assert(
+        count("\"thread_name\"") == n_threads + 1
+        && count("\"name\":\"test \\\"trace\\\"\"") == 1,
+        "threads and the process are named"
+    );
+
+    std::filesystem::remove(filename);
+
+    // tracing is off without an output
+    world.get_tracer().set_output("");
+    n_updates = 0;
+    world.run();
+    test::assert(!std::filesystem::exists(filename), "tracing is optional");
+}
+
+// checks the iterations that a fixed-step system is updated with
+class fixed_step_system_t : public base_system_t
+{
+public:
+    f64 step;
+    u64 n_updates = 0;
+    bool failed = false;
+
+    fixed_step_system_t(f64 step)
+        : base_system_t("fixed", execution_scheme_t(1, false, true)),
+        step(step)
+    {}
+
+    virtual void on_update(world_t& world, const iteration_t& iter) override
+    {
+        if (iter.dt != step
+            || iter.step != n_updates
+            || std::abs(iter.time - (f64)n_updates * step) > 1e-9)
+        {
+            failed = true;
+        }
+        n_updates++;
+    }
+
+};
+
+// checks the iterations that a system updated once per iteration is updated
+// with when the world has a fixed timestep
+class variable_step_system_t : public base_system_t
+{
+public:
+    fixed_step_system_t& fixed;
+    u64 max_iterations;
+    f64 sleep_time;
+    u64 max_steps_per_iteration = 0;
+    bool failed = false;
+
+    variable_step_system_t(
+        fixed_step_system_t& fixed,
+        u64 max_iterations,
+        f64 sleep_time
+    )
+        // a lower update order than the fixed-step system, which is still
+        // updated first
+        : base_system_t("variable", execution_scheme_t(0)),
+        fixed(fixed),
+        max_iterations(max_iterations),
+        sleep_time(sleep_time)
+    {}
+
+    virtual void on_update(world_t& world, const iteration_t& iter) override
+    {
+        if (iter.alpha < 0 || iter.alpha >= 1 || iter.step != fixed.n_updates)
+        {
+            failed = true;
+        }
+        max_steps_per_iteration = std::max(
+            max_steps_per_iteration,
+            iter.step - prev_step
+        );
+        prev_step = iter.step;
+
+        misc::sleep(sleep_time);
+        if (iter.i + 1 >= max_iterations)
+        {
+            world.stop(false);
+        }
+    }
+
+private:
+    u64 prev_step = 0;
+
+};
+
+static void test_fixed_timestep()
+{
+    std::ostringstream log_stream;
+    world_t world(
+        "test",
+        log_level_t::error,
+        std::make_shared<ostream_logger_t>(log_stream)
+    );
+    const f64 step = .002;
+    auto fixed = std::make_shared<fixed_step_system_t>(step);
+    auto variable = std::make_shared<variable_step_system_t>(*fixed, 20, .01);
+    world.add_system(fixed);
+    world.add_system(variable);
+
+    world.set_fixed_timestep(step, 3);
+    world.run();
+
+    test::assert(!fixed->failed, "fixed steps have a constant dt");
+    test::assert(
+        !variable->failed,
+        "fixed steps come first, and alpha is between 0 and 1"
+    );
+    test::assert(
+        fixed->n_updates > 0 && variable->max_steps_per_iteration == 3,
+        "the number of steps per iteration is capped"
+    );
+
+    // without a fixed timestep, every system is updated once per iteration
+    world.set_fixed_timestep(0);
+    fixed->n_updates = 0;
+    fixed->step = 0;
+    variable->sleep_time = 0;
+    world.run();
+    test::assert(fixed->n_updates == 20, "fixed timestep disabled");
+}
+
+// records when it's updated
+class tick_system_t : public base_system_t
+{
+public:
+    std::vector<u64> iterations;
+    std::vector<f64> times;
+
+    tick_system_t(const std::string& name, const execution_scheme_t& scheme)
+        : base_system_t(name, scheme)
+    {}
+
+    virtual void on_update(world_t& world, const iteration_t& iter) override
+    {
+        iterations.push_back(iter.i);
+        times.push_back(iter.time);
+    }
+
+};
+
+static void test_multi_rate()
+{
+    std::ostringstream log_stream;
+    world_t world(
+        "test",
+        log_level_t::error,
+        std::make_shared<ostream_logger_t>(log_stream)
+    );
+
+    execution_scheme_t every_4th(0);
+    every_4th.tick_divisor = 4;
+    auto first = std::make_shared<tick_system_t>("first", every_4th);
+    auto second = std::make_shared<tick_system_t>("second", every_4th);
+
+    execution_scheme_t at_50_hz(0);
+    at_50_hz.tick_rate = 50;
+    auto slow = std::make_shared<tick_system_t>("slow", at_50_hz);
+
+    std::atomic<u64> n_updates = 0;
+    world.add_system(first);
+    world.add_system(second);
+    world.add_system(slow);
+    world.add_system(std::make_shared<counter_system_t>(
+        "stopper",
+        execution_scheme_t(1),
+        n_updates,
+        40
+    ));
+    world.run(200.);
+
+    bool first_ok = first->iterations.size() == 10;
+    bool second_ok = second->iterations.size() == 10;
+    for (auto i : first->iterations)
+    {
+        first_ok = first_ok && (i % 4 == 0);
+    }
+    for (auto i : second->iterations)
+    {
+        second_ok = second_ok && (i % 4 == 1);
+    }
+    test::assert(
+        first_ok && second_ok,
+        "systems with the same divisor are updated in different iterations"
+    );
+    test::assert(n_updates == 40, "other systems are updated every iteration");
+
+    // the k-th tick can't come before k periods have passed
+    bool slow_ok = !slow->iterations.empty()
+        && slow->iterations.size() < 40;
+    for (usize k = 0; k < slow->times.size(); k++)
+    {
+        slow_ok = slow_ok && slow->times[k] >= (f64)k / 50. - 1e-9;
+    }
+    test::assert(slow_ok, "tick rate");
+}
+
+static void test_schedule_cache()
+{
+    auto count = [](const std::string& text, const std::string& s)
+    {
+        usize n = 0;
+        for (usize pos = text.find(s); pos != std::string::npos;
+            pos = text.find(s, pos + 1))
+        {
+            n++;
+        }
+        return n;
+    };
+
+    auto pool = std::make_shared<misc::thread_pool_t>(2);
+    std::ostringstream log_stream;
+    world_t world(
+        "test",
+        log_level_t::info,
+        std::make_shared<ostream_logger_t>(log_stream),
+        pool
+    );
+    std::atomic<u64> n_updates = 0;
+    world.add_system(std::make_shared<counter_system_t>(
+        "stopper",
+        execution_scheme_t(0),
+        n_updates,
+        5
+    ));
+
+    for (usize i = 0; i < 3; i++)
+    {
+        world.run();
+    }
+    test::assert(n_updates == 15, "every run updates the systems");
+    test::assert(
+        count(log_stream.str(), "preparing the schedule") == 1,
+        "the schedule is reused"
+    );
+
+    world.add_system(std::make_shared<counter_system_t>(
+        "counter",
+        execution_scheme_t(1),
+        n_updates
+    ));
+    world.run();
+    world.invalidate_schedule();
+    world.run();
+    test::assert(n_updates == 15 + 2 * 10, "added systems are updated");
+    test::assert(
+        count(log_stream.str(), "preparing the schedule") == 3,
+        "changes invalidate the schedule"
+    );
+
+    // worlds can share a pool
+    world_t other(
+        "other",
+        log_level_t::info,
+        std::make_shared<ostream_logger_t>(log_stream),
+        pool
+    );
+    other.add_system(std::make_shared<counter_system_t>(
+        "stopper",
+        execution_scheme_t(0),
+        n_updates,
+        5
+    ));
+    other.run();
+    test::assert(
+        count(log_stream.str(), "created a thread pool") == 0,
+        "the shared pool is used"
+    );
+
+    // worlds sharing a pool can run at the same time, while tracing and
+    // profiling their own threads
+    std::atomic<u64> n_shared_updates = 0;
+    std::ostringstream shared_log_streams[2];
+    std::vector<std::unique_ptr<world_t>> shared_worlds;
+    for (usize w = 0; w < 2; w++)
+    {
+        shared_worlds.push_back(std::make_unique<world_t>(
+            "shared " + std::to_string(w),
+            log_level_t::error,
+            std::make_shared<ostream_logger_t>(shared_log_streams[w]),
+            pool
+        ));
+        for (usize i = 0; i < 4; i++)
+        {
+            auto system = std::make_shared<counter_system_t>(
+                "counter " + std::to_string(i),
+                execution_scheme_t(0),
+                n_shared_updates,
+                50
+            );
+            system->declare_read<position_t>();
+            shared_worlds[w]->add_system(system);
+        }
+        shared_worlds[w]->get_tracer().set_output(
+            "test_shared_pool_" + std::to_string(w) + ".json"
+        );
+    }
+    {
+        std::vector<std::jthread> runners;
+        for (auto& shared_world : shared_worlds)
+        {
+            runners.emplace_back(
+                [&shared_world]()
+                {
+                    shared_world->run();
+                }
+            );
+        }
+    }
+    test::assert(
+        n_shared_updates == 2 * 4 * 50,
+        "worlds sharing a pool run at the same time"
+    );
+    for (usize w = 0; w < 2; w++)
+    {
+        shared_worlds[w]->get_tracer().set_output("");
+        std::filesystem::remove(
+            "test_shared_pool_" + std::to_string(w) + ".json"
+        );
+    }
+}
+
+// records when it's started, updated and stopped, and calls a function on
+// every update
+class lifecycle_system_t : public base_system_t
+{
+public:
+    u64 n_starts = 0;
+    u64 n_stops = 0;
+    std::vector<u64> iterations;
+    std::function<void(world_t&, const iteration_t&)> on_iteration;
+
+    lifecycle_system_t(
+        const std::string& name,
+        const execution_scheme_t& scheme
+    )
+        : base_system_t(name, scheme)
+    {}
+
+    virtual void on_start(world_t& world) override
+    {
+        n_starts++;
+    }
+
+    virtual void on_update(world_t& world, const iteration_t& iter) override
+    {
+        iterations.push_back(iter.i);
+        if (on_iteration)
+        {
+            on_iteration(world, iter);
+        }
+    }
+
+    virtual void on_stop(world_t& world, const iteration_t& iter) override
+    {
+        n_stops++;
+    }
+
+};
+
+static void test_hot_swap()
+{
+    std::ostringstream log_stream;
+    world_t world(
+        "test",
+        log_level_t::error,
+        std::make_shared<ostream_logger_t>(log_stream)
+    );
+
+    auto kept = std::make_shared<lifecycle_system_t>(
+        "kept",
+        execution_scheme_t(0)
+    );
+    auto old_module = std::make_shared<lifecycle_system_t>(
+        "module",
+        execution_scheme_t(1)
+    );
+    auto new_module = std::make_shared<lifecycle_system_t>(
+        "module",
+        execution_scheme_t(1)
+    );
+
+    // swap the module while running, from a worker thread
+    kept->on_iteration = [&new_module](world_t& world, const iteration_t& iter)
+    {
+        if (iter.i == 3)
+        {
+            world.remove_all_systems_named("module");
+            world.add_system(new_module);
+        }
+        if (iter.i == 9)
+        {
+            world.stop(false);
+        }
+    };
+
+    world.add_system(kept);
+    world.add_system(old_module);
+    world.run();
+
+    test::assert(
+        kept->n_starts == 1 && kept->n_stops == 1
+        && kept->iterations.size() == 10,
+        "the other systems keep running"
+    );
+    test::assert(
+        old_module->n_stops == 1
+        && old_module->iterations == std::vector<u64>{ 0, 1, 2, 3 },
+        "removed systems are stopped at the start of the next iteration"
+    );
+    test::assert(
+        new_module->n_starts == 1 && new_module->n_stops == 1
+        && new_module->iterations == std::vector<u64>{ 4, 5, 6, 7, 8, 9 },
+        "added systems are started at the start of the next iteration"
+    );
+    test::assert(
+        world.get_systems().size() == 2
+        && world.get_system_named("module") == new_module,
+        "the changes are applied to the system list"
+    );
+
+    auto stats = world.get_profiler().get_stats(
+        "module",
+        profile_phase_t::update
+    );
+    test::assert(
+        stats && stats->n_samples == 6,
+        "added systems get a profile of their own"
+    );
+}
+
+// run a world whose systems record structural changes in parallel, and get
+// the entities with velocities along with their velocities
+static void run_command_world(
+    std::vector<std::tuple<entity_t, f32, f32>>& out_velocities,
+    usize& out_n_positions,
+    bool& out_did_defer,
+    bool& out_did_set
+)
+{
+    std::ostringstream log_stream;
+    world_t world(
+        "test",
+        log_level_t::error,
+        std::make_shared<ostream_logger_t>(log_stream),
+        std::make_shared<misc::thread_pool_t>(4)
+    );
+    for (usize i = 0; i < 100; i++)
+    {
+        world.add_component<position_t>(world.create_entity(), (f32)i, 0.f);
+    }
+
+    auto spawner = std::make_shared<lifecycle_system_t>(
+        "spawner",
+        execution_scheme_t(0)
+    );
+    spawner->declare_write<velocity_t>();
+    spawner->on_iteration = [&out_did_defer](
+        world_t& world,
+        const iteration_t& iter
+        )
+    {
+        // the entities spawned in this iteration don't exist yet
+        if (world.view<velocity_t>().size() != 64 * iter.i)
+        {
+            out_did_defer = false;
+        }
+
+        world.parallel_for(
+            0,
+            64,
+            4,
+            [&world, &iter](usize begin, usize end)
+            {
+                auto& commands = world.get_commands();
+                for (usize i = begin; i < end; i++)
+                {
+                    auto entity = commands.create();
+                    commands.add<velocity_t>(entity, (f32)i, (f32)iter.i);
+                }
+            }
+        );
+        if (iter.i == 2)
+        {
+            world.stop(false);
+        }
+    };
+
+    // destroys the entities at even positions
+    auto destroyer = std::make_shared<lifecycle_system_t>(
+        "destroyer",
+        execution_scheme_t(0)
+    );
+    destroyer->declare_read<position_t>();
+    destroyer->on_iteration = [](world_t& world, const iteration_t& iter)
+    {
+        if (iter.i != 0)
+            return;
+
+        world.view<const position_t>().each(
+            [&world](entity_t entity, const position_t& pos)
+            {
+                if ((u32)pos.x % 2 == 0)
+                {
+                    world.get_commands().destroy(entity);
+                }
+            }
+        );
+    };
+
+    // sets every position after the destroyer, and destroys some of the
+    // entities again
+    auto setter = std::make_shared<lifecycle_system_t>(
+        "setter",
+        execution_scheme_t(1)
+    );
+    setter->declare_write<position_t>();
+    setter->on_iteration = [](world_t& world, const iteration_t& iter)
+    {
+        if (iter.i != 0)
+            return;
+
+        world.view<position_t>().each(
+            [&world](entity_t entity, position_t& pos)
+            {
+                auto& commands = world.get_commands();
+                commands.set<position_t>(entity, pos.x, 1.f);
+                if ((u32)pos.x % 4 == 0)
+                {
+                    commands.destroy(entity);
+                }
+            }
+        );
+    };
+
+    world.add_system(spawner);
+    world.add_system(destroyer);
+    world.add_system(setter);
+    world.run();
+
+    world.view<velocity_t>().each(
+        [&out_velocities](entity_t entity, velocity_t& vel)
+        {
+            out_velocities.emplace_back(entity, vel.x, vel.y);
+        }
+    );
+    out_n_positions = world.view<position_t>().size();
+    world.view<position_t>().each(
+        [&out_did_set](position_t& pos)
+        {
+            if (pos.y != 1.f)
+            {
+                out_did_set = false;
+            }
+        }
+    );
+}
+
+// which system recorded an entity
+struct marker_t
+{
+    u32 system;
+};
+
+// throws when a value is moved into it
+struct unsettable_t
+{
+    unsettable_t() = default;
+    unsettable_t(unsettable_t&& other) = default;
+
+    unsettable_t& operator=(unsettable_t&& other)
+    {
+        throw std::runtime_error("can't be set");
+    }
+};
+
+// run a world where a system records a command after a parallel_for(),
+// while the thread waiting for the parallel_for() may run the jobs of the
+// other systems in the group, and check that the markers of every
+// iteration are created in the order of the systems
+static bool run_keyed_world()
+{
+    std::ostringstream log_stream;
+    world_t world(
+        "test",
+        log_level_t::error,
+        std::make_shared<ostream_logger_t>(log_stream),
+        std::make_shared<misc::thread_pool_t>(2)
+    );
+
+    const u32 n_systems = 8;
+    for (u32 s = 0; s < n_systems; s++)
+    {
+        auto system = std::make_shared<lifecycle_system_t>(
+            "system " + std::to_string(s),
+            execution_scheme_t(0)
+        );
+        system->declare_read<position_t>();
+        system->on_iteration = [s](world_t& world, const iteration_t& iter)
+        {
+            if (s == 0)
+            {
+                world.parallel_for(
+                    0,
+                    16,
+                    1,
+                    [](usize begin, usize end)
+                    {
+                        std::this_thread::sleep_for(
+                            std::chrono::microseconds(100)
+                        );
+                    }
+                );
+            }
+            else
+            {
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+            }
+
+            auto& commands = world.get_commands();
+            commands.add<marker_t>(commands.create(), s);
+            if (s == 0 && iter.i == 19)
+            {
+                world.stop(false);
+            }
+        };
+        world.add_system(system);
+    }
+    world.run();
+
+    std::vector<u32> order;
+    world.view<const marker_t>().each(
+        [&order](const marker_t& marker)
+        {
+            order.push_back(marker.system);
+        }
+    );
+    bool is_ordered = order.size() == 20 * n_systems;
+    for (usize i = 0; i < order.size() && is_ordered; i++)
+    {
+        is_ordered = order[i] == i % n_systems;
+    }
+    return is_ordered;
+}
+
+// run a world where a system adds markers in the ranges of a parallel_for()
+// and sets or removes them after the loop, and check that the changes are
+// made in the order the system recorded them
+static bool run_loop_order_world()
+{
+    std::ostringstream log_stream;
+    world_t world(
+        "test",
+        log_level_t::error,
+        std::make_shared<ostream_logger_t>(log_stream),
+        std::make_shared<misc::thread_pool_t>(2)
+    );
+    std::vector<entity_t> entities;
+    for (usize i = 0; i < 64; i++)
+    {
+        entities.push_back(world.create_entity());
+        world.add_component<position_t>(entities.back(), (f32)i, 0.f);
+    }
+
+    auto system = std::make_shared<lifecycle_system_t>(
+        "marker",
+        execution_scheme_t(0)
+    );
+    system->declare_read<position_t>();
+    system->on_iteration = [&entities](world_t& world, const iteration_t& iter)
+    {
+        world.parallel_for(
+            0,
+            entities.size(),
+            4,
+            [&world, &entities](usize begin, usize end)
+            {
+                auto& commands = world.get_commands();
+                for (usize i = begin; i < end; i++)
+                {
+                    commands.add<marker_t>(entities[i], 1u);
+                }
+            }
+        );
+
+        auto& commands = world.get_commands();
+        for (usize i = 0; i < entities.size(); i++)
+        {
+            if (i % 2 == 0)
+            {
+                commands.set<marker_t>(entities[i], 2u);
+            }
+            else
+            {
+                commands.remove<marker_t>(entities[i]);
+            }
+        }
+        world.stop(false);
+    };
+    world.add_system(system);
+    world.run();
+
+    bool is_ordered = true;
+    for (usize i = 0; i < entities.size(); i++)
+    {
+        const marker_t* marker =
+            std::as_const(world).try_get_component<marker_t>(entities[i]);
+        is_ordered = is_ordered && ((i % 2 == 0)
+            ? (marker && marker->system == 2)
+            : !marker);
+    }
+    return is_ordered;
+}
+
+// run a world where the ranges of a parallel_for() create entities and add
+// markers in nested loops, and set the markers after the nested loops, and
+// the system sets some of them again after the outer loop. check that the
+// changes are made in the order the system recorded them, and that the
+// entities are created in the order of the ranges.
+static bool run_nested_loop_world()
+{
+    std::ostringstream log_stream;
+    world_t world(
+        "test",
+        log_level_t::error,
+        std::make_shared<ostream_logger_t>(log_stream),
+        std::make_shared<misc::thread_pool_t>(4)
+    );
+    std::vector<entity_t> entities;
+    for (usize i = 0; i < 64; i++)
+    {
+        entities.push_back(world.create_entity());
+        world.add_component<position_t>(entities.back(), (f32)i, 0.f);
+    }
+
+    auto system = std::make_shared<lifecycle_system_t>(
+        "marker",
+        execution_scheme_t(0)
+    );
+    system->declare_read<position_t>();
+    system->on_iteration = [&entities](world_t& world, const iteration_t& iter)
+    {
+        world.parallel_for(
+            0,
+            4,
+            1,
+            [&world, &entities](usize outer_begin, usize outer_end)
+            {
+                const usize begin = outer_begin * 16;
+                const usize end = outer_end * 16;
+                world.parallel_for(
+                    begin,
+                    end,
+                    4,
+                    [&world, &entities](usize begin, usize end)
+                    {
+                        auto& commands = world.get_commands();
+                        for (usize i = begin; i < end; i++)
+                        {
+                            commands.add<marker_t>(entities[i], 1u);
+                            commands.add<marker_t>(
+                                commands.create(),
+                                100u + (u32)i
+                            );
+                        }
+                    }
+                );
+
+                auto& commands = world.get_commands();
+                for (usize i = begin; i < end; i++)
+                {
+                    commands.set<marker_t>(entities[i], 2u);
+                }
+            }
+        );
+
+        auto& commands = world.get_commands();
+        for (usize i = 0; i < entities.size(); i += 2)
+        {
+            commands.set<marker_t>(entities[i], 3u);
+        }
+        world.stop(false);
+    };
+    world.add_system(system);
+    world.run();
+
+    bool is_ordered = true;
+    for (usize i = 0; i < entities.size(); i++)
+    {
+        const marker_t* marker =
+            std::as_const(world).try_get_component<marker_t>(entities[i]);
+        is_ordered = is_ordered
+            && marker
+            && marker->system == ((i % 2 == 0) ? 3u : 2u);
+    }
+
+    std::vector<u32> created;
+    world.view<const marker_t>().each(
+        [&created](const marker_t& marker)
+        {
+            if (marker.system >= 100)
+            {
+                created.push_back(marker.system - 100);
+            }
+        }
+    );
+    is_ordered = is_ordered && created.size() == entities.size();
+    for (usize i = 0; i < created.size() && is_ordered; i++)
+    {
+        is_ordered = created[i] == i;
+    }
+    return is_ordered;
+}
+
+// record commands outside of the systems from two threads, where the thread
+// that asked for its buffer first records last, and check that they're
+// played back in the order they were recorded
+static bool run_external_order_world()
+{
+    std::ostringstream log_stream;
+    world_t world(
+        "test",
+        log_level_t::error,
+        std::make_shared<ostream_logger_t>(log_stream),
+        std::make_shared<misc::thread_pool_t>(2)
+    );
+    entity_t entity = world.create_entity();
+    world.add_component<marker_t>(entity, 0u);
+
+    std::atomic<u32> stage = 0;
+    std::jthread other(
+        [&world, &stage, entity]()
+        {
+            auto& commands = world.get_commands();
+            stage = 1;
+            while (stage != 2)
+            {
+                std::this_thread::yield();
+            }
+            commands.set<marker_t>(entity, 2u);
+        }
+    );
+    while (stage != 1)
+    {
+        std::this_thread::yield();
+    }
+    world.get_commands().set<marker_t>(entity, 1u);
+    stage = 2;
+    other.join();
+
+    auto system = std::make_shared<lifecycle_system_t>(
+        "stopper",
+        execution_scheme_t(0)
+    );
+    system->on_iteration = [](world_t& world, const iteration_t& iter)
+    {
+        world.stop(false);
+    };
+    world.add_system(system);
+    world.run();
+
+    const marker_t* marker =
+        std::as_const(world).try_get_component<marker_t>(entity);
+    return marker && marker->system == 2;
+}
+
+// record the creation of an entity before a run, and check that a system
+// sees it in its first update
+static bool run_setup_world()
+{
+    std::ostringstream log_stream;
+    world_t world(
+        "test",
+        log_level_t::error,
+        std::make_shared<ostream_logger_t>(log_stream),
+        std::make_shared<misc::thread_pool_t>(2)
+    );
+    auto& commands = world.get_commands();
+    commands.add<marker_t>(commands.create(), 1u);
+
+    bool did_see = false;
+    auto system = std::make_shared<lifecycle_system_t>(
+        "checker",
+        execution_scheme_t(0)
+    );
+    system->declare_read<marker_t>();
+    system->on_iteration = [&did_see](world_t& world, const iteration_t& iter)
+    {
+        if (iter.i == 0)
+        {
+            did_see = world.view<const marker_t>().size() == 1;
+        }
+        world.stop(false);
+    };
+    world.add_system(system);
+    world.run();
+    return did_see;
+}
+
+// run a world where a system records a command that throws when it's
+// played back, and check that the run is wrapped up, so that the system
+// list can be changed right away afterwards
+static bool run_throwing_world()
+{
+    std::ostringstream log_stream;
+    world_t world(
+        "test",
+        log_level_t::error,
+        std::make_shared<ostream_logger_t>(log_stream),
+        std::make_shared<misc::thread_pool_t>(2)
+    );
+    entity_t entity = world.create_entity();
+    world.add_component<unsettable_t>(entity);
+
+    auto system = std::make_shared<lifecycle_system_t>(
+        "setter",
+        execution_scheme_t(0)
+    );
+    system->on_iteration = [entity](world_t& world, const iteration_t& iter)
+    {
+        world.get_commands().set<unsettable_t>(entity);
+        world.stop(false);
+    };
+    world.add_system(system);
+
+    bool did_throw = false;
+    try
+    {
+        world.run();
+    }
+    catch (const std::runtime_error&)
+    {
+        did_throw = true;
+    }
+    world.remove_all_systems();
+    return did_throw && world.get_systems().empty();
+}
+
+static void test_command_buffers()
+{
+    std::vector<std::tuple<entity_t, f32, f32>> velocities, other_velocities;
+    usize n_positions, other_n_positions;
+    bool did_defer = true;
+    bool did_set = true;
+    run_command_world(velocities, n_positions, did_defer, did_set);
+    run_command_world(
+        other_velocities,
+        other_n_positions,
+        did_defer,
+        did_set
+    );
+
+    test::assert(did_defer, "changes are deferred until the group ends");
+    test::assert(
+        velocities.size() == 3 * 64,
+        "entities are created with their components"
+    );
+    test::assert(
+        n_positions == 50 && did_set,
+        "commands on destroyed entities are skipped"
+    );
+    test::assert(
+        velocities == other_velocities,
+        "the changes are made in the same order in every run"
+    );
+    test::assert(
+        run_keyed_world(),
+        "commands recorded after a parallel_for() keep their system's key"
+    );
+    test::assert(
+        run_loop_order_world(),
+        "commands recorded after a parallel_for() follow the ones of its "
+        "ranges"
+    );
+    test::assert(
+        run_nested_loop_world(),
+        "commands recorded in nested parallel_for() loops follow the order "
+        "of the loops"
+    );
+    test::assert(
+        run_external_order_world(),
+        "commands recorded outside of the systems keep the order they were "
+        "recorded in"
+    );
+    test::assert(
+        run_setup_world(),
+        "commands recorded before a run are made before the first update"
+    );
+
+    // values that are never played back are destroyed with the buffer
+    auto name = std::make_shared<int>(0);
+    {
+        command_buffer_t commands(0);
+        auto entity = commands.create();
+        commands.add<std::shared_ptr<int>>(entity, name);
+    }
+    test::assert(name.use_count() == 1, "unplayed values are destroyed");
+
+    // a command that throws drops the rest, and none of them are played
+    // back again
+    registry_t registry;
+    entity_t unsettable = registry.create();
+    registry.add<unsettable_t>(unsettable);
+    std::vector<std::unique_ptr<command_buffer_t>> buffers;
+    buffers.push_back(std::make_unique<command_buffer_t>(0));
+    buffers[0]->create();
+    buffers[0]->set<unsettable_t>(unsettable);
+    buffers[0]->create();
+    bool did_throw = false;
+    try
+    {
+        command_buffer_t::play_back(buffers, registry);
+    }
+    catch (const std::runtime_error&)
+    {
+        did_throw = true;
+    }
+    test::assert(
+        did_throw
+        && buffers[0]->size() == 0
+        && command_buffer_t::play_back(buffers, registry) == 0
+        && registry.size() == 2,
+        "commands that throw are dropped"
+    );
+    test::assert(
+        run_throwing_world(),
+        "a run that throws stops running"
+    );
+
+    // pending entities expire when their buffer is played back, rather than
+    // resolving to the entities created later at the same index
+    auto stale = buffers[0]->create();
+    command_buffer_t::play_back(buffers, registry);
+    buffers[0]->add<marker_t>(stale, 1u);
+    buffers[0]->add<marker_t>(buffers[0]->create(), 2u);
+    command_buffer_t::play_back(buffers, registry);
+    usize n_marked = 0;
+    registry.view<const marker_t>().each(
+        [&n_marked](const marker_t& marker)
+        {
+            n_marked += (marker.system == 2) ? 1 : 10;
+        }
+    );
+    test::assert(n_marked == 1, "stale pending entities are skipped");
+}
+
+// mixes random numbers, the time and the events it's triggered with into a
+// state, and keeps the state of every iteration
+class replay_system_t : public base_system_t
+{
+public:
+    std::vector<f64> history;
+
+    replay_system_t(const std::string& name, const execution_scheme_t& scheme)
+        : base_system_t(name, scheme)
+    {
+        triggers.insert(1);
+    }
+
+    virtual void on_trigger(
+        world_t& world,
+        const iteration_t& iter,
+        const event_t& event
+    ) override
+    {
+        state = .5 * state + std::any_cast<f64>(event.data);
+    }
+
+    virtual void on_update(world_t& world, const iteration_t& iter) override
+    {
+        auto prng = world.make_prng(*this, iter);
+        state = .5 * state + prng.next<f64>() + iter.dt;
+        history.push_back(state);
+
+        // an event of the world's own, which is not recorded
+        if (iter.i % 3 == 0)
+        {
+            world.enqueue_event(event_t(1, state));
+        }
+        if (iter.i == 49)
+        {
+            world.stop(false);
+        }
+    }
+
+private:
+    f64 state = 0;
+
+};
+
+static void test_replay()
+{
+    std::ostringstream log_stream;
+    auto logger = std::make_shared<ostream_logger_t>(log_stream);
+    auto recording = std::make_shared<world_recording_t>();
+
+    std::vector<f64> recorded_history;
+    {
+        world_t world("test", log_level_t::error, logger);
+        world.set_seed(1234);
+        world.set_replay(replay_mode_t::record, recording);
+
+        auto system = std::make_shared<replay_system_t>(
+            "system",
+            execution_scheme_t(0)
+        );
+        world.add_system(system);
+
+        // events from outside the world, at whatever iterations they land in
+        std::jthread sender(
+            [&world]()
+            {
+                for (usize i = 0; i < 20; i++)
+                {
+                    world.enqueue_event(event_t(1, (f64)i));
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                }
+            }
+        );
+        world.run(500.);
+        sender.join();
+
+        recorded_history = system->history;
+    }
+    usize n_inputs = 0;
+    for (auto& recorded : recording->iterations)
+    {
+        n_inputs += recorded.inputs.size();
+    }
+    test::assert(
+        recording->seed == 1234 && recording->iterations.size() == 50
+        && n_inputs > 0 && n_inputs <= 20,
+        "the run is recorded without the world's own events"
+    );
+
+    world_t world("test", log_level_t::error, logger);
+    world.set_replay(replay_mode_t::replay, recording);
+    auto system = std::make_shared<replay_system_t>(
+        "system",
+        execution_scheme_t(0)
+    );
+    world.add_system(system);
+
+    // ignored while replaying
+    world.enqueue_event(event_t(1, 100.));
+    world.run();
+
+    test::assert(
+        world.get_seed() == 1234 && system->history == recorded_history,
+        "the replay reproduces the run"
+    );
+
+    iteration_t iter;
+    iter.i = 7;
+    auto a = world.make_prng(*system, iter);
+    auto b = world.make_prng(*system, iter);
+    iter.i = 8;
+    auto c = world.make_prng(*system, iter);
+    u64 a_value = a.next<u64>();
+    test::assert(
+        a_value == b.next<u64>() && a_value != c.next<u64>(),
+        "make_prng()"
+    );
+
+    // events sent from parallel loops would be ordered by the timing of the
+    // worker threads
+    world_t parallel(
+        "parallel",
+        log_level_t::error,
+        logger,
+        std::make_shared<misc::thread_pool_t>(2)
+    );
+    parallel.set_deterministic(true);
+    auto sender = std::make_shared<lifecycle_system_t>(
+        "sender",
+        execution_scheme_t(0)
+    );
+    bool did_throw = false;
+    bool did_send_after = false;
+    sender->on_iteration = [&](world_t& world, const iteration_t& iter)
+    {
+        try
+        {
+            world.parallel_for(
+                0,
+                8,
+                1,
+                [&world](usize begin, usize end)
+                {
+                    world.emit<hit_t>(null_entity);
+                }
+            );
+        }
+        catch (const std::runtime_error&)
+        {
+            did_throw = true;
+        }
+        world.emit<hit_t>(null_entity);
+        did_send_after = true;
+        world.stop(false);
+    };
+    parallel.add_system(sender);
+    parallel.run();
+    test::assert(
+        did_throw && did_send_after,
+        "events from parallel loops in deterministic runs"
+    );
+}
+
+struct settings_t
+{
+    f64 speed = 1;
+    std::vector<f64> history;
+};
+
+// reads or writes the settings resource
+class settings_system_t : public base_system_t
+{
+public:
+    settings_system_t(
+        const std::string& name,
+        const execution_scheme_t& exec_scheme,
+        bool writes
+    )
+        : base_system_t(name, exec_scheme),
+        writes(writes)
+    {
+        if (writes)
+        {
+            declare_write<settings_t>();
+        }
+        else
+        {
+            declare_read<settings_t>();
+        }
+    }
+
+    virtual void on_update(world_t& world, const iteration_t& iter) override
+    {
+        if (writes)
+        {
+            settings_t& settings = world.resource<settings_t>();
+            settings.speed *= 2;
+            settings.history.push_back(settings.speed);
+        }
+        else
+        {
+            const world_t& const_world = world;
+            n_reads += (u64)const_world.resource<settings_t>().speed;
+        }
+        if (iter.i == 2)
+        {
+            world.stop(false);
+        }
+    }
+
+    std::atomic<u64> n_reads = 0;
+
+private:
+    bool writes;
+
+};
+
+static void test_resources()
+{
+    std::ostringstream log_stream;
+    world_t world(
+        "test",
+        log_level_t::error,
+        std::make_shared<ostream_logger_t>(log_stream)
+    );
+
+    test::assert(
+        !world.has_resource<settings_t>() && !world.try_resource<settings_t>(),
+        "no resource"
+    );
+    bool did_throw = false;
+    try
+    {
+        world.resource<settings_t>();
+    }
+    catch (const std::runtime_error&)
+    {
+        did_throw = true;
+    }
+    test::assert(did_throw, "resource() throws without a resource");
+
+    settings_t& settings = world.add_resource<settings_t>(settings_t{ 2 });
+    world.add_resource<settings_t>(settings_t{ 4 });
+    test::assert(
+        &world.resource<settings_t>() == &settings && settings.speed == 4,
+        "replacing a resource keeps references valid"
+    );
+    const world_t& const_world = world;
+    test::assert(
+        const_world.try_resource<settings_t>() == &settings
+        && &const_world.resource<settings_t>() == &settings,
+        "const resource lookups"
+    );
+
+    // systems that only read a resource don't conflict
+    auto writer = std::make_shared<settings_system_t>(
+        "writer",
+        execution_scheme_t(0),
+        true
+    );
+    auto reader_a = std::make_shared<settings_system_t>(
+        "reader a",
+        execution_scheme_t(1),
+        false
+    );
+    auto reader_b = std::make_shared<settings_system_t>(
+        "reader b",
+        execution_scheme_t(1),
+        false
+    );
+    test::assert(
+        !reader_a->conflicts_with(*reader_b)
+        && writer->conflicts_with(*reader_a),
+        "declared access to resources"
+    );
+
+    world.add_system(writer);
+    world.add_system(reader_a);
+    world.add_system(reader_b);
+    world.run();
+    test::assert(
+        settings.history == std::vector<f64>{ 8, 16, 32 }
+        && reader_a->n_reads == 8 + 16 + 32
+        && reader_b->n_reads == 8 + 16 + 32,
+        "readers see the writer's changes"
+    );
+
+    // resources can't be added or removed while the systems look them up
+    world.remove_all_systems();
+    auto adder = std::make_shared<lifecycle_system_t>(
+        "adder",
+        execution_scheme_t(0)
+    );
+    usize n_rejected = 0;
+    adder->on_iteration = [&n_rejected](world_t& world, const iteration_t& iter)
+    {
+        try
+        {
+            world.add_resource<i32>(1);
+        }
+        catch (const std::runtime_error&)
+        {
+            n_rejected++;
+        }
+        try
+        {
+            world.remove_resource<settings_t>();
+        }
+        catch (const std::runtime_error&)
+        {
+            n_rejected++;
+        }
+        world.stop(false);
+    };
+    world.add_system(adder);
+    world.run();
+    test::assert(
+        n_rejected == 2
+        && !world.has_resource<i32>()
+        && world.has_resource<settings_t>(),
+        "resources can't be added or removed while running"
+    );
+
+    world.remove_resource<settings_t>();
+    test::assert(!world.has_resource<settings_t>(), "remove_resource()");
+}
+
+// counts the events it's triggered with and the hits it receives
+class event_counter_system_t
+    : public base_system_t,
+    public event_handler_t<hit_t>
+{
+public:
+    std::vector<i32> values;
+    std::vector<entity_t> targets;
+
+    event_counter_system_t(const std::string& name)
+        : base_system_t(name, execution_scheme_t(0))
+    {
+        triggers.insert(1);
+        subscribe<hit_t>(this);
+    }
+
+    virtual void on_event(
+        world_t& world,
+        const iteration_t& iter,
+        std::span<const hit_t> hits
+    ) override
+    {
+        for (auto& hit : hits)
+        {
+            targets.push_back(hit.target);
+        }
+    }
+
+    virtual void on_trigger(
+        world_t& world,
+        const iteration_t& iter,
+        const event_t& event
+    ) override
+    {
+        values.push_back(std::any_cast<i32>(event.data));
+    }
+
+    virtual void on_update(world_t& world, const iteration_t& iter) override
+    {
+        world.stop(false);
+    }
+
+};
+
+// can be copied but not copy-assigned, so a world that has it can't
+// restore it
+struct fixed_t
+{
+    i32 value = 0;
+
+    fixed_t(i32 value)
+        : value(value)
+    {}
+
+    fixed_t(const fixed_t& other) = default;
+    fixed_t(fixed_t&& other) = default;
+    fixed_t& operator=(const fixed_t& other) = delete;
+    fixed_t& operator=(fixed_t&& other) = default;
+};
+
+// counts its live instances, and throws when copied once copies_left runs
+// out
+struct counted_t
+{
+    static inline i64 n_alive = 0;
+    static inline i64 copies_left = -1;
+
+    counted_t()
+    {
+        n_alive++;
+    }
+
+    counted_t(const counted_t& other)
+    {
+        if (copies_left == 0)
+            throw std::runtime_error("out of copies");
+        if (copies_left > 0)
+            copies_left--;
+        n_alive++;
+    }
+
+    counted_t(counted_t&& other) noexcept
+    {
+        n_alive++;
+    }
+
+    counted_t& operator=(const counted_t& other) = default;
+
+    ~counted_t()
+    {
+        n_alive--;
+    }
+};
+
+static void test_snapshots()
+{
+    std::ostringstream log_stream;
+    auto logger = std::make_shared<ostream_logger_t>(log_stream);
+    world_t world("test", log_level_t::error, logger);
+
+    std::vector<entity_t> entities;
+    for (usize i = 0; i < 3000; i++)
+    {
+        entity_t e = world.create_entity();
+        world.add_component<position_t>(e, (f32)i, 0.f);
+        if (i % 3 == 0)
+            world.add_component<name_t>(e, std::to_string(i));
+        entities.push_back(e);
+    }
+    for (usize i = 0; i < 3000; i += 7)
+    {
+        world.destroy_entity(entities[i]);
+    }
+    entity_t bare = world.create_entity();
+    world.add_resource<settings_t>(settings_t{ 3 });
+    world.enqueue_event(event_t(1, (i32)5));
+    world.emit<hit_t>(bare);
+
+    world_snapshot_t snapshot;
+    world.save_snapshot(snapshot);
+    usize n_alive = world.get_registry().size();
+    test::assert(
+        snapshot.get_registry().size() == n_alive
+        && snapshot.event_count() == 1
+        && snapshot.typed_event_count() == 1,
+        "save_snapshot()"
+    );
+
+    // change everything in the snapshot
+    for (usize i = 1; i < 3000; i += 7)
+    {
+        world.destroy_entity(entities[i]);
+    }
+    world.view<position_t>().each(
+        [](position_t& pos)
+        {
+            pos.y = 1;
+        }
+    );
+    entity_t extra = world.create_entity();
+    world.add_component<velocity_t>(extra);
+    world.resource<settings_t>().speed = 10;
+    world.enqueue_event(event_t(1, (i32)6));
+    world.emit<hit_t>(extra);
+    world.emit<collision_t>(bare, extra, 1.f);
+
+    u64 version = world.get_registry().get_version();
+    world.restore_snapshot(snapshot);
+
+    const registry_t& registry = world.get_registry();
+    bool is_intact = registry.size() == n_alive
+        && registry.alive(bare)
+        && !registry.alive(extra)
+        && registry.view<const velocity_t>().size() == 0;
+    for (usize i = 0; i < 3000 && is_intact; i++)
+    {
+        entity_t e = entities[i];
+        if (i % 7 == 0)
+        {
+            is_intact = !registry.alive(e);
+            continue;
+        }
+
+        const position_t* pos = registry.try_get<position_t>(e);
+        const name_t* name = registry.try_get<name_t>(e);
+        is_intact = registry.alive(e)
+            && pos && pos->x == (f32)i && pos->y == 0
+            && (i % 3 == 0
+                ? name && name->value == std::to_string(i)
+                : !name);
+    }
+    test::assert(is_intact, "restore_snapshot() components");
+
+    usize n_changed = 0;
+    registry.view<const position_t>().changed_since(version + 1).each(
+        [&n_changed](const position_t&)
+        {
+            n_changed++;
+        }
+    );
+    test::assert(
+        n_changed == registry.view<const position_t>().size(),
+        "restored components count as changed"
+    );
+
+    // the slots of destroyed entities are recycled as before. the last
+    // freed slot was taken by bare, so the next one is the slot before it.
+    entity_t recycled = world.create_entity();
+    test::assert(
+        entity_index(recycled) == entity_index(entities[2989])
+        && entity_generation(recycled)
+        == entity_generation(entities[2989]) + 1,
+        "restored free slots"
+    );
+    world.destroy_entity(recycled);
+
+    test::assert(
+        world.resource<settings_t>().speed == 3,
+        "restore_snapshot() resources"
+    );
+
+    // the events of both kinds that came after the snapshot are discarded
+    auto world_counter = std::make_shared<event_counter_system_t>("counter");
+    auto collisions = std::make_shared<collision_system_t>();
+    world.add_system(world_counter);
+    world.add_system(collisions);
+    world.run();
+    world.remove_all_systems();
+    test::assert(
+        world_counter->values == std::vector<i32>{ 5 }
+        && world_counter->targets == std::vector<entity_t>{ bare }
+        && collisions->n_collisions == 0,
+        "restore_snapshot() events"
+    );
+
+    // fork another world from the same snapshot
+    world_t fork("fork", log_level_t::error, logger);
+    fork.restore_snapshot(snapshot);
+    auto counter = std::make_shared<event_counter_system_t>("counter");
+    fork.add_system(counter);
+    fork.run();
+    test::assert(
+        fork.get_registry().size() == n_alive
+        && fork.get_component<name_t>(entities[3]).value == "3"
+        && fork.resource<settings_t>().speed == 3
+        && counter->values == std::vector<i32>{ 5 }
+        && counter->targets == std::vector<entity_t>{ bare },
+        "restoring into another world"
+    );
+
+    // types that can't be copied can't be saved
+    world.add_component<std::unique_ptr<i32>>(bare);
+    world_snapshot_t failed;
+    bool did_throw = false;
+    try
+    {
+        world.save_snapshot(failed);
+    }
+    catch (const std::runtime_error&)
+    {
+        did_throw = true;
+    }
+    test::assert(did_throw, "uncopyable components");
+
+    // a snapshot that can't be saved keeps what it had
+    did_throw = false;
+    try
+    {
+        world.save_snapshot(snapshot);
+    }
+    catch (const std::runtime_error&)
+    {
+        did_throw = true;
+    }
+    test::assert(
+        did_throw
+        && snapshot.get_registry().size() == n_alive
+        && snapshot.event_count() == 1,
+        "failing to save keeps the previous snapshot"
+    );
+
+    // a copy that throws partway through destroys the copies made before it
+    // and keeps the previous snapshot
+    {
+        registry_t fragile;
+        for (usize i = 0; i < 10; i++)
+        {
+            fragile.add<counted_t>(fragile.create());
+        }
+        registry_snapshot_t kept;
+        fragile.save(kept);
+
+        counted_t::copies_left = 5;
+        did_throw = false;
+        try
+        {
+            fragile.save(kept);
+        }
+        catch (const std::runtime_error&)
+        {
+            did_throw = true;
+        }
+        counted_t::copies_left = -1;
+        test::assert(
+            did_throw && kept.size() == 10 && counted_t::n_alive == 20,
+            "copies that throw"
+        );
+
+        // restoring leaves the registry empty instead
+        entity_t first = fragile.create();
+        fragile.add<counted_t>(first);
+        counted_t::copies_left = 5;
+        did_throw = false;
+        try
+        {
+            fragile.restore(kept);
+        }
+        catch (const std::runtime_error&)
+        {
+            did_throw = true;
+        }
+        counted_t::copies_left = -1;
+        test::assert(
+            did_throw
+            && fragile.size() == 0
+            && !fragile.alive(first)
+            && counted_t::n_alive == 10,
+            "restoring copies that throw"
+        );
+        fragile.restore(kept);
+        test::assert(
+            fragile.size() == 10 && counted_t::n_alive == 20,
+            "restoring after copies that threw"
+        );
+    }
+    test::assert(counted_t::n_alive == 0, "copies that throw are destroyed");
+
+    // a resource that can't be assigned is found before anything changes
+    {
+        world_t fixed_world("fixed", log_level_t::error, logger);
+        fixed_world.add_resource<fixed_t>(1);
+        fixed_world.add_resource<settings_t>(settings_t{ 2 });
+        world_snapshot_t fixed_snapshot;
+        fixed_world.save_snapshot(fixed_snapshot);
+
+        fixed_world.create_entity();
+        fixed_world.resource<settings_t>().speed = 3;
+        did_throw = false;
+        try
+        {
+            fixed_world.restore_snapshot(fixed_snapshot);
+        }
+        catch (const std::runtime_error&)
+        {
+            did_throw = true;
+        }
+        test::assert(
+            did_throw
+            && fixed_world.get_registry().size() == 1
+            && fixed_world.resource<settings_t>().speed == 3,
+            "resources that can't be restored leave the world as it was"
+        );
+    }
+
+    // snapshots taken while another thread keeps starting runs either throw
+    // or see the whole registry, never a run in progress
+    world_t racer("racer", log_level_t::error, logger);
+    for (usize i = 0; i < 100; i++)
+    {
+        racer.add_component<position_t>(racer.create_entity(), (f32)i, 0.f);
+    }
+    auto mover = std::make_shared<lifecycle_system_t>(
+        "mover",
+        execution_scheme_t(0)
+    );
+    mover->declare_write<position_t>();
+    mover->on_iteration = [](world_t& world, const iteration_t& iter)
+    {
+        world.view<position_t>().each(
+            [](position_t& pos)
+            {
+                pos.y += 1.f;
+            }
+        );
+        world.stop(false);
+    };
+    racer.add_system(mover);
+
+    bool is_consistent = true;
+    {
+        std::jthread runner(
+            [&racer]()
+            {
+                for (usize i = 0; i < 50; i++)
+                {
+                    racer.run();
+                }
+            }
+        );
+        world_snapshot_t racer_snapshot;
+        for (usize i = 0; i < 50; i++)
+        {
+            try
+            {
+                racer.save_snapshot(racer_snapshot);
+                is_consistent = is_consistent
+                    && racer_snapshot.get_registry().size() == 100;
+                racer.restore_snapshot(racer_snapshot);
+            }
+            catch (const std::runtime_error&)
+            {
+            }
+        }
+    }
+    test::assert(
+        is_consistent && racer.get_registry().size() == 100,
+        "snapshots while another thread runs the world"
+    );
+}
+
+// keeps every entry it's given
+class collecting_logger_t : public base_logger_t
+{
+public:
+    std::mutex mutex;
+    std::vector<log_entry_t> entries;
+
+    virtual void log(const log_entry_t& entry) override
+    {
+        std::scoped_lock lock(mutex);
+        entries.push_back(entry);
+    }
+
+};
+
+static void test_log_message()
+{
+    test::assert(log_message_t("plain").str() == "plain", "plain text");
+    test::assert(
+        log_message_t(std::string("{} isn't formatted")).str()
+        == "{} isn't formatted",
+        "plain std::string"
+    );
+
+    // C strings are copied, so the message outlives them
+    std::optional<log_message_t> message;
+    {
+        std::string temp = "temporary";
+        message = log_message_t("{} {:.2f} {}", temp.c_str(), 1.5, 42);
+    }
+    test::assert(message->str() == "temporary 1.50 42", "deferred formatting");
+
+    // arguments too big to fit inline
+    std::string long_text(200, 'x');
+    log_message_t big(
+        "{} {} {} {}",
+        long_text,
+        long_text,
+        long_text,
+        (u64)7
+    );
+    log_message_t copy = big;
+    log_message_t moved = std::move(big);
+    std::string expected = std::format(
+        "{} {} {} {}",
+        long_text,
+        long_text,
+        long_text,
+        7
+    );
+    test::assert(
+        copy.str() == expected && moved.str() == expected,
+        "copying and moving"
+    );
+
+    copy = log_message_t("replaced");
+    test::assert(copy.str() == "replaced", "assignment");
+}
+
+static void test_async_logger()
+{
+    // every entry arrives when the rings are big enough
+    {
+        auto target = std::make_shared<collecting_logger_t>();
+        {
+            async_logger_t logger(target, 1024, log_overflow_t::wait);
+            std::vector<std::jthread> threads;
+            for (usize t = 0; t < 4; t++)
+            {
+                threads.emplace_back(
+                    [&logger]()
+                    {
+                        for (usize i = 0; i < 2000; i++)
+                        {
+                            logger.log(log_entry_t(
+                                log_level_t::info,
+                                "test",
+                                std::this_thread::get_id(),
+                                std::to_string(i)
+                            ));
+                        }
+                    }
+                );
+            }
+        }
+        test::assert(
+            target->entries.size() == 4 * 2000,
+            "every entry was forwarded with log_overflow_t::wait"
+        );
+
+        bool sorted = true;
+        for (usize i = 1; i < target->entries.size(); i++)
+        {
+            // only entries from the same batch are sorted, but entries of a
+            // single thread must always keep their order
+            auto& prev = target->entries[i - 1];
+            auto& curr = target->entries[i];
+            if (prev.thread_id == curr.thread_id && prev.time > curr.time)
+            {
+                sorted = false;
+            }
+        }
+        test::assert(sorted, "entries keep their order");
+    }
+
+    // entries are dropped and reported when a ring is full
+    {
+        auto target = std::make_shared<collecting_logger_t>();
+        u64 n_dropped;
+        {
+            async_logger_t logger(target, 16, log_overflow_t::drop, 60.);
+            for (usize i = 0; i < 100; i++)
+            {
+                logger.log(log_entry_t(
+                    log_level_t::verbose,
+                    "test",
+                    std::this_thread::get_id(),
+                    "entry"
+                ));
+            }
+            n_dropped = logger.get_n_dropped();
+            logger.flush();
+        }
+        test::assert(n_dropped == 100 - 16, "get_n_dropped()");
+        test::assert(
+            target->entries.size() == 16 + 1
+            && target->entries.back().log_level == log_level_t::warning,
+            "dropped entries were reported"
+        );
+    }
+
+    // entries only refer to the interned name of their world, so they can be
+    // written after the world is gone
+    {
+        auto target = std::make_shared<collecting_logger_t>();
+        auto logger = std::make_shared<async_logger_t>(
+            target,
+            16,
+            log_overflow_t::drop,
+            60.
+        );
+        {
+            world_t world(
+                std::string("short-lived"),
+                log_level_t::info,
+                logger
+            );
+        }
+        logger->flush();
+        test::assert(
+            !target->entries.empty()
+            && target->entries.back().world_name == "short-lived",
+            "entries outlive their world"
+        );
+        test::assert(
+            intern_log_name("short-lived").data()
+            == target->entries.back().world_name.data(),
+            "intern_log_name()"
+        );
+    }
+}
+
+static void test_binary_log()
+{
+    const std::string filename = "test_binary_log.bin";
+
+    std::vector<log_entry_t> entries;
+    entries.emplace_back(
+        log_level_t::info,
+        "world \"a\"",
+        std::this_thread::get_id(),
+        "first"
+    );
+    entries.emplace_back(
+        log_level_t::warning,
+        "world b",
+        std::this_thread::get_id(),
+        log_message_t("{} {}", "second", 2)
+    );
+    entries.emplace_back(
+        log_level_t::error,
+        "world \"a\"",
+        std::this_thread::get_id(),
+        std::string(300, 'x')
+    );
+    // out of order times must survive the zigzag deltas
+    entries[1].time = entries[0].time - std::chrono::seconds(5);
+
+    {
+        binary_logger_t logger(filename, 16);
+        for (const auto& entry : entries)
+        {
+            logger.log(entry);
+        }
+    }
+
+    {
+        binary_log_reader_t reader(filename);
+        bool matches = true;
+        binary_log_record_t record;
+        for (const auto& entry : entries)
+        {
+            std::ostringstream thread_id;
+            thread_id << entry.thread_id;
+
+            auto time = std::chrono::time_point_cast<std::chrono::microseconds>(
+                entry.time
+            );
+            if (!reader.next(record)
+                || record.log_level != entry.log_level
+                || record.world_name != entry.world_name
+                || record.thread_id != thread_id.str()
+                || record.message != entry.message.str()
+                || record.time != time)
+            {
+                matches = false;
+            }
+        }
+        test::assert(matches, "entries are decoded as they were logged");
+        test::assert(!reader.next(record), "end of the log");
+    }
+
+    {
+        binary_log_reader_t reader(filename);
+        std::ostringstream csv;
+        test::assert(reader.write_csv(csv) == entries.size(), "write_csv()");
+        test::assert(
+            csv.str().find(",warning,\"world b\",") != std::string::npos
+            && csv.str().find("\"world \"\"a\"\"\"") != std::string::npos,
+            "CSV output"
+        );
+    }
+
+    // keep the header, and follow it with an entry of an unknown log level
+    {
+        std::string header(binary_log::header_size, '\0');
+        {
+            std::ifstream in(filename, std::ifstream::binary);
+            in.read(header.data(), header.size());
+        }
+        std::ofstream out(
+            filename,
+            std::ofstream::binary | std::ofstream::trunc
+        );
+        out << header << (char)binary_log::tag_t::entry << (char)7;
+    }
+    {
+        binary_log_reader_t reader(filename);
+        binary_log_record_t record;
+        bool did_throw = false;
+        try
+        {
+            reader.next(record);
+        }
+        catch (const std::runtime_error&)
+        {
+            did_throw = true;
+        }
+        test::assert(did_throw, "invalid log levels");
+    }
+
+    std::filesystem::remove(filename);
+}
+
+void test_group_ecs()
+{
+    test::start_group("ecs");
+    test::run("registry", test_registry);
+    test::run("entity handles", test_entity_handles);
+    test::run("view", test_view);
+    test::run("change detection", test_change_detection);
+    test::run("world", test_world);
+    test::run("system graph", test_system_graph);
+    test::run("events", test_events);
+    test::run("typed events", test_typed_events);
+    test::run("profiler", test_profiler);
+    test::run("trace", test_trace);
+    test::run("fixed timestep", test_fixed_timestep);
+    test::run("multi-rate", test_multi_rate);
+    test::run("schedule cache", test_schedule_cache);
+    test::run("hot swap", test_hot_swap);
+    test::run("replay", test_replay);
+    test::run("command buffers", test_command_buffers);
+    test::run("resources", test_resources);
+    test::run("snapshots", test_snapshots);
+    test::run("log message", test_log_message);
+    test::run("async logger", test_async_logger);
+    test::run("binary log", test_binary_log);
+    test::end_group();
+}
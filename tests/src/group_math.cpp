@@ -580,6 +580,66 @@ static void test_prng()
     }
 }
 
+// * pins the outputs of the seeded constructors, so a change to how seeds are
+//   hashed into the state doesn't go unnoticed.
+static void test_prng_seeding()
+{
+    const auto first_outputs = [](prng_t& prng)
+    {
+        std::array<u32, 4> outputs;
+        for (auto& output : outputs)
+        {
+            output = prng.next<u32>();
+        }
+        return outputs;
+    };
+
+    prng_t one_seed((u32)42);
+    test::assert(
+        first_outputs(one_seed)
+        == std::array<u32, 4>{
+            0xc33812f9u, 0xd7aeb985u, 0xfeade946u, 0xa528c298u
+        },
+        "prng_t(seed)"
+    );
+
+    prng_t two_seeds((u32)42, (u32)7);
+    test::assert(
+        first_outputs(two_seeds)
+        == std::array<u32, 4>{
+            0x70c54a96u, 0x5998dba2u, 0xdb9a8962u, 0xa33fabe8u
+        },
+        "prng_t(seed0, seed1)"
+    );
+
+    prng_t swapped_seeds((u32)7, (u32)42);
+    test::assert(
+        first_outputs(swapped_seeds)
+        == std::array<u32, 4>{
+            0x2c6cd40au, 0xb16795a9u, 0x45e91adau, 0xf6641dffu
+        },
+        "prng_t(seed0, seed1) with the seeds swapped"
+    );
+
+    // the second seed must be hashed too, not only the first one
+    prng_t other_seed1((u32)42, (u32)8);
+    prng_t same_seed1((u32)42, (u32)7);
+    test::assert(
+        first_outputs(other_seed1) != first_outputs(same_seed1),
+        "prng_t(seed0, seed1) depends on seed1"
+    );
+
+    // the seeds are hashed one u32 after the other, so two seeds give the
+    // same state as a single seed made of the same words
+    const std::array<u32, 2> words{ 42, 7 };
+    prng_t packed(words);
+    prng_t split((u32)42, (u32)7);
+    test::assert(
+        first_outputs(packed) == first_outputs(split),
+        "prng_t(seed0, seed1) matches prng_t(seed)"
+    );
+}
+
 void test_group_math()
 {
     test::start_group("math");
@@ -593,5 +653,6 @@ void test_group_math()
     test::run("matrix", test_matrix);
     test::run("transform", test_transform);
     test::run("prng", test_prng);
+    test::run("prng seeding", test_prng_seeding);
     test::end_group();
 }
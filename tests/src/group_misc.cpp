@@ -0,0 +1,315 @@
+#include "group_misc.h"
+
+#include <atomic>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <stdexcept>
+
+#include "gsx/gsx.h"
+
+#include "test.h"
+
+using namespace misc;
+
+static void test_thread_pool()
+{
+    thread_pool_t pool(4);
+    test::assert(pool.size() == 4, "size()");
+
+    // plain jobs
+    std::atomic<u64> sum = 0;
+    job_group_t group;
+    for (u64 i = 1; i <= 1000; i++)
+    {
+        pool.enqueue(
+            [&sum, i]()
+            {
+                sum += i;
+            },
+            &group
+        );
+    }
+    pool.wait(group);
+    test::assert(sum == 500500, "wait()");
+
+    // jobs that enqueue and wait for nested jobs
+    std::atomic<u64> n_leaves = 0;
+    job_group_t outer;
+    for (usize i = 0; i < 16; i++)
+    {
+        pool.enqueue(
+            [&pool, &n_leaves]()
+            {
+                job_group_t inner;
+                for (usize j = 0; j < 64; j++)
+                {
+                    pool.enqueue(
+                        [&n_leaves]()
+                        {
+                            n_leaves++;
+                        },
+                        &inner
+                    );
+                }
+                pool.wait(inner);
+            },
+            &outer
+        );
+    }
+    pool.wait(outer);
+    test::assert(n_leaves == 16 * 64, "nested wait()");
+    test::assert(
+        pool.current_worker_index() == -1,
+        "current_worker_index() outside the pool"
+    );
+}
+
+static void test_parallel_for()
+{
+    thread_pool_t pool(4);
+
+    // every index is visited exactly once
+    std::vector<u32> visits(10007, 0);
+    pool.parallel_for(
+        0,
+        visits.size(),
+        64,
+        [&visits](usize begin, usize end)
+        {
+            for (usize i = begin; i < end; i++)
+            {
+                visits[i]++;
+            }
+        }
+    );
+    bool all_once = true;
+    for (auto count : visits)
+    {
+        all_once = all_once && (count == 1);
+    }
+    test::assert(all_once, "parallel_for() visits every index once");
+
+    // empty ranges do nothing
+    bool called = false;
+    pool.parallel_for(
+        5,
+        5,
+        1,
+        [&called](usize begin, usize end)
+        {
+            called = true;
+        }
+    );
+    test::assert(!called, "parallel_for() with an empty range");
+
+    // float sums are identical across calls and pool sizes since the ranges
+    // and the combine order are fixed
+    auto partial_sum = [](usize begin, usize end)
+    {
+        f32 partial = 0;
+        for (usize i = begin; i < end; i++)
+        {
+            partial += 1.f / (f32)(i + 1);
+        }
+        return partial;
+    };
+    auto add = [](f32 a, f32 b)
+    {
+        return a + b;
+    };
+    auto sum = [&](thread_pool_t& summing_pool)
+    {
+        return summing_pool.parallel_reduce(
+            0,
+            100000,
+            16,
+            0.f,
+            partial_sum,
+            add
+        );
+    };
+    f32 first = sum(pool);
+    bool deterministic = true;
+    for (usize i = 0; i < 20; i++)
+    {
+        deterministic = deterministic && (sum(pool) == first);
+    }
+    test::assert(deterministic, "parallel_reduce() is deterministic");
+
+    thread_pool_t small_pool(1);
+    test::assert(
+        sum(small_pool) == first
+        && thread_pool_t::serial_reduce(
+            0,
+            100000,
+            16,
+            0.f,
+            partial_sum,
+            add
+        ) == first,
+        "parallel_reduce() doesn't depend on the number of workers"
+    );
+
+    // exceptions are rethrown on the calling thread once every range is
+    // finished, whichever range throws
+    for (usize throwing : { (usize)0, (usize)5000 })
+    {
+        std::atomic<usize> n_visited = 0;
+        bool did_throw = false;
+        try
+        {
+            pool.parallel_for(
+                0,
+                10000,
+                16,
+                [&n_visited, throwing](usize begin, usize end)
+                {
+                    std::this_thread::sleep_for(
+                        std::chrono::microseconds(50)
+                    );
+                    n_visited += end - begin;
+                    if (begin <= throwing && throwing < end)
+                        throw std::runtime_error("range");
+                }
+            );
+        }
+        catch (const std::runtime_error&)
+        {
+            did_throw = true;
+        }
+        test::assert(
+            did_throw && n_visited == 10000,
+            "parallel_for() rethrows after every range is finished"
+        );
+    }
+
+    u64 total = pool.parallel_reduce(
+        1,
+        1001,
+        7,
+        (u64)0,
+        [](usize begin, usize end)
+        {
+            u64 partial = 0;
+            for (usize i = begin; i < end; i++)
+            {
+                partial += i;
+            }
+            return partial;
+        },
+        [](u64 a, u64 b)
+        {
+            return a + b;
+        }
+    );
+    test::assert(total == 500500, "parallel_reduce()");
+}
+
+static void test_mpsc_queue()
+{
+    mpsc_queue_t<u64> queue;
+    test::assert(queue.empty() && !queue.pop(), "empty queue");
+
+    // several producers pushing at once
+    constexpr usize n_producers = 4;
+    constexpr u64 n_per_producer = 10000;
+    {
+        std::vector<std::jthread> producers;
+        for (usize p = 0; p < n_producers; p++)
+        {
+            producers.emplace_back(
+                [&queue, p]()
+                {
+                    for (u64 i = 0; i < n_per_producer; i++)
+                    {
+                        queue.emplace(p * n_per_producer + i);
+                    }
+                }
+            );
+        }
+    }
+
+    // for_each() visits the elements without removing them
+    u64 sum = 0;
+    usize n_visited = queue.for_each(
+        [&sum](const u64& value)
+        {
+            sum += value;
+        }
+    );
+    const u64 n_total = n_producers * n_per_producer;
+    test::assert(
+        n_visited == n_total
+        && sum == n_total * (n_total - 1) / 2
+        && !queue.empty(),
+        "for_each()"
+    );
+
+    // each producer's elements come out in the order they were pushed
+    std::vector<u64> last(n_producers, 0);
+    bool in_order = true;
+    usize count = queue.drain(
+        [&last, &in_order](u64 value)
+        {
+            usize p = value / n_per_producer;
+            u64 i = value % n_per_producer + 1;
+            in_order = in_order && (i > last[p]);
+            last[p] = i;
+        }
+    );
+    test::assert(count == n_producers * n_per_producer, "drain() count");
+    test::assert(in_order, "per-producer order");
+    test::assert(queue.empty(), "empty after drain()");
+}
+
+static void test_frame_pacer()
+{
+    const f64 period = .005;
+    frame_pacer_t pacer(period);
+
+    // the deadlines don't drift, even if the frames take varying times
+    auto time_start = std::chrono::steady_clock::now();
+    for (usize i = 0; i < 20; i++)
+    {
+        sleep((f64)(i % 3) * .001);
+        pacer.wait();
+    }
+    f64 elapsed = elapsed_sec<f64>(
+        time_start,
+        std::chrono::steady_clock::now()
+    );
+    test::assert(
+        elapsed >= 20 * period - 1e-4 && elapsed < 40 * period,
+        "absolute deadlines"
+    );
+
+    auto stats = pacer.get_stats();
+    test::assert(
+        stats.n_frames == 20
+        && stats.mean_jitter >= 0
+        && stats.max_jitter >= stats.mean_jitter,
+        "statistics"
+    );
+
+    // a late frame is reported and the next deadline moves
+    pacer.reset(period);
+    sleep(4 * period);
+    f64 late_wait = pacer.wait();
+    f64 next_wait = pacer.wait();
+    test::assert(
+        pacer.get_stats().n_missed == 1 && late_wait < period / 2,
+        "missed deadline"
+    );
+    test::assert(next_wait > period / 2, "no catching up after a late frame");
+}
+
+void test_group_misc()
+{
+    test::start_group("misc");
+    test::run("thread_pool", test_thread_pool);
+    test::run("parallel_for", test_parallel_for);
+    test::run("mpsc_queue", test_mpsc_queue);
+    test::run("frame_pacer", test_frame_pacer);
+    test::end_group();
+}
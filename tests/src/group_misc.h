@@ -0,0 +1,6 @@
+#pragma once
+
+// * not every function and/or class is tested here. if you want to make these
+//   tests complete, feel free to do it in a separate branch and make a pull
+//   request.
+void test_group_misc();
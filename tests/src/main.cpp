@@ -1,10 +1,14 @@
 #include <iostream>
 
 #include "group_math.h"
+#include "group_ecs.h"
+#include "group_misc.h"
 
 int main()
 {
     test_group_math();
+    test_group_ecs();
+    test_group_misc();
 
     std::cout << "\npress [ENTER] to quit...\n";
     std::cin.get();